@@ -4,6 +4,9 @@ uniform vec3 iResolution;
 uniform float iTime;
 uniform sampler2D iChannel0; // Waveform
 uniform sampler2D iChannel1; // Spectrum
+uniform float iBass;   // CPU-computed band levels
+uniform float iMid;
+uniform float iTreble;
 varying vec2 vUV;
 
 const float overallSpeed = 0.2;
@@ -51,31 +54,18 @@ float random(float t) {
 }
 
 // Audio reactive functions
+// Band levels are computed once per frame on the CPU instead of
+// summing 50 spectrum texels for every pixel
 float getBass() {
-    // Low frequencies (bass) - first 10% of spectrum
-    float bass = 0.0;
-    for(int i = 0; i < 5; i++) {
-        bass += texture2D(iChannel1, vec2(float(i) / 50.0, 0.0)).r;
-    }
-    return bass / 5.0;
+    return iBass;
 }
 
 float getMid() {
-    // Mid frequencies - 10% to 50% of spectrum
-    float mid = 0.0;
-    for(int i = 5; i < 25; i++) {
-        mid += texture2D(iChannel1, vec2(float(i) / 50.0, 0.0)).r;
-    }
-    return mid / 20.0;
+    return iMid;
 }
 
 float getTreble() {
-    // High frequencies - 50% to 100% of spectrum
-    float treble = 0.0;
-    for(int i = 25; i < 50; i++) {
-        treble += texture2D(iChannel1, vec2(float(i) / 50.0, 0.0)).r;
-    }
-    return treble / 25.0;
+    return iTreble;
 }
 
 float getWaveform() {
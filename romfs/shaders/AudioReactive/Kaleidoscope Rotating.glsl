@@ -59,7 +59,7 @@ void main() {
         // Audio-reactive pattern complexity
         float x = t * (0.06 + iAudioHigh * 0.04) - r * (0.2 + iAudioLevel * 0.1);
         float angle = atan(o.y, o.x);
-        float rounded = round((angle - x) / (0.314 + iAudioBass * 0.1)) + x;
+        float rounded = floor((angle - x) / (0.314 + iAudioBass * 0.1) + 0.5) + x;
         
         // Apply rotation with audio influence
         o.xy *= rotate(rounded * (1.0 + iAudioMid * 0.5));
@@ -57,7 +57,7 @@ void main() {
         
         float x = t * (0.06 + iAudioHigh * 0.04) - r * (0.2 + iAudioLevel * 0.1);
         float angle = atan(o.y, o.x);
-        float rounded = round((angle - x) / 0.314) + x;
+        float rounded = floor((angle - x) / 0.314 + 0.5) + x;
         //float rounded = round((angle - x) * 0.314);
         
         // Apply rotation with audio influence
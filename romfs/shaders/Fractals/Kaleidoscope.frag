@@ -40,7 +40,7 @@ void main() {
         float x = t * 0.06 - r * 0.2;
         float angle = atan(o.y, o.x);
         //float rounded = round((angle - x) / 0.314) * 0.314 + x;
-        float rounded = round((angle - x) / 0.314) + x;
+        float rounded = floor((angle - x) / 0.314 + 0.5) + x;
         
         // Apply rotation
         o.xy *= rotate(rounded);
@@ -0,0 +1,250 @@
+/*
+Shader Fun - Onset and tempo tracking
+Created By MrDude
+*/
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "audio_beat.h"
+#include "audio_simd.h"
+
+static const float MIN_BPM = 60.0f;
+static const float MAX_BPM = 200.0f;
+static const float PRIOR_BPM = 120.0f;     // centre of the tempo prior
+static const float PRIOR_OCTAVES = 1.0f;   // its width
+static const float FLUX_FLOOR_DB = -80.0f;
+static const float FLUX_MAX_HZ = 16000.0f;
+static const float THRESHOLD_STDDEVS = 1.5f;
+static const float PULSE_SECONDS = 0.12f;  // iBeat decay time constant
+static const float PLL_GAIN = 0.25f;
+static const float TEMPO_SWEEP_SECONDS = 0.5f;
+
+static int clampInt(int v, int lo, int hi) {
+	return v < lo ? lo : (v > hi ? hi : v);
+}
+
+BeatTracker::BeatTracker()
+	: bins(0), fluxBins(0), hopsPerSecond(0.0f), fluxPos(0), thresholdPrev(0.0f),
+	hopsSinceOnset(0), minOnsetHops(1), envPos(0), envFilled(0), minLag(1), maxLag(1),
+	acfLag(0), lagsPerHop(1), candidateLag(0), candidateVotes(0), periodHops(0.0), phase(0.0),
+	beatPulse(0.0f), pulseDecay(0.9f), bpm(0.0f), confidence(0.0f), onsetCount(0), beatCount(0) {
+	fluxPrev[0] = fluxPrev[1] = 0.0f;
+}
+
+void BeatTracker::configure(int binCount, float binHz, float hps) {
+	bins = binCount;
+	hopsPerSecond = hps;
+	fluxBins = clampInt((int)(FLUX_MAX_HZ / binHz), 1, bins);
+
+	logMag.assign(fluxBins, 0.0f);
+	prevLogMag.assign(fluxBins, 0.0f);
+	fluxHistory.assign(clampInt((int)(0.5f * hps), 8, 256), 0.0f);
+	minOnsetHops = clampInt((int)(0.1f * hps), 1, 1000);
+	pulseDecay = expf(-1.0f / (PULSE_SECONDS * hps));
+
+	// ~6 seconds of onset envelope, power of two for cheap wrapping
+	int envSize = 256;
+	while (envSize * 2 <= (int)(6.0f * hps) && envSize < 4096) envSize *= 2;
+	envelope.assign(envSize, 0.0f);
+
+	minLag = clampInt((int)floorf(60.0f * hps / MAX_BPM), 1, envSize / 4);
+	maxLag = clampInt((int)ceilf(60.0f * hps / MIN_BPM), minLag + 2, envSize / 4);
+	// Lags up to 2x maxLag so each candidate can be checked at its double
+	acf.assign(maxLag * 2 + 2, 0.0f);
+
+	int lagCount = maxLag * 2 + 1 - minLag + 1;
+	int sweepHops = (int)(TEMPO_SWEEP_SECONDS * hps);
+	lagsPerHop = clampInt((lagCount + sweepHops - 1) / (sweepHops > 0 ? sweepHops : 1), 1, lagCount);
+
+	reset();
+}
+
+void BeatTracker::reset() {
+	std::fill(logMag.begin(), logMag.end(), 0.0f);
+	std::fill(prevLogMag.begin(), prevLogMag.end(), 0.0f);
+	std::fill(fluxHistory.begin(), fluxHistory.end(), 0.0f);
+	std::fill(envelope.begin(), envelope.end(), 0.0f);
+	std::fill(acf.begin(), acf.end(), 0.0f);
+	fluxPos = 0;
+	fluxPrev[0] = fluxPrev[1] = 0.0f;
+	thresholdPrev = 0.0f;
+	hopsSinceOnset = 0;
+	envPos = 0;
+	envFilled = 0;
+	acfLag = 0;
+	candidateLag = 0;
+	candidateVotes = 0;
+	periodHops = 0.0;
+	phase = 0.0;
+	beatPulse = 0.0f;
+	bpm = 0.0f;
+	confidence = 0.0f;
+}
+
+void BeatTracker::onStftFrame(const StftFrame& frame, void* user) {
+	((BeatTracker*)user)->processHop(frame.magnitudes);
+}
+
+void BeatTracker::fireBeat() {
+	beatPulse = 1.0f;
+	beatCount++;
+}
+
+void BeatTracker::processHop(const float* magnitudes) {
+	if (fluxBins == 0) return;
+
+	// === Spectral flux on log-compressed magnitudes ===
+	audioDecibels(magnitudes, logMag.data(), fluxBins, FLUX_FLOOR_DB);
+	float flux = 0.0f;
+	for (int i = 0; i < fluxBins; i++) {
+		float d = logMag[i] - prevLogMag[i];
+		if (d > 0.0f) flux += d;
+	}
+	flux /= fluxBins;
+	logMag.swap(prevLogMag);
+
+	// === Adaptive threshold: mean + k * stddev of the recent flux ===
+	int historySize = (int)fluxHistory.size();
+	float mean = 0.0f, sq = 0.0f;
+	for (int i = 0; i < historySize; i++) {
+		mean += fluxHistory[i];
+		sq += fluxHistory[i] * fluxHistory[i];
+	}
+	mean /= historySize;
+	float var = sq / historySize - mean * mean;
+	float threshold = mean + THRESHOLD_STDDEVS * sqrtf(var > 0.0f ? var : 0.0f) + 1e-4f;
+	fluxHistory[fluxPos] = flux;
+	fluxPos = (fluxPos + 1) % historySize;
+
+	// Peak-pick the previous hop now that we know its right neighbour
+	float candidate = fluxPrev[0];
+	bool onset = candidate > thresholdPrev && candidate >= fluxPrev[1] && candidate > flux &&
+		hopsSinceOnset >= minOnsetHops;
+	fluxPrev[1] = fluxPrev[0];
+	fluxPrev[0] = flux;
+	thresholdPrev = threshold;
+	hopsSinceOnset++;
+
+	// === Onset strength envelope for the tempo estimate ===
+	float strength = flux - mean;
+	envelope[envPos] = strength > 0.0f ? strength : 0.0f;
+	envPos = (envPos + 1) & ((int)envelope.size() - 1);
+	if (envFilled < (int)envelope.size()) envFilled++;
+
+	// A few autocorrelation lags per hop; evaluate once the sweep is done
+	int envSize = (int)envelope.size();
+	int mask = envSize - 1;
+	int lastLag = (int)acf.size() - 1;
+	for (int n = 0; n < lagsPerHop; n++) {
+		if (acfLag > lastLag) {
+			updateTempo();
+			acfLag = 0;
+		}
+		int lag = acfLag == 0 ? 0 : acfLag + minLag - 1; // lag 0 first, for normalising
+		if (lag > lastLag) {
+			acfLag = lastLag + 1;
+			continue;
+		}
+		float sum = 0.0f;
+		int count = envFilled - lag;
+		int start = (envPos - envFilled) & mask; // oldest sample
+		for (int k = 0; k < count; k++) {
+			sum += envelope[(start + k) & mask] * envelope[(start + k + lag) & mask];
+		}
+		acf[lag] = count > 0 ? sum / count : 0.0f;
+		acfLag++;
+	}
+
+	// === Beat clock ===
+	beatPulse *= pulseDecay;
+
+	if (periodHops > 0.0) {
+		phase += 1.0 / periodHops;
+		if (phase >= 1.0) {
+			phase -= 1.0;
+			fireBeat();
+		}
+	}
+
+	if (onset) {
+		onsetCount++;
+		hopsSinceOnset = 1;
+
+		if (periodHops <= 0.0) {
+			// No tempo yet - pulse on raw onsets
+			fireBeat();
+		}
+		else {
+			// Onset was one hop ago; nudge the clock towards it if it is
+			// close to where we expected a beat
+			double at = phase - 1.0 / periodHops;
+			if (at < 0.0) at += 1.0;
+			double err = at < 0.5 ? -at : 1.0 - at;
+			if (fabs(err) < 0.25) {
+				phase += PLL_GAIN * err;
+				if (phase >= 1.0) {
+					phase -= 1.0;
+					fireBeat();
+				}
+				else if (phase < 0.0) {
+					phase = 0.0;
+				}
+			}
+		}
+	}
+}
+
+void BeatTracker::updateTempo() {
+	if (envFilled < maxLag * 2 || acf[0] <= 0.0f) return;
+
+	// Score each tempo by its lag plus its double (a comb of two teeth),
+	// weighted by a log-normal prior around PRIOR_BPM
+	int best = 0;
+	float bestScore = 0.0f;
+	std::vector<float>& a = acf;
+	for (int lag = minLag; lag <= maxLag; lag++) {
+		float lagBpm = 60.0f * hopsPerSecond / lag;
+		float octaves = log2f(lagBpm / PRIOR_BPM) / PRIOR_OCTAVES;
+		float weight = expf(-0.5f * octaves * octaves);
+		float score = weight * (a[lag] + 0.5f * a[lag * 2]);
+		if (score > bestScore) {
+			bestScore = score;
+			best = lag;
+		}
+	}
+	if (best == 0) return;
+
+	// Parabolic interpolation around the peak for a fractional lag
+	double lag = best;
+	if (best > minLag && best < maxLag) {
+		float y0 = a[best - 1], y1 = a[best], y2 = a[best + 1];
+		float denom = y0 - 2.0f * y1 + y2;
+		if (denom < 0.0f) {
+			lag += 0.5 * (y0 - y2) / denom;
+		}
+	}
+
+	float conf = a[best] / a[0];
+	confidence = conf > 1.0f ? 1.0f : conf;
+	if (confidence < 0.1f) return;
+
+	if (periodHops <= 0.0 || fabs(lag - periodHops) / periodHops < 0.06) {
+		// First lock, or the same tempo - follow it smoothly
+		periodHops = periodHops <= 0.0 ? lag : periodHops * 0.85 + lag * 0.15;
+		candidateVotes = 0;
+	}
+	else if (candidateLag > 0 && fabs(lag - candidateLag) / candidateLag < 0.06) {
+		// A different tempo has now won twice in a row - switch to it
+		if (++candidateVotes >= 2) {
+			periodHops = lag;
+			candidateVotes = 0;
+		}
+	}
+	else {
+		candidateLag = best;
+		candidateVotes = 1;
+	}
+
+	bpm = (float)(60.0 * hopsPerSecond / periodHops);
+}
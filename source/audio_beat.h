@@ -0,0 +1,78 @@
+/*
+Shader Fun - Onset and tempo tracking
+Created By MrDude
+*/
+
+#ifndef AUDIO_BEAT_H
+#define AUDIO_BEAT_H
+
+#include <stdint.h>
+#include <vector>
+#include "audio_stft.h"
+
+// Spectral-flux onset detector with an adaptive threshold, feeding an
+// autocorrelation tempo estimator and a phase-locked beat clock.
+// Runs once per STFT hop (register onStftFrame as a listener). The
+// autocorrelation is spread over several hops so the cost of any single
+// hop stays small and bounded.
+class BeatTracker {
+public:
+	BeatTracker();
+
+	void configure(int bins, float binHz, float hopsPerSecond);
+
+	// Forget tempo and phase (new song)
+	void reset();
+
+	void processHop(const float* magnitudes);
+	static void onStftFrame(const StftFrame& frame, void* user);
+
+	float getBeat() const { return beatPulse; }         // 1 on a beat, decays to 0
+	float getBeatPhase() const { return (float)phase; } // 0..1 through the current beat
+	float getBpm() const { return bpm; }                // 0 until a tempo is found
+	float getConfidence() const { return confidence; }  // 0..1
+	uint64_t getOnsetCount() const { return onsetCount; }
+	uint64_t getBeatCount() const { return beatCount; }
+
+private:
+	void updateTempo();
+	void fireBeat();
+
+	int bins;
+	int fluxBins;
+	float hopsPerSecond;
+
+	// Onset detection
+	std::vector<float> logMag;
+	std::vector<float> prevLogMag;
+	std::vector<float> fluxHistory;   // adaptive threshold window
+	int fluxPos;
+	float fluxPrev[2];                // flux[t-1], flux[t-2] for peak picking
+	float thresholdPrev;
+	int hopsSinceOnset;
+	int minOnsetHops;
+
+	// Tempo estimation
+	std::vector<float> envelope;      // onset strength, circular
+	int envPos;
+	int envFilled;
+	std::vector<float> acf;           // autocorrelation by lag
+	int minLag;
+	int maxLag;
+	int acfLag;                       // next lag to evaluate
+	int lagsPerHop;
+	int candidateLag;
+	int candidateVotes;
+
+	// Beat clock
+	double periodHops;
+	double phase;
+	float beatPulse;
+	float pulseDecay;
+	float bpm;
+	float confidence;
+	uint64_t onsetCount;
+	uint64_t beatCount;
+};
+
+#endif // AUDIO_BEAT_H
@@ -0,0 +1,138 @@
+/*
+Shader Fun - Mixer output capture
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "audio_capture.h"
+#include "audio_simd.h"
+
+static const float M3DB = 0.70710678f;
+
+const char* captureFormatName(CaptureFormat format) {
+	switch (format) {
+	case CAPTURE_FORMAT_S16: return "s16";
+	case CAPTURE_FORMAT_S32: return "s32";
+	case CAPTURE_FORMAT_F32: return "f32";
+	default:                 return "unknown";
+	}
+}
+
+AudioCapture::AudioCapture()
+	: ring(nullptr), format(CAPTURE_FORMAT_S16), channels(0), frameBytes(0) {
+	memset(leftGain, 0, sizeof(leftGain));
+	memset(rightGain, 0, sizeof(rightGain));
+}
+
+bool AudioCapture::configure(AudioRing* audioRing, CaptureFormat fmt, int numChannels) {
+	ring = nullptr;
+	if (!audioRing || audioRing->getChannels() != 2) {
+		printf("AudioCapture: ring must be stereo\n");
+		return false;
+	}
+	if (numChannels < 1 || numChannels > MAX_CHANNELS) {
+		printf("AudioCapture: unsupported channel count %d\n", numChannels);
+		return false;
+	}
+
+	format = fmt;
+	channels = numChannels;
+	frameBytes = channels * (format == CAPTURE_FORMAT_S16 ? 2 : 4);
+
+	// Fold-down matrix in SDL channel order (LFE is dropped):
+	// 3: FL FR LFE / 4: FL FR BL BR / 5: FL FR FC BL BR
+	// 6: FL FR FC LFE BL BR / 7: FL FR FC LFE BC SL SR / 8: FL FR FC LFE BL BR SL SR
+	memset(leftGain, 0, sizeof(leftGain));
+	memset(rightGain, 0, sizeof(rightGain));
+	leftGain[0] = 1.0f;
+	rightGain[channels > 1 ? 1 : 0] = 1.0f;
+	if (channels == 4) {
+		leftGain[2] = M3DB;
+		rightGain[3] = M3DB;
+	}
+	else if (channels >= 5) {
+		leftGain[2] = rightGain[2] = M3DB;      // centre
+		leftGain[channels - 2] = M3DB;          // back (5/6) or side (7/8) left
+		rightGain[channels - 1] = M3DB;
+		if (channels == 7) {
+			leftGain[4] = rightGain[4] = 0.5f;  // back centre
+		}
+		else if (channels == 8) {
+			leftGain[4] = M3DB;                 // back left/right
+			rightGain[5] = M3DB;
+		}
+	}
+
+	ring = audioRing;
+	printf("AudioCapture: %s, %d channel%s @ %d Hz\n", captureFormatName(format),
+		channels, channels == 1 ? "" : "s", ring->getSampleRate());
+	return true;
+}
+
+void AudioCapture::toStereo(const float* in, float* out, int frames) const {
+	switch (channels) {
+	case 1:
+		audioMonoToStereo(in, out, frames);
+		break;
+	case 6:
+		audioDownmix51(in, out, frames);
+		break;
+	default:
+		for (int i = 0; i < frames; i++) {
+			const float* f = in + i * channels;
+			float l = 0.0f, r = 0.0f;
+			for (int c = 0; c < channels; c++) {
+				l += f[c] * leftGain[c];
+				r += f[c] * rightGain[c];
+			}
+			out[i * 2] = l;
+			out[i * 2 + 1] = r;
+		}
+		break;
+	}
+}
+
+void AudioCapture::push(const void* stream, int bytes) {
+	if (!ring || bytes <= 0) return;
+
+	const unsigned char* src = (const unsigned char*)stream;
+	int frames = bytes / frameBytes;
+
+	while (frames > 0) {
+		int n = frames < BLOCK_FRAMES ? frames : BLOCK_FRAMES;
+		int count = n * channels;
+
+		// Float stereo needs no conversion at all
+		if (format == CAPTURE_FORMAT_F32 && channels == 2) {
+			ring->write((const float*)src, n);
+		}
+		else {
+			const float* in;
+			switch (format) {
+			case CAPTURE_FORMAT_S16:
+				audioS16ToFloat((const int16_t*)src, converted, count);
+				in = converted;
+				break;
+			case CAPTURE_FORMAT_S32:
+				audioS32ToFloat((const int32_t*)src, converted, count);
+				in = converted;
+				break;
+			default:
+				in = (const float*)src;
+				break;
+			}
+
+			if (channels == 2) {
+				ring->write(in, n);
+			}
+			else {
+				toStereo(in, stereo, n);
+				ring->write(stereo, n);
+			}
+		}
+
+		src += n * frameBytes;
+		frames -= n;
+	}
+}
@@ -0,0 +1,55 @@
+/*
+Shader Fun - Mixer output capture
+Created By MrDude
+*/
+
+#ifndef AUDIO_CAPTURE_H
+#define AUDIO_CAPTURE_H
+
+#include "audio_ring.h"
+
+enum CaptureFormat {
+	CAPTURE_FORMAT_S16,
+	CAPTURE_FORMAT_S32,
+	CAPTURE_FORMAT_F32
+};
+
+const char* captureFormatName(CaptureFormat format);
+
+// Converts whatever the mixer negotiated (s16/s32/f32, 1-8 channels) into
+// float stereo frames and pushes them into a 2-channel AudioRing. Mono is
+// duplicated to both sides; surround is folded down with the ITU
+// coefficients (5.1 has its own vectorised kernel). Runs on the mixer
+// thread: no allocation, no locks.
+class AudioCapture {
+public:
+	AudioCapture();
+
+	// ring must have been initialised with 2 channels
+	bool configure(AudioRing* ring, CaptureFormat format, int channels);
+
+	// Raw mixer output, `bytes` long (mixer thread)
+	void push(const void* stream, int bytes);
+
+	int getFrameBytes() const { return frameBytes; }
+	int getChannels() const { return channels; }
+	CaptureFormat getFormat() const { return format; }
+
+private:
+	static const int BLOCK_FRAMES = 256;
+	static const int MAX_CHANNELS = 8;
+
+	void toStereo(const float* in, float* out, int frames) const;
+
+	AudioRing* ring;
+	CaptureFormat format;
+	int channels;
+	int frameBytes;
+	// Per input channel contribution to left/right (generic fold-down)
+	float leftGain[MAX_CHANNELS];
+	float rightGain[MAX_CHANNELS];
+	float converted[BLOCK_FRAMES * MAX_CHANNELS];
+	float stereo[BLOCK_FRAMES * 2];
+};
+
+#endif // AUDIO_CAPTURE_H
@@ -0,0 +1,91 @@
+/*
+Shader Fun - Per-frame audio features for shader uniforms
+Created By MrDude
+*/
+
+#include <math.h>
+#include <string.h>
+#include "audio_features.h"
+
+static const float BAND_LOW_HZ = 40.0f;
+static const float BAND_HIGH_HZ = 16000.0f;
+
+AudioFeatureExtractor::AudioFeatureExtractor()
+	: bins(0), binHz(0.0f) {
+	memset(bandRanges, 0, sizeof(bandRanges));
+	bassRange.first = bassRange.last = 0;
+	midRange = trebleRange = bassRange;
+}
+
+AudioFeatureExtractor::BinRange AudioFeatureExtractor::rangeFor(float loHz, float hiHz) const {
+	BinRange r;
+	r.first = (int)floorf(loHz / binHz + 0.5f);
+	r.last = (int)floorf(hiHz / binHz + 0.5f);
+	if (r.first < 1) r.first = 1;           // skip DC
+	if (r.first > bins - 1) r.first = bins - 1;
+	if (r.last > bins) r.last = bins;
+	if (r.last <= r.first) r.last = r.first + 1; // at least one bin per band
+	return r;
+}
+
+void AudioFeatureExtractor::configure(int binCount, float hz) {
+	bins = binCount;
+	binHz = hz;
+	if (bins < 2 || binHz <= 0.0f) return;
+
+	float ratio = powf(BAND_HIGH_HZ / BAND_LOW_HZ, 1.0f / AUDIO_BAND_COUNT);
+	float lo = BAND_LOW_HZ;
+	for (int b = 0; b < AUDIO_BAND_COUNT; b++) {
+		float hi = lo * ratio;
+		bandRanges[b] = rangeFor(lo, hi);
+		lo = hi;
+	}
+
+	bassRange = rangeFor(20.0f, 250.0f);
+	midRange = rangeFor(250.0f, 4000.0f);
+	trebleRange = rangeFor(4000.0f, 16000.0f);
+}
+
+// RMS magnitude across the band, so wide and narrow bands read alike
+float AudioFeatureExtractor::bandLevel(const float* magnitudes, BinRange range) {
+	float power = 0.0f;
+	for (int i = range.first; i < range.last; i++) {
+		power += magnitudes[i] * magnitudes[i];
+	}
+	return sqrtf(power / (range.last - range.first));
+}
+
+void AudioFeatureExtractor::compute(const float* magnitudes, const float* samples, int sampleCount, AudioFeatures& out) const {
+	if (bins < 2) {
+		memset(&out, 0, sizeof(out));
+		return;
+	}
+
+	for (int b = 0; b < AUDIO_BAND_COUNT; b++) {
+		out.bands[b] = bandLevel(magnitudes, bandRanges[b]);
+	}
+	out.bass = bandLevel(magnitudes, bassRange);
+	out.mid = bandLevel(magnitudes, midRange);
+	out.treble = bandLevel(magnitudes, trebleRange);
+
+	float sum = 0.0f, peak = 0.0f;
+	for (int i = 0; i < sampleCount; i++) {
+		float s = samples[i];
+		sum += s * s;
+		float a = fabsf(s);
+		if (a > peak) peak = a;
+	}
+	out.energy = sampleCount > 0 ? sqrtf(sum / sampleCount) : 0.0f;
+	out.peak = peak;
+}
+
+void AudioFeatureExtractor::fillBandRow(const AudioFeatures& features, float* row) const {
+	if (bins < 2) return;
+
+	memset(row, 0, bins * sizeof(float));
+	for (int b = 0; b < AUDIO_BAND_COUNT; b++) {
+		for (int i = bandRanges[b].first; i < bandRanges[b].last; i++) {
+			row[i] = features.bands[b];
+		}
+	}
+}
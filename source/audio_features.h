@@ -0,0 +1,56 @@
+/*
+Shader Fun - Per-frame audio features for shader uniforms
+Created By MrDude
+*/
+
+#ifndef AUDIO_FEATURES_H
+#define AUDIO_FEATURES_H
+
+#include <vector>
+
+const int AUDIO_BAND_COUNT = 8;
+
+// Scalars every shader would otherwise rebuild per pixel from iChannel1.
+// Band levels are in the same 0..1 units as the spectrum texture; energy
+// and peak are measured on the raw samples.
+struct AudioFeatures {
+	float bands[AUDIO_BAND_COUNT]; // log-spaced, 40 Hz .. 16 kHz
+	float bass;                    // 20 - 250 Hz
+	float mid;                     // 250 Hz - 4 kHz
+	float treble;                  // 4 - 16 kHz
+	float energy;                  // RMS of the analysis window
+	float peak;                    // largest absolute sample
+};
+
+class AudioFeatureExtractor {
+public:
+	AudioFeatureExtractor();
+
+	// Rebuild the bin ranges for a spectrum of `bins` bins, binHz apart
+	void configure(int bins, float binHz);
+
+	// magnitudes: configured bin count; samples: time-domain window
+	void compute(const float* magnitudes, const float* samples, int sampleCount, AudioFeatures& out) const;
+
+	// Per-bin copy of the band levels (each bin gets its band's level, 0
+	// outside 40 Hz - 16 kHz), for packing next to the spectrum
+	void fillBandRow(const AudioFeatures& features, float* row) const;
+
+private:
+	struct BinRange {
+		int first;
+		int last; // exclusive
+	};
+
+	BinRange rangeFor(float loHz, float hiHz) const;
+	static float bandLevel(const float* magnitudes, BinRange range);
+
+	int bins;
+	float binHz;
+	BinRange bandRanges[AUDIO_BAND_COUNT];
+	BinRange bassRange;
+	BinRange midRange;
+	BinRange trebleRange;
+};
+
+#endif // AUDIO_FEATURES_H
@@ -0,0 +1,93 @@
+/*
+Shader Fun - Real-input spectrum analysis
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include "audio_fft.h"
+#include "audio_simd.h"
+
+const char* fftWindowName(FftWindow window) {
+	switch (window) {
+	case FFT_WINDOW_NONE:     return "none";
+	case FFT_WINDOW_HANN:     return "hann";
+	case FFT_WINDOW_BLACKMAN: return "blackman";
+	default:                  return "unknown";
+	}
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer()
+	: cfg(nullptr), size(0), window(FFT_WINDOW_HANN), magScale(1.0f) {
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+	release();
+}
+
+bool SpectrumAnalyzer::init(int fftSize, FftWindow win) {
+	release();
+
+	if (fftSize < 4 || (fftSize & 1)) {
+		printf("SpectrumAnalyzer: invalid FFT size %d\n", fftSize);
+		return false;
+	}
+
+	cfg = kiss_fftr_alloc(fftSize, 0, NULL, NULL);
+	if (!cfg) {
+		printf("SpectrumAnalyzer: kiss_fftr_alloc(%d) failed\n", fftSize);
+		return false;
+	}
+
+	size = fftSize;
+	windowTable.resize(size);
+	windowed.resize(size);
+	freq.resize(size / 2 + 1);
+	setWindow(win);
+	return true;
+}
+
+void SpectrumAnalyzer::release() {
+	if (cfg) {
+		kiss_fftr_free(cfg);
+		cfg = nullptr;
+	}
+	size = 0;
+}
+
+void SpectrumAnalyzer::setWindow(FftWindow win) {
+	window = win;
+	if (size == 0) return;
+
+	// Periodic windows (denominator N) - the right choice for spectral analysis
+	const double twoPi = 6.283185307179586;
+	double sum = 0.0;
+	for (int i = 0; i < size; i++) {
+		double x = twoPi * i / size;
+		double w;
+		switch (window) {
+		case FFT_WINDOW_HANN:
+			w = 0.5 - 0.5 * cos(x);
+			break;
+		case FFT_WINDOW_BLACKMAN:
+			w = 0.42 - 0.5 * cos(x) + 0.08 * cos(2.0 * x);
+			break;
+		default:
+			w = 1.0;
+			break;
+		}
+		windowTable[i] = (float)w;
+		sum += w;
+	}
+
+	// Coherent gain: a full-scale sine lands at sum(w) / 2 in its bin
+	magScale = (float)(2.0 / sum);
+}
+
+void SpectrumAnalyzer::analyze(const float* in, float* magnitudes) {
+	if (!cfg) return;
+
+	audioMultiply(in, windowTable.data(), windowed.data(), size);
+	kiss_fftr(cfg, windowed.data(), freq.data());
+	audioMagnitudes(freq.data(), magnitudes, size / 2, magScale);
+}
@@ -0,0 +1,60 @@
+/*
+Shader Fun - Real-input spectrum analysis
+Created By MrDude
+*/
+
+#ifndef AUDIO_FFT_H
+#define AUDIO_FFT_H
+
+#include <vector>
+#include "kiss_fftr.h"
+
+enum FftWindow {
+	FFT_WINDOW_NONE,
+	FFT_WINDOW_HANN,
+	FFT_WINDOW_BLACKMAN
+};
+
+const char* fftWindowName(FftWindow window);
+
+// Windowed real-input FFT. Wraps kiss_fftr (an N/2 complex FFT plus a
+// split pass) so a real block costs roughly half a full complex kiss_fft.
+// Magnitudes are scaled by the window's coherent gain, so a full-scale
+// sine reads ~1.0 whatever window is selected.
+class SpectrumAnalyzer {
+public:
+	SpectrumAnalyzer();
+	~SpectrumAnalyzer();
+
+	// fftSize must be even (power of two recommended)
+	bool init(int fftSize, FftWindow window);
+	void release();
+
+	// Swap the window table (precomputed, no per-sample trig)
+	void setWindow(FftWindow window);
+	FftWindow getWindow() const { return window; }
+	int getSize() const { return size; }
+
+	// in: getSize() real samples
+	// magnitudes: getSize() / 2 bins (DC .. Nyquist-1)
+	void analyze(const float* in, float* magnitudes);
+
+	// Raw bins of the last analyze() call, getSize() / 2 + 1 entries
+	const kiss_fft_cpx* getBins() const { return freq.data(); }
+	// Factor analyze() applies to |bin| (window coherent gain)
+	float getMagnitudeScale() const { return magScale; }
+
+private:
+	SpectrumAnalyzer(const SpectrumAnalyzer&);
+	SpectrumAnalyzer& operator=(const SpectrumAnalyzer&);
+
+	kiss_fftr_cfg cfg;
+	int size;
+	FftWindow window;
+	float magScale;
+	std::vector<float> windowTable;
+	std::vector<float> windowed;
+	std::vector<kiss_fft_cpx> freq;
+};
+
+#endif // AUDIO_FFT_H
@@ -0,0 +1,123 @@
+/*
+Shader Fun - Audio capture ring buffer
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "audio_ring.h"
+
+AudioRing::AudioRing()
+	: data(nullptr), capacity(0), mask(0), channels(1), sampleRate(44100), maxBlock(0), writePos(0) {
+}
+
+AudioRing::~AudioRing() {
+	release();
+}
+
+bool AudioRing::init(int capacityFrames, int numChannels, int rate) {
+	release();
+
+	if (capacityFrames <= 0 || numChannels <= 0) {
+		return false;
+	}
+
+	uint32_t cap = 1;
+	while (cap < (uint32_t)capacityFrames) {
+		cap <<= 1;
+	}
+
+	data = (float*)calloc((size_t)cap * numChannels, sizeof(float));
+	if (!data) {
+		printf("AudioRing: failed to allocate %u frames\n", cap);
+		return false;
+	}
+
+	capacity = cap;
+	mask = cap - 1;
+	channels = numChannels;
+	sampleRate = rate;
+	maxBlock.store(0, std::memory_order_relaxed);
+	writePos.store(0, std::memory_order_release);
+
+	printf("AudioRing: %u frames x %d channels (%.1f s @ %d Hz)\n",
+		capacity, channels, capacity / (float)sampleRate, sampleRate);
+	return true;
+}
+
+void AudioRing::release() {
+	if (data) {
+		free(data);
+		data = nullptr;
+	}
+	capacity = 0;
+	mask = 0;
+}
+
+void AudioRing::write(const float* frames, int frameCount) {
+	if (!data || frameCount <= 0) return;
+
+	// Only the newest `capacity` frames of an oversized block can survive
+	if ((uint32_t)frameCount > capacity) {
+		frames += (size_t)(frameCount - capacity) * channels;
+		frameCount = (int)capacity;
+	}
+
+	if ((uint32_t)frameCount > maxBlock.load(std::memory_order_relaxed)) {
+		maxBlock.store((uint32_t)frameCount, std::memory_order_relaxed);
+	}
+
+	uint64_t pos = writePos.load(std::memory_order_relaxed);
+	uint32_t start = (uint32_t)(pos & mask);
+	uint32_t first = capacity - start;
+	if (first > (uint32_t)frameCount) first = (uint32_t)frameCount;
+
+	memcpy(data + (size_t)start * channels, frames, (size_t)first * channels * sizeof(float));
+	if ((uint32_t)frameCount > first) {
+		memcpy(data, frames + (size_t)first * channels,
+			(size_t)(frameCount - first) * channels * sizeof(float));
+	}
+
+	// Publish: frames become visible to the reader only after the copy
+	writePos.store(pos + frameCount, std::memory_order_release);
+}
+
+uint64_t AudioRing::oldestReadable() const {
+	uint64_t pos = writePos.load(std::memory_order_acquire);
+	uint64_t guard = (uint64_t)capacity - maxBlock.load(std::memory_order_relaxed);
+	return pos > guard ? pos - guard : 0;
+}
+
+bool AudioRing::readWindow(uint64_t endFrame, int frameCount, float* out) const {
+	if (!data || frameCount <= 0 || (uint32_t)frameCount > capacity) return false;
+
+	uint64_t published = writePos.load(std::memory_order_acquire);
+	if (endFrame > published) return false;
+
+	// Anything before sample 0 is silence
+	int silent = 0;
+	if (endFrame < (uint64_t)frameCount) {
+		silent = frameCount - (int)endFrame;
+		memset(out, 0, (size_t)silent * channels * sizeof(float));
+	}
+
+	uint64_t startFrame = endFrame - (frameCount - silent);
+	if (startFrame < oldestReadable()) return false;
+
+	float* dst = out + (size_t)silent * channels;
+	uint32_t count = (uint32_t)(frameCount - silent);
+	uint32_t start = (uint32_t)(startFrame & mask);
+	uint32_t first = capacity - start;
+	if (first > count) first = count;
+
+	memcpy(dst, data + (size_t)start * channels, (size_t)first * channels * sizeof(float));
+	if (count > first) {
+		memcpy(dst + (size_t)first * channels, data, (size_t)(count - first) * channels * sizeof(float));
+	}
+
+	// Seqlock-style validation: if the producer lapped us while copying, the
+	// copy may contain frames from two different passes around the ring.
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return startFrame >= oldestReadable();
+}
@@ -0,0 +1,65 @@
+/*
+Shader Fun - Audio capture ring buffer
+Created By MrDude
+*/
+
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Single-producer / single-consumer lock-free ring of float PCM frames.
+// The mixer thread writes blocks with write(); the render thread pulls
+// contiguous windows with readWindow(). Every frame is addressed by its
+// absolute sample counter (frames written since init), so the reader can
+// ask for "the N frames ending at sample X" and gets either a coherent
+// copy or false - never a torn mix of old and new blocks. The producer
+// never waits on the consumer.
+class AudioRing {
+public:
+	AudioRing();
+	~AudioRing();
+
+	// Allocate room for at least capacityFrames frames (rounded up to a
+	// power of two). Must be called before the producer starts.
+	bool init(int capacityFrames, int channels, int sampleRate);
+	void release();
+
+	// === Producer (audio thread) ===
+	// frames is interleaved, frameCount * channels floats.
+	void write(const float* frames, int frameCount);
+
+	// === Consumer (render thread) ===
+	// Absolute sample counter one past the newest published frame.
+	uint64_t writePosition() const { return writePos.load(std::memory_order_acquire); }
+
+	// Copy the frameCount frames ending at endFrame (exclusive) into out,
+	// interleaved. Frames before sample 0 read as silence. Returns false if
+	// endFrame has not been written yet or the range has already been
+	// overwritten by the producer.
+	bool readWindow(uint64_t endFrame, int frameCount, float* out) const;
+
+	// Oldest frame still guaranteed to be readable.
+	uint64_t oldestReadable() const;
+
+	int getChannels() const { return channels; }
+	int getSampleRate() const { return sampleRate; }
+	uint32_t getCapacity() const { return capacity; }
+
+private:
+	AudioRing(const AudioRing&);
+	AudioRing& operator=(const AudioRing&);
+
+	float* data;
+	uint32_t capacity;      // frames, power of two
+	uint32_t mask;
+	int channels;
+	int sampleRate;
+	// Largest block the producer has written in one go. The reader treats
+	// that many frames past the write position as "possibly being written".
+	std::atomic<uint32_t> maxBlock;
+	std::atomic<uint64_t> writePos;
+};
+
+#endif // AUDIO_RING_H
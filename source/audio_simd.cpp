@@ -0,0 +1,533 @@
+/*
+Shader Fun - Vectorised audio kernels
+Created By MrDude
+*/
+
+#include <math.h>
+#include <string.h>
+#include "audio_simd.h"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AUDIO_SIMD_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define AUDIO_SIMD_SSE2 1
+#endif
+
+static const float S16_SCALE = 1.0f / 32768.0f;
+static const float S32_SCALE = 1.0f / 2147483648.0f;
+static const float DOWNMIX_M3DB = 0.70710678f;
+static const float DB_PER_LN = 8.685889638f;   // 20 / ln(10)
+static const float MIN_MAGNITUDE = 1e-20f;
+
+// === Scalar reference kernels ===
+
+void audioMultiplyScalar(const float* a, const float* b, float* out, int count) {
+	for (int i = 0; i < count; i++) {
+		out[i] = a[i] * b[i];
+	}
+}
+
+void audioMagnitudesScalar(const kiss_fft_cpx* bins, float* out, int count, float scale) {
+	for (int i = 0; i < count; i++) {
+		out[i] = sqrtf(bins[i].r * bins[i].r + bins[i].i * bins[i].i) * scale;
+	}
+}
+
+void audioDecibelsScalar(const float* in, float* out, int count, float floorDb) {
+	float invRange = -1.0f / floorDb;
+	for (int i = 0; i < count; i++) {
+		float x = in[i] > MIN_MAGNITUDE ? in[i] : MIN_MAGNITUDE;
+		float v = (20.0f * log10f(x) - floorDb) * invRange;
+		out[i] = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+	}
+}
+
+void audioNormalizeScalar(float* data, int count, float gain) {
+	for (int i = 0; i < count; i++) {
+		float v = data[i] * gain;
+		data[i] = v > 1.0f ? 1.0f : v;
+	}
+}
+
+float audioPeakScalar(const float* data, int count) {
+	float peak = 0.0f;
+	for (int i = 0; i < count; i++) {
+		if (data[i] > peak) peak = data[i];
+	}
+	return peak;
+}
+
+void audioS16ToFloatScalar(const int16_t* in, float* out, int count) {
+	for (int i = 0; i < count; i++) {
+		out[i] = in[i] * S16_SCALE;
+	}
+}
+
+void audioS16StereoToFloatScalar(const int16_t* in, float* left, float* right, int frames) {
+	for (int i = 0; i < frames; i++) {
+		left[i] = in[i * 2] * S16_SCALE;
+		if (right) right[i] = in[i * 2 + 1] * S16_SCALE;
+	}
+}
+
+void audioS32ToFloatScalar(const int32_t* in, float* out, int count) {
+	for (int i = 0; i < count; i++) {
+		out[i] = in[i] * S32_SCALE;
+	}
+}
+
+void audioMonoToStereoScalar(const float* in, float* out, int frames) {
+	for (int i = 0; i < frames; i++) {
+		out[i * 2] = in[i];
+		out[i * 2 + 1] = in[i];
+	}
+}
+
+void audioDownmix51Scalar(const float* in, float* out, int frames) {
+	for (int i = 0; i < frames; i++) {
+		const float* f = in + i * 6;
+		float c = f[2] * DOWNMIX_M3DB;
+		out[i * 2] = f[0] + c + f[4] * DOWNMIX_M3DB;
+		out[i * 2 + 1] = f[1] + c + f[5] * DOWNMIX_M3DB;
+	}
+}
+
+void audioFloatToHalfScalar(const float* in, uint16_t* out, int count) {
+	for (int i = 0; i < count; i++) {
+		uint32_t bits;
+		memcpy(&bits, &in[i], sizeof(bits));
+		uint32_t sign = (bits >> 16) & 0x8000;
+		int32_t exp = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+		uint32_t mant = bits & 0x007fffff;
+
+		if (exp <= 0) {
+			out[i] = (uint16_t)sign;              // too small (and NaN-free input assumed)
+		}
+		else if (exp >= 31) {
+			out[i] = (uint16_t)(sign | 0x7bff);   // saturate to the largest half
+		}
+		else {
+			// Round to nearest, ties to even; a carry correctly bumps the exponent
+			uint32_t half = ((uint32_t)exp << 10) | (mant >> 13);
+			uint32_t rest = mant & 0x1fff;
+			if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+			if (half >= 0x7c00) half = 0x7bff;
+			out[i] = (uint16_t)(sign | half);
+		}
+	}
+}
+
+void audioFloatToUnorm8Scalar(const float* in, uint8_t* out, int count, float scale, float bias) {
+	for (int i = 0; i < count; i++) {
+		float v = in[i] * scale + bias;
+		v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+		out[i] = (uint8_t)(v * 255.0f + 0.5f);
+	}
+}
+
+#if defined(AUDIO_SIMD_NEON)
+
+// === NEON (AArch64) ===
+
+const char* audioSimdBackend(void) { return "neon"; }
+
+// Natural log for x > 0: split exponent/mantissa, fold the mantissa into
+// [sqrt(1/2), sqrt(2)) and use the atanh series (error < 1e-7)
+static inline float32x4_t neonLog(float32x4_t x) {
+	int32x4_t bits = vreinterpretq_s32_f32(x);
+	int32x4_t e = vsubq_s32(vshrq_n_s32(bits, 23), vdupq_n_s32(127));
+	float32x4_t m = vreinterpretq_f32_s32(vorrq_s32(vandq_s32(bits, vdupq_n_s32(0x007fffff)), vdupq_n_s32(0x3f800000)));
+	uint32x4_t big = vcgtq_f32(m, vdupq_n_f32(1.41421356f));
+	m = vbslq_f32(big, vmulq_n_f32(m, 0.5f), m);
+	e = vsubq_s32(e, vreinterpretq_s32_u32(big)); // big lanes are -1
+	float32x4_t s = vdivq_f32(vsubq_f32(m, vdupq_n_f32(1.0f)), vaddq_f32(m, vdupq_n_f32(1.0f)));
+	float32x4_t s2 = vmulq_f32(s, s);
+	float32x4_t p = vfmaq_f32(vdupq_n_f32(1.0f / 5.0f), s2, vdupq_n_f32(1.0f / 7.0f));
+	p = vfmaq_f32(vdupq_n_f32(1.0f / 3.0f), s2, p);
+	p = vfmaq_f32(vdupq_n_f32(1.0f), s2, p);
+	float32x4_t lnm = vmulq_f32(vmulq_n_f32(s, 2.0f), p);
+	return vfmaq_f32(lnm, vcvtq_f32_s32(e), vdupq_n_f32(0.69314718f));
+}
+
+void audioMultiply(const float* a, const float* b, float* out, int count) {
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		vst1q_f32(out + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+	}
+	audioMultiplyScalar(a + i, b + i, out + i, count - i);
+}
+
+void audioMagnitudes(const kiss_fft_cpx* bins, float* out, int count, float scale) {
+	const float* src = (const float*)bins;
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		float32x4x2_t c = vld2q_f32(src + i * 2);
+		float32x4_t power = vfmaq_f32(vmulq_f32(c.val[0], c.val[0]), c.val[1], c.val[1]);
+		vst1q_f32(out + i, vmulq_n_f32(vsqrtq_f32(power), scale));
+	}
+	audioMagnitudesScalar(bins + i, out + i, count - i, scale);
+}
+
+void audioDecibels(const float* in, float* out, int count, float floorDb) {
+	float invRange = -1.0f / floorDb;
+	float32x4_t k = vdupq_n_f32(DB_PER_LN * invRange);
+	float32x4_t offset = vdupq_n_f32(-floorDb * invRange);
+	float32x4_t minMag = vdupq_n_f32(MIN_MAGNITUDE);
+	float32x4_t zero = vdupq_n_f32(0.0f);
+	float32x4_t one = vdupq_n_f32(1.0f);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		float32x4_t x = vmaxq_f32(vld1q_f32(in + i), minMag);
+		float32x4_t v = vfmaq_f32(offset, neonLog(x), k);
+		vst1q_f32(out + i, vminq_f32(vmaxq_f32(v, zero), one));
+	}
+	audioDecibelsScalar(in + i, out + i, count - i, floorDb);
+}
+
+void audioNormalize(float* data, int count, float gain) {
+	float32x4_t one = vdupq_n_f32(1.0f);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		vst1q_f32(data + i, vminq_f32(vmulq_n_f32(vld1q_f32(data + i), gain), one));
+	}
+	audioNormalizeScalar(data + i, count - i, gain);
+}
+
+float audioPeak(const float* data, int count) {
+	float32x4_t peak = vdupq_n_f32(0.0f);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		peak = vmaxq_f32(peak, vld1q_f32(data + i));
+	}
+	float p = vmaxvq_f32(peak);
+	float tail = audioPeakScalar(data + i, count - i);
+	return tail > p ? tail : p;
+}
+
+void audioS16ToFloat(const int16_t* in, float* out, int count) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		int16x8_t s = vld1q_s16(in + i);
+		vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), S16_SCALE));
+		vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), S16_SCALE));
+	}
+	audioS16ToFloatScalar(in + i, out + i, count - i);
+}
+
+void audioS16StereoToFloat(const int16_t* in, float* left, float* right, int frames) {
+	int i = 0;
+	for (; i + 8 <= frames; i += 8) {
+		int16x8x2_t s = vld2q_s16(in + i * 2);
+		vst1q_f32(left + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s.val[0]))), S16_SCALE));
+		vst1q_f32(left + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s.val[0]))), S16_SCALE));
+		if (right) {
+			vst1q_f32(right + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s.val[1]))), S16_SCALE));
+			vst1q_f32(right + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s.val[1]))), S16_SCALE));
+		}
+	}
+	audioS16StereoToFloatScalar(in + i * 2, left + i, right ? right + i : nullptr, frames - i);
+}
+
+void audioS32ToFloat(const int32_t* in, float* out, int count) {
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		// Fixed-point convert: 31 fractional bits is exactly the [-1, 1) scale
+		vst1q_f32(out + i, vcvtq_n_f32_s32(vld1q_s32(in + i), 31));
+	}
+	audioS32ToFloatScalar(in + i, out + i, count - i);
+}
+
+void audioMonoToStereo(const float* in, float* out, int frames) {
+	int i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		float32x4_t m = vld1q_f32(in + i);
+		float32x4x2_t lr = { { m, m } };
+		vst2q_f32(out + i * 2, lr);
+	}
+	audioMonoToStereoScalar(in + i, out + i * 2, frames - i);
+}
+
+void audioDownmix51(const float* in, float* out, int frames) {
+	int i = 0;
+	for (; i + 2 <= frames; i += 2) {
+		// Treat each channel pair as one 64-bit lane: FL/FR, FC/LFE, BL/BR
+		float64x2x3_t p = vld3q_f64((const double*)(in + i * 6));
+		float32x4_t front = vreinterpretq_f32_f64(p.val[0]);
+		float32x4_t centre = vreinterpretq_f32_f64(p.val[1]);
+		float32x4_t back = vreinterpretq_f32_f64(p.val[2]);
+		centre = vtrn1q_f32(centre, centre); // FC0 FC0 FC1 FC1
+		float32x4_t mix = vfmaq_n_f32(front, vaddq_f32(centre, back), DOWNMIX_M3DB);
+		vst1q_f32(out + i * 2, mix);
+	}
+	audioDownmix51Scalar(in + i * 6, out + i * 2, frames - i);
+}
+
+// What the scalar conversion keeps of x: overflow saturates to the
+// largest half (the hardware convert would give infinity) and anything
+// below the smallest normal half flushes to a signed zero (it would give
+// a subnormal)
+static inline float32x4_t neonHalfRange(float32x4_t x) {
+	const float32x4_t limit = vdupq_n_f32(65504.0f);
+	x = vmaxq_f32(vminq_f32(x, limit), vnegq_f32(limit));
+	uint32x4_t tiny = vcaltq_f32(x, vdupq_n_f32(6.103515625e-05f)); // 2^-14
+	return vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(x), vandq_u32(tiny, vdupq_n_u32(0x7fffffff))));
+}
+
+void audioFloatToHalf(const float* in, uint16_t* out, int count) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		float32x4_t a = neonHalfRange(vld1q_f32(in + i));
+		float32x4_t b = neonHalfRange(vld1q_f32(in + i + 4));
+		float16x8_t h = vcombine_f16(vcvt_f16_f32(a), vcvt_f16_f32(b));
+		vst1q_u16(out + i, vreinterpretq_u16_f16(h));
+	}
+	audioFloatToHalfScalar(in + i, out + i, count - i);
+}
+
+void audioFloatToUnorm8(const float* in, uint8_t* out, int count, float scale, float bias) {
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+	const float32x4_t one = vdupq_n_f32(1.0f);
+	const float32x4_t b = vdupq_n_f32(bias);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		float32x4_t lo = vfmaq_n_f32(b, vld1q_f32(in + i), scale);
+		float32x4_t hi = vfmaq_n_f32(b, vld1q_f32(in + i + 4), scale);
+		lo = vmulq_n_f32(vminq_f32(vmaxq_f32(lo, zero), one), 255.0f);
+		hi = vmulq_n_f32(vminq_f32(vmaxq_f32(hi, zero), one), 255.0f);
+		uint16x8_t w = vcombine_u16(vmovn_u32(vcvtnq_u32_f32(lo)), vmovn_u32(vcvtnq_u32_f32(hi)));
+		vst1_u8(out + i, vmovn_u16(w));
+	}
+	audioFloatToUnorm8Scalar(in + i, out + i, count - i, scale, bias);
+}
+
+#elif defined(AUDIO_SIMD_SSE2)
+
+// === SSE2 (x86 hosts) ===
+
+const char* audioSimdBackend(void) { return "sse2"; }
+
+static inline __m128 sseLog(__m128 x) {
+	__m128i bits = _mm_castps_si128(x);
+	__m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+	__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+	__m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+	m = _mm_or_ps(_mm_and_ps(big, _mm_mul_ps(m, _mm_set1_ps(0.5f))), _mm_andnot_ps(big, m));
+	e = _mm_sub_epi32(e, _mm_castps_si128(big)); // big lanes are -1
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 s = _mm_div_ps(_mm_sub_ps(m, one), _mm_add_ps(m, one));
+	__m128 s2 = _mm_mul_ps(s, s);
+	__m128 p = _mm_add_ps(_mm_set1_ps(1.0f / 5.0f), _mm_mul_ps(s2, _mm_set1_ps(1.0f / 7.0f)));
+	p = _mm_add_ps(_mm_set1_ps(1.0f / 3.0f), _mm_mul_ps(s2, p));
+	p = _mm_add_ps(one, _mm_mul_ps(s2, p));
+	__m128 lnm = _mm_mul_ps(_mm_add_ps(s, s), p);
+	return _mm_add_ps(lnm, _mm_mul_ps(_mm_cvtepi32_ps(e), _mm_set1_ps(0.69314718f)));
+}
+
+void audioMultiply(const float* a, const float* b, float* out, int count) {
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+	audioMultiplyScalar(a + i, b + i, out + i, count - i);
+}
+
+void audioMagnitudes(const kiss_fft_cpx* bins, float* out, int count, float scale) {
+	const float* src = (const float*)bins;
+	__m128 k = _mm_set1_ps(scale);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 a = _mm_loadu_ps(src + i * 2);      // r0 i0 r1 i1
+		__m128 b = _mm_loadu_ps(src + i * 2 + 4);  // r2 i2 r3 i3
+		__m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		__m128 power = _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im));
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_sqrt_ps(power), k));
+	}
+	audioMagnitudesScalar(bins + i, out + i, count - i, scale);
+}
+
+void audioDecibels(const float* in, float* out, int count, float floorDb) {
+	float invRange = -1.0f / floorDb;
+	__m128 k = _mm_set1_ps(DB_PER_LN * invRange);
+	__m128 offset = _mm_set1_ps(-floorDb * invRange);
+	__m128 minMag = _mm_set1_ps(MIN_MAGNITUDE);
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_max_ps(_mm_loadu_ps(in + i), minMag);
+		__m128 v = _mm_add_ps(_mm_mul_ps(sseLog(x), k), offset);
+		_mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(v, zero), one));
+	}
+	audioDecibelsScalar(in + i, out + i, count - i, floorDb);
+}
+
+void audioNormalize(float* data, int count, float gain) {
+	__m128 g = _mm_set1_ps(gain);
+	__m128 one = _mm_set1_ps(1.0f);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(data + i, _mm_min_ps(_mm_mul_ps(_mm_loadu_ps(data + i), g), one));
+	}
+	audioNormalizeScalar(data + i, count - i, gain);
+}
+
+float audioPeak(const float* data, int count) {
+	__m128 peak = _mm_setzero_ps();
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		peak = _mm_max_ps(peak, _mm_loadu_ps(data + i));
+	}
+	peak = _mm_max_ps(peak, _mm_shuffle_ps(peak, peak, _MM_SHUFFLE(1, 0, 3, 2)));
+	peak = _mm_max_ps(peak, _mm_shuffle_ps(peak, peak, _MM_SHUFFLE(2, 3, 0, 1)));
+	float p = _mm_cvtss_f32(peak);
+	float tail = audioPeakScalar(data + i, count - i);
+	return tail > p ? tail : p;
+}
+
+void audioS16ToFloat(const int16_t* in, float* out, int count) {
+	__m128 k = _mm_set1_ps(S16_SCALE);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(in + i));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+		_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+	}
+	audioS16ToFloatScalar(in + i, out + i, count - i);
+}
+
+void audioS16StereoToFloat(const int16_t* in, float* left, float* right, int frames) {
+	__m128 k = _mm_set1_ps(S16_SCALE);
+	int i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		// Each 32-bit lane holds one L/R frame: L in the low half
+		__m128i s = _mm_loadu_si128((const __m128i*)(in + i * 2));
+		__m128i l = _mm_srai_epi32(_mm_slli_epi32(s, 16), 16);
+		_mm_storeu_ps(left + i, _mm_mul_ps(_mm_cvtepi32_ps(l), k));
+		if (right) {
+			__m128i r = _mm_srai_epi32(s, 16);
+			_mm_storeu_ps(right + i, _mm_mul_ps(_mm_cvtepi32_ps(r), k));
+		}
+	}
+	audioS16StereoToFloatScalar(in + i * 2, left + i, right ? right + i : nullptr, frames - i);
+}
+
+void audioS32ToFloat(const int32_t* in, float* out, int count) {
+	__m128 k = _mm_set1_ps(S32_SCALE);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(in + i));
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(s), k));
+	}
+	audioS32ToFloatScalar(in + i, out + i, count - i);
+}
+
+void audioMonoToStereo(const float* in, float* out, int frames) {
+	int i = 0;
+	for (; i + 4 <= frames; i += 4) {
+		__m128 m = _mm_loadu_ps(in + i);
+		_mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(m, m));
+		_mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(m, m));
+	}
+	audioMonoToStereoScalar(in + i, out + i * 2, frames - i);
+}
+
+void audioDownmix51(const float* in, float* out, int frames) {
+	__m128 k = _mm_set1_ps(DOWNMIX_M3DB);
+	int i = 0;
+	for (; i + 2 <= frames; i += 2) {
+		// Two frames: a = FL0 FR0 FC0 LFE0, b = BL0 BR0 FL1 FR1, c = FC1 LFE1 BL1 BR1
+		const float* f = in + i * 6;
+		__m128 a = _mm_loadu_ps(f);
+		__m128 b = _mm_loadu_ps(f + 4);
+		__m128 c = _mm_loadu_ps(f + 8);
+		__m128 front = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 2, 1, 0));
+		__m128 back = _mm_shuffle_ps(b, c, _MM_SHUFFLE(3, 2, 1, 0));
+		__m128 centre = _mm_shuffle_ps(a, c, _MM_SHUFFLE(0, 0, 2, 2));
+		_mm_storeu_ps(out + i * 2, _mm_add_ps(front, _mm_mul_ps(_mm_add_ps(centre, back), k)));
+	}
+	audioDownmix51Scalar(in + i * 6, out + i * 2, frames - i);
+}
+
+void audioFloatToHalf(const float* in, uint16_t* out, int count) {
+	// No half conversion before F16C; SSE2 hosts only run the benchmark
+	audioFloatToHalfScalar(in, out, count);
+}
+
+void audioFloatToUnorm8(const float* in, uint8_t* out, int count, float scale, float bias) {
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 k = _mm_set1_ps(255.0f);
+	const __m128 s = _mm_set1_ps(scale);
+	const __m128 b = _mm_set1_ps(bias);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128 lo = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i), s), b);
+		__m128 hi = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i + 4), s), b);
+		lo = _mm_mul_ps(_mm_min_ps(_mm_max_ps(lo, zero), one), k);
+		hi = _mm_mul_ps(_mm_min_ps(_mm_max_ps(hi, zero), one), k);
+		__m128i w = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+		_mm_storel_epi64((__m128i*)(out + i), _mm_packus_epi16(w, w));
+	}
+	audioFloatToUnorm8Scalar(in + i, out + i, count - i, scale, bias);
+}
+
+#else
+
+// === Plain C fallback ===
+
+const char* audioSimdBackend(void) { return "scalar"; }
+
+void audioMultiply(const float* a, const float* b, float* out, int count) {
+	audioMultiplyScalar(a, b, out, count);
+}
+
+void audioMagnitudes(const kiss_fft_cpx* bins, float* out, int count, float scale) {
+	audioMagnitudesScalar(bins, out, count, scale);
+}
+
+void audioDecibels(const float* in, float* out, int count, float floorDb) {
+	audioDecibelsScalar(in, out, count, floorDb);
+}
+
+void audioNormalize(float* data, int count, float gain) {
+	audioNormalizeScalar(data, count, gain);
+}
+
+float audioPeak(const float* data, int count) {
+	return audioPeakScalar(data, count);
+}
+
+void audioS16ToFloat(const int16_t* in, float* out, int count) {
+	audioS16ToFloatScalar(in, out, count);
+}
+
+void audioS16StereoToFloat(const int16_t* in, float* left, float* right, int frames) {
+	audioS16StereoToFloatScalar(in, left, right, frames);
+}
+
+void audioS32ToFloat(const int32_t* in, float* out, int count) {
+	audioS32ToFloatScalar(in, out, count);
+}
+
+void audioMonoToStereo(const float* in, float* out, int frames) {
+	audioMonoToStereoScalar(in, out, frames);
+}
+
+void audioDownmix51(const float* in, float* out, int frames) {
+	audioDownmix51Scalar(in, out, frames);
+}
+
+void audioFloatToHalf(const float* in, uint16_t* out, int count) {
+	audioFloatToHalfScalar(in, out, count);
+}
+
+void audioFloatToUnorm8(const float* in, uint8_t* out, int count, float scale, float bias) {
+	audioFloatToUnorm8Scalar(in, out, count, scale, bias);
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+Shader Fun - Vectorised audio kernels
+Created By MrDude
+*/
+
+#ifndef AUDIO_SIMD_H
+#define AUDIO_SIMD_H
+
+#include <stdint.h>
+#include "kiss_fft.h"
+
+// Each kernel has a NEON (AArch64 / Switch), SSE2 (x86 hosts) and plain C
+// implementation; the best one for the target is picked at compile time.
+// The *Scalar variants are always available as a reference for the
+// host benchmark.
+
+// Name of the compiled-in backend: "neon", "sse2" or "scalar"
+const char* audioSimdBackend(void);
+
+// out[i] = a[i] * b[i]  (window application)
+void audioMultiply(const float* a, const float* b, float* out, int count);
+void audioMultiplyScalar(const float* a, const float* b, float* out, int count);
+
+// out[i] = |bins[i]| * scale
+void audioMagnitudes(const kiss_fft_cpx* bins, float* out, int count, float scale);
+void audioMagnitudesScalar(const kiss_fft_cpx* bins, float* out, int count, float scale);
+
+// Map linear magnitude to decibels, normalised so floorDb..0 dB -> 0..1
+// (clamped). floorDb must be negative, e.g. -80.
+void audioDecibels(const float* in, float* out, int count, float floorDb);
+void audioDecibelsScalar(const float* in, float* out, int count, float floorDb);
+
+// data[i] = min(data[i] * gain, 1)
+void audioNormalize(float* data, int count, float gain);
+void audioNormalizeScalar(float* data, int count, float gain);
+
+// Largest value in data (0 for an empty range)
+float audioPeak(const float* data, int count);
+float audioPeakScalar(const float* data, int count);
+
+// Signed 16-bit PCM -> float in [-1, 1)
+void audioS16ToFloat(const int16_t* in, float* out, int count);
+void audioS16ToFloatScalar(const int16_t* in, float* out, int count);
+
+// Interleaved stereo s16 -> separate float channels. right may be NULL.
+void audioS16StereoToFloat(const int16_t* in, float* left, float* right, int frames);
+void audioS16StereoToFloatScalar(const int16_t* in, float* left, float* right, int frames);
+
+// Signed 32-bit PCM -> float in [-1, 1)
+void audioS32ToFloat(const int32_t* in, float* out, int count);
+void audioS32ToFloatScalar(const int32_t* in, float* out, int count);
+
+// Mono -> interleaved stereo (both channels the same)
+void audioMonoToStereo(const float* in, float* out, int frames);
+void audioMonoToStereoScalar(const float* in, float* out, int frames);
+
+// Interleaved 5.1 (FL FR FC LFE BL BR, SDL order) -> interleaved stereo.
+// ITU downmix: centre and surrounds at -3 dB, LFE dropped.
+void audioDownmix51(const float* in, float* out, int frames);
+void audioDownmix51Scalar(const float* in, float* out, int frames);
+
+// float -> IEEE half (texture upload). Out of range values saturate to
+// +/-65504, tiny ones flush to zero.
+void audioFloatToHalf(const float* in, uint16_t* out, int count);
+void audioFloatToHalfScalar(const float* in, uint16_t* out, int count);
+
+// float -> 8-bit unorm: round(clamp(in * scale + bias, 0, 1) * 255)
+void audioFloatToUnorm8(const float* in, uint8_t* out, int count, float scale, float bias);
+void audioFloatToUnorm8Scalar(const float* in, uint8_t* out, int count, float scale, float bias);
+
+#endif // AUDIO_SIMD_H
@@ -0,0 +1,99 @@
+/*
+Shader Fun - Spectrum smoothing, peak-hold and auto-gain
+Created By MrDude
+*/
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "audio_smooth.h"
+#include "audio_simd.h"
+
+// AGC follows the loudest bin quickly on the way up and very slowly on the
+// way down, so a quiet bridge doesn't get pumped up to full scale.
+static const float AGC_ATTACK_SEC = 0.05f;
+static const float AGC_RELEASE_SEC = 8.0f;
+static const float AGC_MIN_GAIN = 0.25f;
+static const float AGC_MAX_GAIN = 64.0f;
+// Below this the input is treated as silence and the AGC stops adapting
+static const float AGC_SILENCE = 1e-4f;
+
+// One-pole coefficient for a time constant, frame-rate independent
+static float follow(float dt, float tauSec) {
+	return tauSec > 0.0f ? 1.0f - expf(-dt / tauSec) : 1.0f;
+}
+
+SpectrumSmoother::SpectrumSmoother()
+	: bins(0), attackSec(0.01f), releaseSec(0.15f), holdSec(0.5f), fallSec(0.3f),
+	agcEnabled(true), agcTarget(0.8f), agcLevel(0.1f), gain(1.0f) {
+}
+
+void SpectrumSmoother::configure(int numBins) {
+	bins = numBins > 0 ? numBins : 0;
+	envelope.assign(bins, 0.0f);
+	peak.assign(bins, 0.0f);
+	holdLeft.assign(bins, 0.0f);
+	output.assign((size_t)bins * 2, 0.0f);
+}
+
+void SpectrumSmoother::setTimes(float attackMs, float releaseMs, float holdMs, float fallMs) {
+	attackSec = std::max(attackMs, 0.0f) / 1000.0f;
+	releaseSec = std::max(releaseMs, 0.0f) / 1000.0f;
+	holdSec = std::max(holdMs, 0.0f) / 1000.0f;
+	fallSec = std::max(fallMs, 0.0f) / 1000.0f;
+}
+
+void SpectrumSmoother::setAgc(bool enabled, float target) {
+	agcEnabled = enabled;
+	agcTarget = std::min(std::max(target, 0.05f), 1.0f);
+	if (!agcEnabled) gain = 1.0f;
+}
+
+void SpectrumSmoother::reset() {
+	std::fill(envelope.begin(), envelope.end(), 0.0f);
+	std::fill(peak.begin(), peak.end(), 0.0f);
+	std::fill(holdLeft.begin(), holdLeft.end(), 0.0f);
+	std::fill(output.begin(), output.end(), 0.0f);
+}
+
+void SpectrumSmoother::update(const float* magnitudes, float dt) {
+	if (bins == 0 || !magnitudes) return;
+	if (dt < 0.0f) dt = 0.0f;
+	if (dt > 0.25f) dt = 0.25f; // don't jump after a stall
+
+	float up = follow(dt, attackSec);
+	float down = follow(dt, releaseSec);
+	float fall = follow(dt, fallSec);
+
+	for (int i = 0; i < bins; i++) {
+		float in = magnitudes[i];
+		float env = envelope[i];
+		env += (in > env ? up : down) * (in - env);
+		envelope[i] = env;
+
+		if (env >= peak[i]) {
+			peak[i] = env;
+			holdLeft[i] = holdSec;
+		}
+		else if (holdLeft[i] > 0.0f) {
+			holdLeft[i] -= dt;
+		}
+		else {
+			peak[i] += fall * (env - peak[i]);
+		}
+	}
+
+	if (agcEnabled) {
+		float loudest = audioPeak(envelope.data(), bins);
+		if (loudest > AGC_SILENCE) {
+			float tau = loudest > agcLevel ? AGC_ATTACK_SEC : AGC_RELEASE_SEC;
+			agcLevel += follow(dt, tau) * (loudest - agcLevel);
+		}
+		gain = agcTarget / std::max(agcLevel, AGC_SILENCE);
+		gain = std::min(std::max(gain, AGC_MIN_GAIN), AGC_MAX_GAIN);
+	}
+
+	memcpy(output.data(), envelope.data(), bins * sizeof(float));
+	memcpy(output.data() + bins, peak.data(), bins * sizeof(float));
+	audioNormalize(output.data(), bins * 2, gain);
+}
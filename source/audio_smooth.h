@@ -0,0 +1,60 @@
+/*
+Shader Fun - Spectrum smoothing, peak-hold and auto-gain
+Created By MrDude
+*/
+
+#ifndef AUDIO_SMOOTH_H
+#define AUDIO_SMOOTH_H
+
+#include <vector>
+
+// Turns the raw per-frame spectrum into something shaders can draw directly:
+//  - per-bin envelope follower (fast attack, slow release)
+//  - per-bin peak-hold that waits, then falls back towards the envelope
+//  - automatic gain control so quiet and loud tracks fill the same range
+// Run once per rendered frame. The output is two rows of `bins` floats,
+// 0..1: row 0 is the smoothed spectrum, row 1 the held peaks.
+class SpectrumSmoother {
+public:
+	SpectrumSmoother();
+
+	void configure(int bins);
+
+	// Envelope and peak timing in milliseconds
+	void setTimes(float attackMs, float releaseMs, float holdMs, float fallMs);
+	// target: level the loudest bin is scaled towards (0..1)
+	void setAgc(bool enabled, float target);
+	// Fixed gain while the AGC is off (e.g. to follow another smoother)
+	void setGain(float fixedGain) { if (!agcEnabled) gain = fixedGain; }
+
+	// Clear envelopes and peaks; the AGC keeps its level so the next
+	// track starts at a sensible gain
+	void reset();
+
+	// magnitudes: configured bin count, linear. dt: seconds since last call
+	void update(const float* magnitudes, float dt);
+
+	const float* getOutput() const { return output.data(); } // 2 rows
+	const float* getSmoothed() const { return output.data(); }
+	const float* getPeaks() const { return output.data() + bins; }
+	int getBins() const { return bins; }
+	float getGain() const { return gain; }
+
+private:
+	int bins;
+	float attackSec;
+	float releaseSec;
+	float holdSec;
+	float fallSec;
+	bool agcEnabled;
+	float agcTarget;
+	float agcLevel;
+	float gain;
+
+	std::vector<float> envelope;  // linear, before gain
+	std::vector<float> peak;      // linear, before gain
+	std::vector<float> holdLeft;  // seconds until each peak starts falling
+	std::vector<float> output;    // smoothed row then peak row, after gain
+};
+
+#endif // AUDIO_SMOOTH_H
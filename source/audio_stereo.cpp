@@ -0,0 +1,72 @@
+/*
+Shader Fun - Stereo spectra and phase correlation
+Created By MrDude
+*/
+
+#include <math.h>
+#include <string.h>
+#include "audio_stereo.h"
+
+StereoAnalyzer::StereoAnalyzer()
+	: size(0), bins(0), correlation(1.0f) {
+}
+
+void StereoAnalyzer::configure(int fftSize) {
+	size = fftSize > 0 ? fftSize : 0;
+	bins = size / 2;
+	correlation = 1.0f;
+	left.assign(size, 0.0f);
+	right.assign(size, 0.0f);
+	leftBins.resize(bins);
+	rows.assign((size_t)bins * STEREO_ROW_COUNT, 0.0f);
+}
+
+void StereoAnalyzer::analyze(SpectrumAnalyzer& fft, const float* interleaved, int channels) {
+	if (size == 0 || fft.getSize() != size || !interleaved) return;
+
+	float* leftMag = rows.data() + (size_t)STEREO_ROW_LEFT * bins;
+	float* rightMag = rows.data() + (size_t)STEREO_ROW_RIGHT * bins;
+	float* midMag = rows.data() + (size_t)STEREO_ROW_MID * bins;
+	float* sideMag = rows.data() + (size_t)STEREO_ROW_SIDE * bins;
+
+	if (channels < 2) {
+		fft.analyze(interleaved, leftMag);
+		memcpy(rightMag, leftMag, bins * sizeof(float));
+		memcpy(midMag, leftMag, bins * sizeof(float));
+		memset(sideMag, 0, bins * sizeof(float));
+		correlation = 1.0f;
+		return;
+	}
+
+	// Split the first two channels, gathering the correlation terms as we go
+	double lr = 0.0, ll = 0.0, rr = 0.0;
+	const float* src = interleaved;
+	for (int i = 0; i < size; i++) {
+		float l = src[0];
+		float r = src[1];
+		left[i] = l;
+		right[i] = r;
+		lr += l * r;
+		ll += l * l;
+		rr += r * r;
+		src += channels;
+	}
+	double norm = sqrt(ll * rr);
+	correlation = norm > 1e-12 ? (float)(lr / norm) : 1.0f; // silence reads as mono
+
+	fft.analyze(left.data(), leftMag);
+	memcpy(leftBins.data(), fft.getBins(), bins * sizeof(kiss_fft_cpx));
+	fft.analyze(right.data(), rightMag);
+
+	// mid = (L + R) / 2, side = (L - R) / 2, straight from the complex bins
+	const kiss_fft_cpx* rb = fft.getBins();
+	float scale = 0.5f * fft.getMagnitudeScale();
+	for (int i = 0; i < bins; i++) {
+		float mr = leftBins[i].r + rb[i].r;
+		float mi = leftBins[i].i + rb[i].i;
+		float sr = leftBins[i].r - rb[i].r;
+		float si = leftBins[i].i - rb[i].i;
+		midMag[i] = sqrtf(mr * mr + mi * mi) * scale;
+		sideMag[i] = sqrtf(sr * sr + si * si) * scale;
+	}
+}
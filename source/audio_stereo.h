@@ -0,0 +1,51 @@
+/*
+Shader Fun - Stereo spectra and phase correlation
+Created By MrDude
+*/
+
+#ifndef AUDIO_STEREO_H
+#define AUDIO_STEREO_H
+
+#include <vector>
+#include "audio_fft.h"
+
+const int STEREO_ROW_LEFT = 0;
+const int STEREO_ROW_RIGHT = 1;
+const int STEREO_ROW_MID = 2;
+const int STEREO_ROW_SIDE = 3;
+const int STEREO_ROW_COUNT = 4;
+
+// Left, right, mid and side spectra of one captured window, plus the
+// left/right phase correlation (+1 mono, 0 wide/uncorrelated, -1 out of
+// phase). Runs once per rendered frame on the newest STFT window and
+// borrows the STFT's analyzer, so both channels share one window table
+// and FFT plan. Only two FFTs are done: mid and side are built from the
+// left/right complex bins (the FFT is linear).
+class StereoAnalyzer {
+public:
+	StereoAnalyzer();
+
+	void configure(int fftSize);
+
+	// interleaved: fftSize frames of `channels` channels (first two used;
+	// mono input reads as fully correlated with no side signal)
+	void analyze(SpectrumAnalyzer& fft, const float* interleaved, int channels);
+
+	// STEREO_ROW_COUNT rows of getBins() magnitudes, same units as the
+	// mono spectrum
+	const float* getRows() const { return rows.data(); }
+	const float* getRow(int row) const { return rows.data() + (size_t)row * bins; }
+	int getBins() const { return bins; }
+	float getCorrelation() const { return correlation; }
+
+private:
+	int size;
+	int bins;
+	float correlation;
+	std::vector<float> left;
+	std::vector<float> right;
+	std::vector<kiss_fft_cpx> leftBins;
+	std::vector<float> rows;
+};
+
+#endif // AUDIO_STEREO_H
@@ -0,0 +1,152 @@
+/*
+Shader Fun - Short-time Fourier transform over the capture ring
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "audio_stft.h"
+
+static bool isPowerOfTwo(int n) {
+	return n > 0 && (n & (n - 1)) == 0;
+}
+
+StftEngine::StftEngine()
+	: ring(nullptr), size(0), hop(0), nextEnd(0), lastEnd(0), droppedHops(0), processedHops(0) {
+}
+
+bool StftEngine::init(AudioRing* audioRing, int fftSize, int hopSize, FftWindow window) {
+	ring = audioRing;
+	droppedHops = 0;
+	processedHops = 0;
+	return configure(fftSize, hopSize, window);
+}
+
+bool StftEngine::configure(int fftSize, int hopSize, FftWindow window) {
+	if (!ring) return false;
+
+	if (!isPowerOfTwo(fftSize) || fftSize < STFT_MIN_SIZE || fftSize > STFT_MAX_SIZE) {
+		printf("STFT: invalid window size %d (power of two, %d-%d)\n", fftSize, STFT_MIN_SIZE, STFT_MAX_SIZE);
+		return false;
+	}
+	if (hopSize < 1 || hopSize > fftSize) {
+		printf("STFT: invalid hop size %d for window %d\n", hopSize, fftSize);
+		return false;
+	}
+	if (hopSize < fftSize / STFT_MAX_OVERLAP) {
+		printf("STFT: hop %d raised to %d (window %d / %d)\n", hopSize, fftSize / STFT_MAX_OVERLAP, fftSize, STFT_MAX_OVERLAP);
+		hopSize = fftSize / STFT_MAX_OVERLAP;
+	}
+
+	if (fftSize != size) {
+		if (!analyzer.init(fftSize, window)) {
+			return false;
+		}
+		samples.assign(fftSize, 0.0f);
+		magnitudes.assign(fftSize / 2, 0.0f);
+		interleaved.resize((size_t)fftSize * ring->getChannels());
+	}
+	else if (window != analyzer.getWindow()) {
+		analyzer.setWindow(window);
+	}
+
+	size = fftSize;
+	hop = hopSize;
+
+	// Restart the hop grid at the newest audio
+	nextEnd = ring->writePosition();
+	lastEnd = nextEnd;
+
+	printf("STFT: window %d (%s), hop %d, %.1f Hz per bin, %.1f hops/s\n",
+		size, fftWindowName(window), hop, getBinHz(), ring->getSampleRate() / (float)hop);
+	return true;
+}
+
+float StftEngine::getBinHz() const {
+	return size > 0 ? ring->getSampleRate() / (float)size : 0.0f;
+}
+
+void StftEngine::addListener(StftListener fn, void* user) {
+	Listener l;
+	l.fn = fn;
+	l.user = user;
+	listeners.push_back(l);
+}
+
+bool StftEngine::readMono(uint64_t endFrame) {
+	int channels = ring->getChannels();
+	if (channels == 1) {
+		return ring->readWindow(endFrame, size, samples.data());
+	}
+
+	if (!ring->readWindow(endFrame, size, interleaved.data())) {
+		return false;
+	}
+	const float* src = interleaved.data();
+	float scale = 1.0f / channels;
+	for (int i = 0; i < size; i++) {
+		float sum = 0.0f;
+		for (int c = 0; c < channels; c++) {
+			sum += src[c];
+		}
+		samples[i] = sum * scale;
+		src += channels;
+	}
+	return true;
+}
+
+int StftEngine::process(uint64_t untilFrame, int maxHops) {
+	if (!ring || size == 0) return 0;
+
+	uint64_t published = ring->writePosition();
+	if (untilFrame > published) untilFrame = published;
+
+	// Fell behind further than the ring remembers - skip ahead on the grid.
+	// (Before the ring first wraps everything back to sample 0 is readable.)
+	uint64_t oldestStart = ring->oldestReadable();
+	uint64_t oldest = oldestStart + size;
+	if (oldestStart > 0 && nextEnd < oldest && untilFrame >= oldest) {
+		uint64_t skipped = (oldest - nextEnd + hop - 1) / hop;
+		nextEnd += skipped * hop;
+		droppedHops += skipped;
+	}
+
+	// More due than we may do: keep to the newest, as the screen shows now
+	if (maxHops > 0 && nextEnd <= untilFrame) {
+		uint64_t due = (untilFrame - nextEnd) / hop + 1;
+		if (due > (uint64_t)maxHops) {
+			uint64_t skipped = due - maxHops;
+			nextEnd += skipped * hop;
+			droppedHops += skipped;
+		}
+	}
+
+	int done = 0;
+	while (nextEnd <= untilFrame && done < maxHops) {
+		if (!readMono(nextEnd)) {
+			// Overwritten while copying; drop this hop and move on
+			droppedHops++;
+			nextEnd += hop;
+			continue;
+		}
+
+		analyzer.analyze(samples.data(), magnitudes.data());
+
+		StftFrame frame;
+		frame.endFrame = nextEnd;
+		frame.size = size;
+		frame.hop = hop;
+		frame.sampleRate = ring->getSampleRate();
+		frame.samples = samples.data();
+		frame.magnitudes = magnitudes.data();
+		for (size_t i = 0; i < listeners.size(); i++) {
+			listeners[i].fn(frame, listeners[i].user);
+		}
+
+		lastEnd = nextEnd;
+		nextEnd += hop;
+		processedHops++;
+		done++;
+	}
+	return done;
+}
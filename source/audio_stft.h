@@ -0,0 +1,99 @@
+/*
+Shader Fun - Short-time Fourier transform over the capture ring
+Created By MrDude
+*/
+
+#ifndef AUDIO_STFT_H
+#define AUDIO_STFT_H
+
+#include <stdint.h>
+#include <vector>
+#include "audio_ring.h"
+#include "audio_fft.h"
+
+const int STFT_MIN_SIZE = 256;
+const int STFT_MAX_SIZE = 4096;
+// Hops are at least fftSize / STFT_MAX_OVERLAP apart. Closer ones would
+// mostly be dropped by process() anyway, a frame only takes so many.
+const int STFT_MAX_OVERLAP = 8;
+
+// One analysed hop, handed to every listener
+struct StftFrame {
+	uint64_t endFrame;        // absolute sample counter one past the window
+	int size;                 // window length in samples
+	int hop;                  // hop length in samples
+	int sampleRate;
+	const float* samples;     // size mono samples (unwindowed)
+	const float* magnitudes;  // size / 2 bins, DC .. Nyquist-1
+};
+
+typedef void (*StftListener)(const StftFrame& frame, void* user);
+
+// Walks the capture ring on a fixed hop grid and analyses every hop, so
+// the analysis rate is set by the audio clock rather than the frame rate.
+// A slow render frame just means more hops to catch up on next time;
+// audio is only skipped if the renderer falls so far behind that the
+// ring has already recycled it.
+class StftEngine {
+public:
+	StftEngine();
+
+	// fftSize: power of two in [STFT_MIN_SIZE, STFT_MAX_SIZE]
+	// hopSize: fftSize / STFT_MAX_OVERLAP .. fftSize (smaller is raised)
+	// These are fixed until the next init(): the smoothers, analysers and
+	// audio textures are sized from getBins()/getSize() once it returns,
+	// so calling it again means configuring all of those again too.
+	bool init(AudioRing* ring, int fftSize, int hopSize, FftWindow window);
+
+	void addListener(StftListener fn, void* user);
+
+	// Analyse every hop whose window ends at or before untilFrame. Past
+	// maxHops only the newest maxHops are, so a long stall doesn't leave
+	// the analysis behind. Returns the number of hops analysed.
+	int process(uint64_t untilFrame, int maxHops = 64);
+
+	// Newest analysed hop
+	const float* getSamples() const { return samples.data(); }
+	const float* getMagnitudes() const { return magnitudes.data(); }
+	// Newest window exactly as captured, getChannels() interleaved channels
+	const float* getCaptured() const { return ring->getChannels() > 1 ? interleaved.data() : samples.data(); }
+	int getChannels() const { return ring ? ring->getChannels() : 1; }
+	uint64_t getLastEndFrame() const { return lastEnd; }
+
+	int getSize() const { return size; }
+	int getBins() const { return size / 2; }
+	int getHop() const { return hop; }
+	FftWindow getWindow() const { return analyzer.getWindow(); }
+	float getBinHz() const;
+
+	// The window/FFT plan, for extra analysis of the newest window
+	SpectrumAnalyzer& getAnalyzer() { return analyzer; }
+
+	// Hops lost because the ring had already overwritten them
+	uint64_t getDroppedHops() const { return droppedHops; }
+	uint64_t getProcessedHops() const { return processedHops; }
+
+private:
+	struct Listener {
+		StftListener fn;
+		void* user;
+	};
+
+	bool configure(int fftSize, int hopSize, FftWindow window);
+	bool readMono(uint64_t endFrame);
+
+	AudioRing* ring;
+	SpectrumAnalyzer analyzer;
+	int size;
+	int hop;
+	uint64_t nextEnd;
+	uint64_t lastEnd;
+	uint64_t droppedHops;
+	uint64_t processedHops;
+	std::vector<float> interleaved;
+	std::vector<float> samples;
+	std::vector<float> magnitudes;
+	std::vector<Listener> listeners;
+};
+
+#endif // AUDIO_STFT_H
@@ -0,0 +1,155 @@
+/*
+Shader Fun - Packed audio textures
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include "audio_textures.h"
+#include "audio_simd.h"
+#include "gl_state.h"
+
+#ifndef GL_HALF_FLOAT_OES
+#define GL_HALF_FLOAT_OES 0x8D61
+#endif
+
+static GLuint createTexture(int width, int height, GLenum type, GLint filter, const void* pixels) {
+	GLuint tex;
+	glGenTextures(1, &tex);
+	g_glState.editTexture(tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	// Allocate once; every later update is a glTexSubImage2D
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, type, pixels);
+	return tex;
+}
+
+AudioTextures::AudioTextures()
+	: waveTex(0), spectrumTex(0), format(AUDIO_TEX_RGBA8), texelType(GL_UNSIGNED_BYTE),
+	waveSize(0), bins(0) {
+	resetStats();
+}
+
+AudioTextures::~AudioTextures() {
+	release();
+}
+
+bool AudioTextures::init(int waveWidth, int binCount) {
+	release();
+	if (waveWidth <= 0 || binCount <= 0) return false;
+
+	// Half-float keeps the signed waveform and >1 levels exactly as shaders
+	// saw them with the old float textures. Without its linear extension it
+	// is still used, point sampled, rather than lose the sign.
+	GLint filter = GL_LINEAR;
+	if (glHasExtension("GL_OES_texture_half_float")) {
+		format = AUDIO_TEX_HALF_FLOAT;
+		texelType = GL_HALF_FLOAT_OES;
+		if (!glHasExtension("GL_OES_texture_half_float_linear")) filter = GL_NEAREST;
+	}
+	else {
+		format = AUDIO_TEX_RGBA8;
+		texelType = GL_UNSIGNED_BYTE;
+	}
+
+	waveSize = waveWidth;
+	bins = binCount;
+	waveTexels.assign((size_t)waveSize * 4, 0.0f);
+	spectrumTexels.assign((size_t)bins * AUDIO_TEX_SPECTRUM_ROWS * 4, 0.0f);
+	scratch.assign(bins, 0.0f);
+	size_t maxTexels = waveTexels.size() > spectrumTexels.size() ? waveTexels.size() : spectrumTexels.size();
+	if (format == AUDIO_TEX_HALF_FLOAT) halfTexels.assign(maxTexels, 0);
+	else byteTexels.assign(maxTexels, 0);
+
+	// Silent until the first upload, not whatever the driver left there
+	waveTex = createTexture(waveSize, 1, texelType, filter, pack(waveTexels.data(), (int)waveTexels.size()));
+	spectrumTex = createTexture(bins, AUDIO_TEX_SPECTRUM_ROWS, texelType, filter,
+		pack(spectrumTexels.data(), (int)spectrumTexels.size()));
+
+	printf("Audio textures: %dx1 + %dx%d RGBA %s\n", waveSize, bins, AUDIO_TEX_SPECTRUM_ROWS,
+		format == AUDIO_TEX_HALF_FLOAT ? "half-float" : "8-bit");
+	resetStats();
+	return true;
+}
+
+void AudioTextures::release() {
+	g_glState.deleteTexture(waveTex);
+	g_glState.deleteTexture(spectrumTex);
+	waveTex = spectrumTex = 0;
+	waveSize = bins = 0;
+}
+
+void AudioTextures::resetStats() {
+	bytesUploaded = 0;
+	uploadSeconds = 0.0;
+	uploads = 0;
+	skippedFrames = 0;
+}
+
+int AudioTextures::getLegacyBytesPerFrame() const {
+	// GL_LUMINANCE floats: waveform row + six spectrum rows, re-specified
+	return (waveSize + bins * 6) * (int)sizeof(float);
+}
+
+void AudioTextures::interleave(float* out, const float* r, const float* g, const float* b, const float* a, int count) const {
+	for (int i = 0; i < count; i++) {
+		out[0] = r[i];
+		out[1] = g[i];
+		out[2] = b[i];
+		out[3] = a[i];
+		out += 4;
+	}
+}
+
+const void* AudioTextures::pack(const float* texels, int count) {
+	if (format == AUDIO_TEX_HALF_FLOAT) {
+		audioFloatToHalf(texels, halfTexels.data(), count);
+		return halfTexels.data();
+	}
+	audioFloatToUnorm8(texels, byteTexels.data(), count, 1.0f, 0.0f);
+	return byteTexels.data();
+}
+
+void AudioTextures::send(GLuint tex, int width, int height, const float* texels) {
+	int count = width * height * 4;
+	const void* pixels = pack(texels, count);
+	bytesUploaded += (uint64_t)count * (format == AUDIO_TEX_HALF_FLOAT ? 2 : 1);
+
+	g_glState.editTexture(tex);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, texelType, pixels);
+	g_glState.count();
+}
+
+void AudioTextures::upload(const AudioTextureFrame& frame) {
+	if (!waveTex) return;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Waveform: mono, left, right, side
+	float* t = waveTexels.data();
+	const float* st = frame.waveStereo;
+	for (int i = 0; i < waveSize; i++) {
+		float l = st ? st[i * 2] : frame.waveMono[i];
+		float r = st ? st[i * 2 + 1] : frame.waveMono[i];
+		t[0] = frame.waveMono[i];
+		t[1] = l;
+		t[2] = r;
+		t[3] = (l - r) * 0.5f;
+		t += 4;
+	}
+	send(waveTex, waveSize, 1, waveTexels.data());
+
+	// Spectrum rows
+	memcpy(scratch.data(), frame.raw, bins * sizeof(float));
+	audioNormalize(scratch.data(), bins, frame.rawGain);
+	interleave(spectrumTexels.data(), frame.smoothed, frame.peaks, frame.left, frame.right, bins);
+	interleave(spectrumTexels.data() + (size_t)bins * 4, frame.mid, frame.side, frame.bands, scratch.data(), bins);
+	send(spectrumTex, bins, AUDIO_TEX_SPECTRUM_ROWS, spectrumTexels.data());
+
+	uploadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	uploads++;
+}
@@ -0,0 +1,105 @@
+/*
+Shader Fun - Packed audio textures
+Created By MrDude
+*/
+
+#ifndef AUDIO_TEXTURES_H
+#define AUDIO_TEXTURES_H
+
+#include <stdint.h>
+#include <vector>
+#include <GLES2/gl2.h>
+
+// Texel layout (RGBA):
+//  iChannel0, 1 row of fftSize texels:
+//    r = mono waveform, g = left, b = right, a = side (L - R) / 2
+//  iChannel1, 2 rows of fftSize / 2 texels:
+//    row 0: r = smoothed spectrum, g = held peak, b = left, a = right
+//    row 1: r = mid, g = side, b = band level, a = unsmoothed spectrum
+// Every existing shader reads .r of row 0, which holds the same values as
+// the old float textures did: the waveform signed, levels not capped at 1.
+// Only the RGBA8 fallback differs, see AudioTexFormat.
+const int AUDIO_TEX_SPECTRUM_ROWS = 2;
+
+enum AudioTexFormat {
+	AUDIO_TEX_HALF_FLOAT,  // GL_OES_texture_half_float: signed, same values as before
+	AUDIO_TEX_RGBA8        // core GLES2 fallback: the same values clamped to 0..1, so the
+	                       // waveform loses its negative half (silence still reads 0)
+};
+
+// Everything that goes into the two textures, one frame's worth
+struct AudioTextureFrame {
+	const float* waveMono;     // waveSize samples
+	const float* waveStereo;   // waveSize interleaved L/R frames, or NULL
+	const float* smoothed;     // bins each
+	const float* peaks;
+	const float* left;
+	const float* right;
+	const float* mid;
+	const float* side;
+	const float* bands;        // per-bin band level
+	const float* raw;          // unsmoothed magnitudes
+	float rawGain;             // applied to raw so it matches the smoothed rows
+};
+
+// Both audio textures are allocated once and then only refreshed with
+// glTexSubImage2D, from CPU-packed RGBA texels.
+class AudioTextures {
+public:
+	AudioTextures();
+	~AudioTextures();
+
+	// Needs a current GL context. Picks half-float when the driver has it.
+	bool init(int waveSize, int bins);
+	void release();
+
+	// Pack and upload. Call only when there is new audio to show.
+	void upload(const AudioTextureFrame& frame);
+	// A frame with nothing new - counted so the stats show the saving
+	void skip() { skippedFrames++; }
+
+	GLuint getWaveform() const { return waveTex; }
+	GLuint getSpectrum() const { return spectrumTex; }
+	AudioTexFormat getFormat() const { return format; }
+	int getWaveSize() const { return waveSize; }
+	int getBins() const { return bins; }
+
+	// Upload stats since the last resetStats()
+	int getUploads() const { return uploads; }
+	int getSkippedFrames() const { return skippedFrames; }
+	float getBytesPerUpload() const { return uploads ? (float)bytesUploaded / uploads : 0.0f; }
+	float getMicrosPerUpload() const { return uploads ? (float)(uploadSeconds * 1e6 / uploads) : 0.0f; }
+	// Bytes the old float textures re-specified every frame; the time both
+	// paths take is measured by tools/audio_upload_bench
+	int getLegacyBytesPerFrame() const;
+	void resetStats();
+
+private:
+	AudioTextures(const AudioTextures&);
+	AudioTextures& operator=(const AudioTextures&);
+
+	void interleave(float* out, const float* r, const float* g, const float* b, const float* a, int count) const;
+	// Float texels converted to the texture format, in halfTexels or byteTexels
+	const void* pack(const float* texels, int count);
+	void send(GLuint tex, int width, int height, const float* texels);
+
+	GLuint waveTex;
+	GLuint spectrumTex;
+	AudioTexFormat format;
+	GLenum texelType;
+	int waveSize;
+	int bins;
+
+	std::vector<float> waveTexels;      // RGBA floats before conversion
+	std::vector<float> spectrumTexels;
+	std::vector<float> scratch;         // raw spectrum row, normalised
+	std::vector<uint16_t> halfTexels;
+	std::vector<uint8_t> byteTexels;
+
+	uint64_t bytesUploaded;
+	double uploadSeconds;
+	int uploads;
+	int skippedFrames;
+};
+
+#endif // AUDIO_TEXTURES_H
@@ -0,0 +1,121 @@
+/*
+Shader Fun - Audio/visual sync
+Created By MrDude
+*/
+
+#include <math.h>
+#include "av_sync.h"
+
+// Fraction of the stamp/model difference corrected per frame
+static const double CLOCK_TRACKING = 0.05;
+// Beyond this the model is simply reset (seek, stall, device restart)
+static const double CLOCK_SNAP_SECONDS = 0.1;
+
+AvSync::AvSync()
+	: enabled(true), sampleRate(44100), ticksPerSecond(1.0), latency(0.0),
+	stampSeq(0), stampFrame(0), stampTicks(0),
+	clockValid(false), clockFrame(0.0), clockTicks(0),
+	lastSwapTicks(0), framePeriod(1.0 / 60.0) {
+	resetStats();
+}
+
+void AvSync::configure(int rate, uint64_t tps, double outputLatency) {
+	sampleRate = rate;
+	ticksPerSecond = (double)tps;
+	latency = outputLatency > 0.0 ? outputLatency : 0.0;
+	clockValid = false;
+}
+
+void AvSync::resetStats() {
+	lastErrorMs = 0.0f;
+	maxAbsError = 0.0f;
+	sumAbsError = 0.0;
+	sumLead = 0.0;
+	statFrames = 0;
+}
+
+void AvSync::stampCapture(uint64_t startFrame, uint64_t ticks) {
+	uint32_t seq = stampSeq.load(std::memory_order_relaxed);
+	stampSeq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	stampFrame.store(startFrame, std::memory_order_relaxed);
+	stampTicks.store(ticks, std::memory_order_relaxed);
+	stampSeq.store(seq + 2, std::memory_order_release);
+}
+
+bool AvSync::readStamp(uint64_t& frame, uint64_t& ticks) const {
+	for (int tries = 0; tries < 4; tries++) {
+		uint32_t before = stampSeq.load(std::memory_order_acquire);
+		if (before & 1) continue;
+		frame = stampFrame.load(std::memory_order_relaxed);
+		ticks = stampTicks.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (stampSeq.load(std::memory_order_relaxed) == before) {
+			return before != 0;
+		}
+	}
+	return false;
+}
+
+// Frame coming out of the speakers at `ticks`, from the clock model.
+// False until the mixer has stamped its first block.
+bool AvSync::audibleFrame(uint64_t ticks, double& heardFrame) {
+	uint64_t frame, mixedAt;
+	if (readStamp(frame, mixedAt)) {
+		// The stamped block starts playing `latency` after it was mixed
+		double heard = frame + (((double)ticks - (double)mixedAt) / ticksPerSecond - latency) * sampleRate;
+		double predicted = clockFrame + ((double)ticks - (double)clockTicks) / ticksPerSecond * sampleRate;
+		double diff = heard - predicted;
+
+		if (!clockValid || fabs(diff) > CLOCK_SNAP_SECONDS * sampleRate) {
+			clockFrame = heard;
+			clockValid = true;
+		}
+		else {
+			clockFrame = predicted + diff * CLOCK_TRACKING;
+		}
+		clockTicks = ticks;
+	}
+	if (!clockValid) return false;
+
+	heardFrame = clockFrame + ((double)ticks - (double)clockTicks) / ticksPerSecond * sampleRate;
+	return true;
+}
+
+uint64_t AvSync::targetFrame(uint64_t nowTicks, uint64_t newestFrame) {
+	if (!enabled) return newestFrame;
+
+	// With vsync the frame being drawn goes up one period after the last swap
+	uint64_t period = (uint64_t)(framePeriod * ticksPerSecond);
+	uint64_t presentTicks = lastSwapTicks ? lastSwapTicks + period : nowTicks + period;
+	while (period > 0 && presentTicks < nowTicks) {
+		presentTicks += period;
+	}
+
+	double heard;
+	if (!audibleFrame(presentTicks, heard)) return newestFrame;
+	if (heard <= 0.0) return 0;
+	uint64_t target = (uint64_t)heard;
+	return target < newestFrame ? target : newestFrame;
+}
+
+void AvSync::onPresent(uint64_t swapTicks, uint64_t analysedFrame, uint64_t newestFrame) {
+	if (lastSwapTicks) {
+		double dt = ((double)swapTicks - (double)lastSwapTicks) / ticksPerSecond;
+		// Ignore hitches (loading a shader) when tracking the refresh period
+		if (dt > 1.0 / 240.0 && dt < 0.1) {
+			framePeriod += (dt - framePeriod) * 0.1;
+		}
+	}
+	lastSwapTicks = swapTicks;
+
+	double heard;
+	if (!audibleFrame(swapTicks, heard)) return;
+
+	lastErrorMs = (float)((analysedFrame - heard) * 1000.0 / sampleRate);
+	float absError = fabsf(lastErrorMs);
+	if (absError > maxAbsError) maxAbsError = absError;
+	sumAbsError += absError;
+	sumLead += (newestFrame - heard) * 1000.0 / sampleRate;
+	statFrames++;
+}
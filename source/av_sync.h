@@ -0,0 +1,85 @@
+/*
+Shader Fun - Audio/visual sync
+Created By MrDude
+*/
+
+#ifndef AV_SYNC_H
+#define AV_SYNC_H
+
+#include <atomic>
+#include <stdint.h>
+
+// Works out which captured sample is actually coming out of the speakers
+// when the next frame reaches the screen, so analysis can be aimed at that
+// sample instead of the newest one the mixer produced (which is still a
+// device buffer away from being heard).
+//
+// The mixer thread stamps every captured block with its ring position and
+// the time it was mixed; the render thread feeds in swap times. All times
+// are in ticks of one monotonic counter (SDL_GetPerformanceCounter on the
+// Switch).
+class AvSync {
+public:
+	AvSync();
+
+	// outputLatency: seconds from a block being mixed to it being heard
+	void configure(int sampleRate, uint64_t ticksPerSecond, double outputLatency);
+	void setEnabled(bool on) { enabled = on; }
+	bool isEnabled() const { return enabled; }
+
+	// === Mixer thread ===
+	// A block starting at ring frame startFrame was mixed at `ticks`
+	void stampCapture(uint64_t startFrame, uint64_t ticks);
+
+	// === Render thread ===
+	// End frame the analysis should use for the frame about to be drawn:
+	// the sample audible when it is presented, never past newestFrame.
+	uint64_t targetFrame(uint64_t nowTicks, uint64_t newestFrame);
+
+	// Call right after the swap. analysedFrame is the end of the window the
+	// presented frame was drawn from; newestFrame the ring write position
+	// at analysis time (what an unsynced renderer would have used).
+	void onPresent(uint64_t swapTicks, uint64_t analysedFrame, uint64_t newestFrame);
+
+	double getFramePeriod() const { return framePeriod; }
+
+	// Sync error of presented frames in ms, positive = visuals ahead of sound
+	float getLastErrorMs() const { return lastErrorMs; }
+	float getMeanAbsErrorMs() const { return statFrames ? (float)(sumAbsError / statFrames) : 0.0f; }
+	float getMaxAbsErrorMs() const { return maxAbsError; }
+	// How far ahead the newest captured audio was (the unsynced error)
+	float getMeanLeadMs() const { return statFrames ? (float)(sumLead / statFrames) : 0.0f; }
+	void resetStats();
+
+private:
+	bool readStamp(uint64_t& frame, uint64_t& ticks) const;
+	bool audibleFrame(uint64_t ticks, double& heardFrame);
+
+	bool enabled;
+	int sampleRate;
+	double ticksPerSecond;
+	double latency;
+
+	// Newest stamp, published seqlock style (odd sequence = being written)
+	std::atomic<uint32_t> stampSeq;
+	std::atomic<uint64_t> stampFrame;
+	std::atomic<uint64_t> stampTicks;
+
+	// Render-side model of the playback clock: frame `clockFrame` is heard
+	// at `clockTicks`, advancing at sampleRate. Stamps arrive in bursts, so
+	// the model is nudged towards them rather than snapped.
+	bool clockValid;
+	double clockFrame;
+	uint64_t clockTicks;
+
+	uint64_t lastSwapTicks;
+	double framePeriod;
+
+	float lastErrorMs;
+	float maxAbsError;
+	double sumAbsError;
+	double sumLead;
+	int statFrames;
+};
+
+#endif // AV_SYNC_H
@@ -0,0 +1,201 @@
+/*
+Shader Fun - Frame pacing
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "frame_pacer.h"
+
+// Adaptive mode: drop to 30 when more than this many of a window's
+// 60 fps frames miss their vblank
+static const int ADAPT_WINDOW = 60;
+static const int ADAPT_MAX_MISSED = 6;
+// Time spent at 30 before trying 60 again, doubled after each failed try
+static const double ADAPT_BACKOFF_MIN = 5.0;
+static const double ADAPT_BACKOFF_MAX = 60.0;
+
+const char* framePaceModeName(FramePaceMode mode) {
+	switch (mode) {
+	case FRAME_PACE_60: return "60";
+	case FRAME_PACE_30: return "30";
+	case FRAME_PACE_ADAPTIVE: return "adaptive";
+	}
+	return "adaptive";
+}
+
+FramePacer::FramePacer()
+	: mode(FRAME_PACE_ADAPTIVE), ticksPerSecond(1.0), refreshTicks(1), swapInterval(1),
+	lastRelease(0), totalMissed(0) {
+	resetAdaptive();
+	resetStats();
+}
+
+void FramePacer::configure(uint64_t tps, float refreshHz, FramePaceMode paceMode) {
+	ticksPerSecond = (double)tps;
+	refreshTicks = (uint64_t)(ticksPerSecond / (refreshHz > 0.0f ? refreshHz : 60.0f));
+	if (refreshTicks == 0) refreshTicks = 1;
+	lastRelease = 0;
+	setMode(paceMode);
+}
+
+void FramePacer::setMode(FramePaceMode paceMode) {
+	mode = paceMode;
+	resetAdaptive();
+	setSwapInterval(mode == FRAME_PACE_30 ? 2 : 1);
+}
+
+void FramePacer::setSwapInterval(int interval) {
+	swapInterval = interval;
+	windowFrames = 0;
+	windowMissed = 0;
+}
+
+float FramePacer::getTargetMs() const {
+	return (float)(refreshTicks * swapInterval * 1000.0 / ticksPerSecond);
+}
+
+void FramePacer::resetAdaptive() {
+	windowFrames = 0;
+	windowMissed = 0;
+	probing = false;
+	droppedAt = 0;
+	backoffSeconds = ADAPT_BACKOFF_MIN;
+	if (mode == FRAME_PACE_ADAPTIVE) swapInterval = 1;
+}
+
+bool FramePacer::startReduced(uint64_t now) {
+	if (mode != FRAME_PACE_ADAPTIVE) return false;
+	probing = false;
+	droppedAt = now;
+	setSwapInterval(2);
+	return true;
+}
+
+uint64_t FramePacer::afterSwap(uint64_t swapTicks) {
+	if (lastRelease == 0 || swapTicks < lastRelease) {
+		lastRelease = swapTicks;
+		return swapTicks;
+	}
+
+	// Vsync jitter and a refresh rate that isn't exactly 60 Hz both fit
+	// well inside a quarter of a refresh
+	uint64_t deadline = lastRelease + refreshTicks * swapInterval;
+	uint64_t slack = refreshTicks / 4;
+	uint64_t release = swapTicks;
+	bool late = false;
+	if (swapTicks + slack < deadline) {
+		// The swap didn't wait for the display, so wait out the rest here
+		release = deadline;
+	} else if (swapTicks > deadline + slack) {
+		late = true;
+	}
+
+	record(release - lastRelease, late);
+	lastRelease = release;
+	if (mode == FRAME_PACE_ADAPTIVE) {
+		adapt(release, late);
+	}
+	return release;
+}
+
+void FramePacer::adapt(uint64_t now, bool late) {
+	if (swapInterval == 2) {
+		if (now - droppedAt >= (uint64_t)(backoffSeconds * ticksPerSecond)) {
+			probing = true;
+			setSwapInterval(1);
+		}
+		return;
+	}
+
+	windowFrames++;
+	if (late) windowMissed++;
+	if (windowMissed > ADAPT_MAX_MISSED) {
+		// A failed retry means this shader really is too heavy: back off further
+		if (probing) {
+			backoffSeconds *= 2.0;
+			if (backoffSeconds > ADAPT_BACKOFF_MAX) backoffSeconds = ADAPT_BACKOFF_MAX;
+		}
+		probing = false;
+		droppedAt = now;
+		setSwapInterval(2);
+	} else if (windowFrames >= ADAPT_WINDOW) {
+		if (probing) backoffSeconds = ADAPT_BACKOFF_MIN;
+		probing = false;
+		windowFrames = 0;
+		windowMissed = 0;
+	}
+}
+
+void FramePacer::record(uint64_t intervalTicks, bool late) {
+	float ms = (float)(intervalTicks * 1000.0 / ticksPerSecond);
+	int bucket = (int)(ms / FRAME_HIST_BUCKET_MS);
+	if (bucket >= FRAME_HIST_BUCKETS) bucket = FRAME_HIST_BUCKETS - 1;
+
+	// Drop the oldest frame once the window is full
+	if (frames == FRAME_HISTORY) {
+		counts[history[head]]--;
+		if (historyLate[head]) missed--;
+	} else {
+		frames++;
+	}
+	history[head] = (uint8_t)bucket;
+	historyLate[head] = late;
+	counts[bucket]++;
+	if (late) {
+		missed++;
+		totalMissed++;
+	}
+	head = (head + 1) % FRAME_HISTORY;
+}
+
+float FramePacer::getPercentileMs(float p) const {
+	if (frames == 0) return 0.0f;
+	int rank = (int)(p * frames + 0.999f);
+	if (rank < 1) rank = 1;
+	int seen = 0;
+	for (int b = 0; b < FRAME_HIST_BUCKETS; b++) {
+		seen += counts[b];
+		if (seen >= rank) return (b + 1) * FRAME_HIST_BUCKET_MS;
+	}
+	return FRAME_HIST_BUCKETS * FRAME_HIST_BUCKET_MS;
+}
+
+float FramePacer::getMaxMs() const {
+	return getPercentileMs(1.0f);
+}
+
+void FramePacer::dump(const char* label) const {
+	printf("Frame times (%s): %d frames, target %.1f ms (%s), p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, max %.1f ms, missed %d\n",
+		label, frames, getTargetMs(), framePaceModeName(mode),
+		getPercentileMs(0.50f), getPercentileMs(0.95f), getPercentileMs(0.99f), getMaxMs(), missed);
+
+	int largest = 0;
+	for (int b = 0; b < FRAME_HIST_BUCKETS; b++) {
+		if (counts[b] > largest) largest = counts[b];
+	}
+	for (int b = 0; b < FRAME_HIST_BUCKETS; b++) {
+		if (counts[b] == 0) continue;
+		char bar[41];
+		int len = counts[b] * 40 / largest;
+		if (len < 1) len = 1;
+		memset(bar, '#', len);
+		bar[len] = 0;
+		if (b == FRAME_HIST_BUCKETS - 1) {
+			printf("  %5.1f+      ms %4d %s\n", b * FRAME_HIST_BUCKET_MS, counts[b], bar);
+		} else {
+			printf("  %5.1f-%5.1f ms %4d %s\n", b * FRAME_HIST_BUCKET_MS, (b + 1) * FRAME_HIST_BUCKET_MS, counts[b], bar);
+		}
+	}
+}
+
+void FramePacer::resetStats() {
+	memset(history, 0, sizeof(history));
+	memset(historyLate, 0, sizeof(historyLate));
+	memset(counts, 0, sizeof(counts));
+	head = 0;
+	frames = 0;
+	missed = 0;
+	// Whatever happens before the next swap (loading a shader) isn't a frame
+	lastRelease = 0;
+}
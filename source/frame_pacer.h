@@ -0,0 +1,92 @@
+/*
+Shader Fun - Frame pacing
+Created By MrDude
+*/
+
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <stdint.h>
+
+enum FramePaceMode {
+	FRAME_PACE_60,
+	FRAME_PACE_30,
+	FRAME_PACE_ADAPTIVE    // 60, dropping to 30 while the shader can't keep up
+};
+
+const char* framePaceModeName(FramePaceMode mode);
+
+// Rolling frame-time window: 10 s at 60 fps, in 0.5 ms buckets
+const int FRAME_HISTORY = 600;
+const int FRAME_HIST_BUCKETS = 100;    // the last bucket holds everything slower
+const float FRAME_HIST_BUCKET_MS = 0.5f;
+
+// Decides the swap interval and when the next frame may start.
+//
+// With vsync the swap itself blocks until the frame is shown, so there is
+// nothing to wait for. If the swap comes back early (no vsync, or the
+// driver ignored the interval) the pacer asks for a sleep until the next
+// deadline instead. All times are ticks of one monotonic counter
+// (SDL_GetPerformanceCounter on the Switch).
+class FramePacer {
+public:
+	FramePacer();
+
+	void configure(uint64_t ticksPerSecond, float refreshHz, FramePaceMode mode);
+	void setMode(FramePaceMode mode);
+	FramePaceMode getMode() const { return mode; }
+
+	// Interval the GL driver should use; re-apply whenever it changes
+	int getSwapInterval() const { return swapInterval; }
+	float getTargetMs() const;
+
+	// Call right after the swap returns. Returns the tick the next frame
+	// should start at (swapTicks itself when vsync already did the waiting).
+	uint64_t afterSwap(uint64_t swapTicks);
+
+	// A different shader: let adaptive mode try the full rate again
+	void resetAdaptive();
+	// Adaptive mode only: start the shader at the reduced rate, as if it had
+	// just dropped there, and retry the full rate after the usual back-off.
+	// False in the fixed modes.
+	bool startReduced(uint64_t now);
+
+	// Rolling stats over the last FRAME_HISTORY frames. Percentiles are
+	// bucket upper edges, so a steady 16.7 ms reads as 17.0.
+	int getFrames() const { return frames; }
+	float getPercentileMs(float p) const;
+	float getMaxMs() const;
+	int getMissedDeadlines() const { return missed; }
+	uint64_t getTotalMissed() const { return totalMissed; }
+	void dump(const char* label) const;
+	void resetStats();
+
+private:
+	void record(uint64_t intervalTicks, bool late);
+	void adapt(uint64_t now, bool late);
+	void setSwapInterval(int interval);
+
+	FramePaceMode mode;
+	double ticksPerSecond;
+	uint64_t refreshTicks;
+	int swapInterval;
+	uint64_t lastRelease;
+
+	// Adaptive mode: misses counted over one-second windows at 60; at 30
+	// the full rate is retried after a back-off that grows on each failure
+	int windowFrames;
+	int windowMissed;
+	bool probing;
+	uint64_t droppedAt;
+	double backoffSeconds;
+
+	uint8_t history[FRAME_HISTORY];   // bucket of each frame
+	bool historyLate[FRAME_HISTORY];
+	int counts[FRAME_HIST_BUCKETS];
+	int head;
+	int frames;
+	int missed;
+	uint64_t totalMissed;
+};
+
+#endif // FRAME_PACER_H
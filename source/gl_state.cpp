@@ -0,0 +1,152 @@
+/*
+Shader Fun - GL state cache
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "gl_state.h"
+
+// Shadow value for "not known, always bind"
+static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+GlState g_glState;
+
+GlState::GlState()
+	: debug(false), frameCalls(0), frameSkipped(0), lastCalls(0), lastSkipped(0) {
+	invalidate();
+}
+
+void GlState::invalidate() {
+	program = UNKNOWN;
+	for (int i = 0; i < GL_STATE_UNITS; i++) textures[i] = UNKNOWN;
+	activeUnit = -1;
+	framebuffer = UNKNOWN;
+	arrayBuffer = UNKNOWN;
+	view[0] = view[1] = -1;
+	view[2] = view[3] = -1;
+	stencil = -1;
+}
+
+void GlState::useProgram(GLuint prog) {
+	if (prog == program) {
+		frameSkipped++;
+		return;
+	}
+	glUseProgram(prog);
+	program = prog;
+	frameCalls++;
+}
+
+void GlState::activeTexture(int unit) {
+	if (unit == activeUnit) return;
+	glActiveTexture(GL_TEXTURE0 + unit);
+	activeUnit = unit;
+	frameCalls++;
+}
+
+void GlState::bindTexture(int unit, GLuint tex) {
+	if (unit < 0 || unit >= GL_STATE_UNITS) return;
+	if (textures[unit] == tex) {
+		frameSkipped++;
+		return;
+	}
+	activeTexture(unit);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	textures[unit] = tex;
+	frameCalls++;
+}
+
+void GlState::editTexture(GLuint tex) {
+	bindTexture(GL_STATE_SCRATCH_UNIT, tex);
+}
+
+void GlState::bindFramebuffer(GLuint fbo) {
+	if (fbo == framebuffer) {
+		frameSkipped++;
+		return;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	framebuffer = fbo;
+	frameCalls++;
+}
+
+void GlState::bindArrayBuffer(GLuint buffer) {
+	if (buffer == arrayBuffer) {
+		frameSkipped++;
+		return;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	arrayBuffer = buffer;
+	frameCalls++;
+}
+
+void GlState::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	if (view[0] == x && view[1] == y && view[2] == width && view[3] == height) {
+		frameSkipped++;
+		return;
+	}
+	glViewport(x, y, width, height);
+	view[0] = x;
+	view[1] = y;
+	view[2] = width;
+	view[3] = height;
+	frameCalls++;
+}
+
+void GlState::stencilTest(bool on) {
+	if (stencil == (on ? 1 : 0)) {
+		frameSkipped++;
+		return;
+	}
+	if (on) glEnable(GL_STENCIL_TEST);
+	else glDisable(GL_STENCIL_TEST);
+	stencil = on ? 1 : 0;
+	frameCalls++;
+}
+
+void GlState::deleteProgram(GLuint prog) {
+	if (!prog) return;
+	if (prog == program) program = UNKNOWN;
+	glDeleteProgram(prog);
+}
+
+void GlState::deleteTexture(GLuint tex) {
+	if (!tex) return;
+	for (int i = 0; i < GL_STATE_UNITS; i++) {
+		if (textures[i] == tex) textures[i] = UNKNOWN;
+	}
+	glDeleteTextures(1, &tex);
+}
+
+void GlState::deleteFramebuffer(GLuint fbo) {
+	if (!fbo) return;
+	if (fbo == framebuffer) framebuffer = UNKNOWN;
+	glDeleteFramebuffers(1, &fbo);
+}
+
+void GlState::checkErrors(const char* where) {
+	if (!debug) return;
+	for (GLenum error = glGetError(); error != GL_NO_ERROR; error = glGetError()) {
+		printf("OpenGL error 0x%04x (%s)\n", error, where);
+	}
+}
+
+void GlState::endFrame() {
+	lastCalls = frameCalls;
+	lastSkipped = frameSkipped;
+	frameCalls = 0;
+	frameSkipped = 0;
+}
+
+bool glHasExtension(const char* name) {
+	const char* list = (const char*)glGetString(GL_EXTENSIONS);
+	if (!list) return false;
+
+	size_t len = strlen(name);
+	for (const char* p = strstr(list, name); p; p = strstr(p + len, name)) {
+		// Whole word only (GL_OES_texture_half_float vs ..._linear)
+		if ((p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == 0)) return true;
+	}
+	return false;
+}
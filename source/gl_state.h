@@ -0,0 +1,81 @@
+/*
+Shader Fun - GL state cache
+Created By MrDude
+*/
+
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <GLES2/gl2.h>
+
+// Texture units tracked (the GLES2 minimum for fragment shaders)
+const int GL_STATE_UNITS = 8;
+// No shader samples this one, so creating or updating a texture on it
+// never disturbs the iChannel bindings
+const int GL_STATE_SCRATCH_UNIT = GL_STATE_UNITS - 1;
+
+// Shadow copy of the bindings the renderer changes, so a bind that
+// wouldn't change anything is skipped instead of sent to the driver.
+// The shadow is only right if every bind of these kinds goes through here;
+// after anything else touches them, call invalidate().
+class GlState {
+public:
+	GlState();
+
+	// Forget everything (new context, or GL calls made behind our back)
+	void invalidate();
+
+	void useProgram(GLuint prog);
+	void bindTexture(int unit, GLuint tex);
+	// Bind tex on the scratch unit, to create or update it
+	void editTexture(GLuint tex);
+	void bindFramebuffer(GLuint fbo);
+	void bindArrayBuffer(GLuint buffer);
+	void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	void stencilTest(bool on);
+
+	// Deleting a bound object frees its name for reuse, so drop it from the shadow too
+	void deleteProgram(GLuint prog);
+	void deleteTexture(GLuint tex);
+	void deleteFramebuffer(GLuint fbo);
+
+	// Calls made directly (draws, uniforms, uploads) count towards the frame too
+	void count(int calls = 1) { frameCalls += calls; }
+
+	// glGetError stalls the pipeline, so it only runs in debug mode
+	void setDebug(bool on) { debug = on; }
+	bool isDebug() const { return debug; }
+	void checkErrors(const char* where);
+
+	// Close the frame's counters
+	void endFrame();
+	int getFrameCalls() const { return lastCalls; }
+	int getFrameSkipped() const { return lastSkipped; }
+
+private:
+	void activeTexture(int unit);
+
+	GLuint program;
+	GLuint textures[GL_STATE_UNITS];
+	int activeUnit;
+	GLuint framebuffer;
+	GLuint arrayBuffer;
+	GLint view[4];
+	int stencil;          // -1 = unknown
+
+	bool debug;
+	int frameCalls;
+	int frameSkipped;
+	int lastCalls;
+	int lastSkipped;
+};
+
+extern GlState g_glState;
+
+// Whole-word search of GL_EXTENSIONS (needs a current context)
+bool glHasExtension(const char* name);
+
+// Looks up a GL entry point (SDL_GL_GetProcAddress, eglGetProcAddress)
+typedef void* (*GlProcLoader)(const char* name);
+
+#endif // GL_STATE_H
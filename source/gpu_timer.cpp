@@ -0,0 +1,144 @@
+/*
+Shader Fun - GPU timer queries
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include "gpu_timer.h"
+#include "gl_state.h"
+
+#ifndef GL_QUERY_RESULT_EXT
+#define GL_QUERY_RESULT_EXT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE_EXT
+#define GL_QUERY_RESULT_AVAILABLE_EXT 0x8867
+#endif
+#ifndef GL_TIME_ELAPSED_EXT
+#define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+// GL_EXT_disjoint_timer_query entry points, loaded at init
+typedef void (GL_APIENTRY* GenQueriesProc)(GLsizei n, GLuint* ids);
+typedef void (GL_APIENTRY* DeleteQueriesProc)(GLsizei n, const GLuint* ids);
+typedef void (GL_APIENTRY* BeginQueryProc)(GLenum target, GLuint id);
+typedef void (GL_APIENTRY* EndQueryProc)(GLenum target);
+typedef void (GL_APIENTRY* GetQueryObjectuivProc)(GLuint id, GLenum pname, GLuint* params);
+typedef void (GL_APIENTRY* GetQueryObjectui64vProc)(GLuint id, GLenum pname, uint64_t* params);
+
+static GenQueriesProc genQueries;
+static DeleteQueriesProc deleteQueries;
+static BeginQueryProc beginQuery;
+static EndQueryProc endQuery;
+static GetQueryObjectuivProc getQueryObjectuiv;
+static GetQueryObjectui64vProc getQueryObjectui64v;
+
+GpuTimer::GpuTimer() : head(0), pending(0), running(false), available(false), dropped(0) {
+	for (int i = 0; i < GPU_TIMER_QUERIES; i++) {
+		queries[i] = 0;
+		tags[i] = 0.0f;
+	}
+}
+
+bool GpuTimer::init(GlProcLoader loader) {
+	release();
+	if (!glHasExtension("GL_EXT_disjoint_timer_query")) {
+		printf("GPU timer: no GL_EXT_disjoint_timer_query\n");
+		return false;
+	}
+
+	genQueries = (GenQueriesProc)loader("glGenQueriesEXT");
+	deleteQueries = (DeleteQueriesProc)loader("glDeleteQueriesEXT");
+	beginQuery = (BeginQueryProc)loader("glBeginQueryEXT");
+	endQuery = (EndQueryProc)loader("glEndQueryEXT");
+	getQueryObjectuiv = (GetQueryObjectuivProc)loader("glGetQueryObjectuivEXT");
+	getQueryObjectui64v = (GetQueryObjectui64vProc)loader("glGetQueryObjectui64vEXT");
+	if (!genQueries || !deleteQueries || !beginQuery || !endQuery || !getQueryObjectuiv) {
+		printf("GPU timer: timer query functions missing\n");
+		return false;
+	}
+
+	genQueries(GPU_TIMER_QUERIES, queries);
+	// Reading the flag clears it, so start from a clean slate
+	GLint disjoint = 0;
+	glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+
+	available = true;
+	printf("GPU timer: using GL_EXT_disjoint_timer_query\n");
+	return true;
+}
+
+void GpuTimer::release() {
+	if (available) {
+		if (running) endQuery(GL_TIME_ELAPSED_EXT);
+		deleteQueries(GPU_TIMER_QUERIES, queries);
+	}
+	for (int i = 0; i < GPU_TIMER_QUERIES; i++) queries[i] = 0;
+	head = 0;
+	pending = 0;
+	running = false;
+	available = false;
+}
+
+bool GpuTimer::begin() {
+	if (!available || running || pending == GPU_TIMER_QUERIES) return false;
+	beginQuery(GL_TIME_ELAPSED_EXT, queries[head]);
+	g_glState.count();
+	running = true;
+	return true;
+}
+
+void GpuTimer::end(float tag) {
+	if (!running) return;
+	endQuery(GL_TIME_ELAPSED_EXT);
+	g_glState.count();
+	tags[head] = tag;
+	running = false;
+	head = (head + 1) % GPU_TIMER_QUERIES;
+	pending++;
+}
+
+bool GpuTimer::poll(float& ms, float* tag) {
+	if (!available || pending == 0) return false;
+
+	int oldest = (head - pending + GPU_TIMER_QUERIES) % GPU_TIMER_QUERIES;
+	GLuint query = queries[oldest];
+	GLuint ready = 0;
+	getQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE_EXT, &ready);
+	if (!ready) return false;
+	pending--;
+
+	// Any disjoint event since the last check makes every result in flight suspect
+	GLint disjoint = 0;
+	glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+	if (disjoint) {
+		dropped += pending + 1;
+		pending = 0;
+		return false;
+	}
+
+	if (getQueryObjectui64v) {
+		uint64_t ns = 0;
+		getQueryObjectui64v(query, GL_QUERY_RESULT_EXT, &ns);
+		ms = (float)(ns / 1e6);
+	} else {
+		GLuint ns = 0;
+		getQueryObjectuiv(query, GL_QUERY_RESULT_EXT, &ns);
+		ms = ns / 1e6f;
+	}
+	if (tag) *tag = tags[oldest];
+	return true;
+}
+
+void GpuTimer::discard() {
+	if (running) end();
+	float ms;
+	// Finished ones are read and ignored; the rest are simply forgotten (a
+	// query name can be restarted before its old result is read)
+	while (poll(ms)) {
+	}
+	pending = 0;
+}
@@ -0,0 +1,58 @@
+/*
+Shader Fun - GPU timer queries
+Created By MrDude
+*/
+
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <stddef.h>
+#include <GLES2/gl2.h>
+#include "gl_state.h"
+
+// Queries in flight. Results come back a frame or two late; with a few
+// queries queued, reading one never has to wait for the GPU.
+const int GPU_TIMER_QUERIES = 4;
+
+// GPU time of a span of GL commands, from GL_EXT_disjoint_timer_query.
+// Unlike timing with glFinish on either side, nothing stalls: begin/end
+// only queue the query, and poll() picks up finished ones later.
+class GpuTimer {
+public:
+	GpuTimer();
+
+	// Needs a current GL context. False (and isAvailable() false) when the
+	// driver has no timer queries.
+	bool init(GlProcLoader loader);
+	void release();
+	bool isAvailable() const { return available; }
+
+	// Bracket the commands to time. begin() returns false, and end() then
+	// does nothing, when every query is still waiting for its result. The
+	// tag describes what was timed (render scale, say) and comes back with
+	// the result, which may be a few frames later.
+	bool begin();
+	void end(float tag = 0.0f);
+
+	// The oldest finished result, in milliseconds. Results that overlap a
+	// disjoint event (GPU clock change, power state) are dropped.
+	bool poll(float& ms, float* tag = NULL);
+	// Throw away anything in flight (the work it timed is no longer relevant)
+	void discard();
+
+	int getDropped() const { return dropped; }
+
+private:
+	GpuTimer(const GpuTimer&);
+	GpuTimer& operator=(const GpuTimer&);
+
+	GLuint queries[GPU_TIMER_QUERIES];
+	float tags[GPU_TIMER_QUERIES];
+	int head;       // next query to start
+	int pending;    // started and not yet read, oldest at head - pending
+	bool running;
+	bool available;
+	int dropped;
+};
+
+#endif // GPU_TIMER_H
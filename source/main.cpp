@@ -22,9 +22,11 @@ Right Stick Down: Rescane only music files.
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <dirent.h>
+#include <sys/stat.h>
 #include <cmath>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -32,7 +34,35 @@ Right Stick Down: Rescane only music files.
 #include <unistd.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "ftp.h"
+#include "audio_ring.h"
+#include "audio_stft.h"
+#include "audio_simd.h"
+#include "audio_features.h"
+#include "audio_beat.h"
+#include "audio_smooth.h"
+#include "audio_stereo.h"
+#include "audio_capture.h"
+#include "audio_textures.h"
+#include "av_sync.h"
+#include "frame_pacer.h"
+#include "gl_state.h"
+#include "gpu_timer.h"
+#include "program_binary.h"
+#include "render_scale.h"
+#include "shader_buffers.h"
+#include "shader_cache.h"
+#include "shader_costs.h"
+#include "shader_estimate.h"
+#include "shader_prefetch.h"
+#include "shader_program.h"
+#include "settings.h"
+
+// Window / default framebuffer size
+const int SCREEN_WIDTH = 1280;
+const int SCREEN_HEIGHT = 720;
 
 PadState pad;
 HidsysUniquePadId g_unique_pad_ids[2] = { 0 };
@@ -50,11 +80,6 @@ enum LedState {
 	LED_DOUBLE_BLINK
 };
 
-// === KissFFT ===
-extern "C" {
-#include "kiss_fft.h"
-}
-
 // === Helpers ===
 std::string loadFile(const char* path) {
 	std::ifstream file(path);
@@ -67,140 +92,177 @@ std::string loadFile(const char* path) {
 	return buffer.str();
 }
 
-// === Built-in vertex shader (always used) ===
-const char* vertexShaderSrc = R"(
-attribute vec2 aPos;
-varying vec2 vUV;
-void main() {
-    vUV = (aPos + 1.0) * 0.5;
-    gl_Position = vec4(aPos, 0.0, 1.0);
-}
-)";
-
-// === Fallback fragment shader (if no frag files are found) ===
-const char* fallbackFragmentShader = R"(
-precision mediump float;
-uniform vec3 iResolution;
-uniform float iTime;
-uniform sampler2D iChannel0; // Waveform
-uniform sampler2D iChannel1; // Spectrum
-varying vec2 vUV;
-
-vec3 palette(float t) {
-    vec3 a = vec3(0.5, 0.5, 0.5);
-    vec3 b = vec3(0.5, 0.5, 0.5);
-    vec3 c = vec3(1.0, 1.0, 1.0);
-    vec3 d = vec3(0.263, 0.416, 0.557);
-    return a + b * cos(6.28318 * (c * t + d));
-}
-
-void main() {
-    vec2 uv = (vUV * iResolution.xy * 2.0 - iResolution.xy) / iResolution.y;
-    vec2 uv0 = uv;
-    vec3 finalColor = vec3(0.0);
-    
-    // Sample audio data for reactivity
-    float waveform = texture2D(iChannel0, vec2(uv.x, 0.0)).r;
-    float spectrum = texture2D(iChannel1, vec2(uv.x * 0.5, 0.0)).r;
-    
-    for (float i = 0.0; i < 4.0; i++) {
-        uv = fract(uv * 1.5) - 0.5;
-        float d = length(uv) * exp(-length(uv0));
-        vec3 col = palette(length(uv0) + i * 0.4 + iTime * 0.4 + spectrum * 2.0);
-        d = sin(d * 8.0 + iTime + waveform * 10.0) / 8.0;
-        d = abs(d);
-        d = pow(0.01 / d, 1.2 + spectrum);
-        finalColor += col * d;
-    }
-        
-    gl_FragColor = vec4(finalColor, 1.0);
+// === iDate: year, month (0-11), day, seconds since midnight ===
+void updateDate(float date[4]) {
+	time_t now = time(NULL);
+	struct tm* local = localtime(&now);
+	if (!local) {
+		date[0] = date[1] = date[2] = date[3] = 0.0f;
+		return;
+	}
+	date[0] = (float)(local->tm_year + 1900);
+	date[1] = (float)local->tm_mon;
+	date[2] = (float)local->tm_mday;
+	date[3] = (float)(local->tm_hour * 3600 + local->tm_min * 60 + local->tm_sec);
 }
-)";
-
-static GLuint compileShader(GLenum type, const char* src) {
-	GLuint shader = glCreateShader(type);
-	glShaderSource(shader, 1, &src, NULL);
-	glCompileShader(shader);
 
-	GLint status;
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
-	if (!status) {
-		char buffer[1024];
-		glGetShaderInfoLog(shader, sizeof(buffer), NULL, buffer);
-		printf("Shader compile error: %s\n", buffer);
+// === iMouse: the right stick drives a cursor across the screen ===
+// Deflecting the stick counts as holding the button, like a drag on
+// Shadertoy: xy = cursor, zw = where the drag started (z < 0 once released,
+// w > 0 only on the first frame of the drag).
+void updateStickMouse(float mouse[4], float dt) {
+	static float cursorX = 640.0f, cursorY = 360.0f;
+	static float clickX = 0.0f, clickY = 0.0f;
+	static bool held = false;
+	const float deadzone = 0.2f;
+	const float speed = 720.0f; // pixels per second at full tilt
+
+	HidAnalogStickState stick = padGetStickPos(&pad, 1);
+	float sx = stick.x / (float)JOYSTICK_MAX;
+	float sy = stick.y / (float)JOYSTICK_MAX;
+	bool active = sx * sx + sy * sy > deadzone * deadzone;
+
+	bool pressed = active && !held;
+	if (active) {
+		if (pressed) {
+			clickX = cursorX;
+			clickY = cursorY;
+		}
+		cursorX += sx * speed * dt;
+		cursorY += sy * speed * dt; // stick up = screen up, same as gl_FragCoord
+		if (cursorX < 0.0f) cursorX = 0.0f;
+		if (cursorX > 1279.0f) cursorX = 1279.0f;
+		if (cursorY < 0.0f) cursorY = 0.0f;
+		if (cursorY > 719.0f) cursorY = 719.0f;
 	}
-	return shader;
+	held = active;
+
+	mouse[0] = cursorX;
+	mouse[1] = cursorY;
+	mouse[2] = held ? clickX : -clickX;
+	mouse[3] = pressed ? clickY : -clickY;
 }
 
-// === Shader state ===
-struct ShaderProgram {
-	GLuint prog;
-	GLint iResolutionLoc;
-	GLint iTimeLoc;
+// One entry of the scanned shader list, tagged with its estimated cost
+struct ShaderFile {
+	std::string path;
+	ShaderEstimate estimate;    // the shader and its buffer passes together
+	uint64_t hash;              // of the same, as readShaderSources hashes them
 };
 
-ShaderProgram loadShaderProgram(const char* fragSrc) {
-	GLuint vs = compileShader(GL_VERTEX_SHADER, vertexShaderSrc);
-	GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragSrc);
-
-	// Check if shaders compiled successfully
-	GLint vsStatus, fsStatus;
-	glGetShaderiv(vs, GL_COMPILE_STATUS, &vsStatus);
-	glGetShaderiv(fs, GL_COMPILE_STATUS, &fsStatus);
-
-	if (!vsStatus || !fsStatus) {
-		printf("Shader compilation failed! Using fallback.\n");
-		// Clean up and use fallback
-		if (vs) glDeleteShader(vs);
-		if (fs) glDeleteShader(fs);
-		return loadShaderProgram(fallbackFragmentShader);
-	}
-
-	GLuint prog = glCreateProgram();
-	glAttachShader(prog, vs);
-	glAttachShader(prog, fs);
-	glBindAttribLocation(prog, 0, "aPos");
-	glLinkProgram(prog);
-
-	// Check link status
-	GLint linkStatus;
-	glGetProgramiv(prog, GL_LINK_STATUS, &linkStatus);
-	if (!linkStatus) {
-		char buffer[1024];
-		glGetProgramInfoLog(prog, sizeof(buffer), NULL, buffer);
-		printf("Program link error: %s\n", buffer);
-		glDeleteProgram(prog);
-		return loadShaderProgram(fallbackFragmentShader);
-	}
-
-	// Clean up shaders after linking
-	glDeleteShader(vs);
-	glDeleteShader(fs);
-
-	ShaderProgram sp;
-	sp.prog = prog;
-	sp.iResolutionLoc = glGetUniformLocation(prog, "iResolution");
-	sp.iTimeLoc = glGetUniformLocation(prog, "iTime");
-
-	printf("Shader loaded successfully. iResolution loc: %d, iTime loc: %d\n",
-		sp.iResolutionLoc, sp.iTimeLoc);
-
-	return sp;
-}
+// Buffer A-D passes of the current shader (iChannel2-5)
+static ShaderBuffers shaderBuffers;
+
+// Linked programs of recently viewed shaders
+static ShaderCache shaderCache;
+// Builds the shaders either side of the current one in frame slack
+static ShaderPrefetcher shaderPrefetch;
+
+// L/R press to the first frame of the new shader
+static Uint64 switchStart = 0;
+static bool switchCached = false;
+
+// Shader picked with L/R but not built yet: the one on screen keeps
+// drawing until the prefetcher has it, so switching never drops a frame
+static int pendingShader = -1;
+static Uint64 pendingStart = 0;
+
+// Measured cost of every shader seen, and what is being measured now
+static ShaderCostDb shaderCosts;
+static std::string costPath;
+static uint64_t costHash = 0;
+static double costGpuMs = 0.0;       // sum of full-size samples
+static int costGpuSamples = 0;
+static ShaderTimerSource costTimer = SHADER_TIMER_NONE;
+static ShaderEstimate costEstimate;  // from the scan, until measured
 
 // === Load fragment shader file (with fallback) ===
-ShaderProgram loadShaderFromFile(const std::string& path) {
+// Going back to a recently viewed shader is a cache hit found with the
+// hash from the scan: no compile or link, and no sources or binaries read
+// here. requestShader swaps a hit in on the frame of the press, and
+// prefetchNeighbours doesn't have the worker read it again either.
+ShaderProgram loadShaderFromFile(ShaderFile& file) {
+	const std::string& path = file.path;
 	printf("Loading shader from: %s\n", path.c_str());
-	std::string fragSource = loadFile(path.c_str());
-	if (fragSource.empty()) {
-		printf("Shader file is empty, using fallback\n");
+
+	// The buffer targets of the shader going off screen stay with it
+	ShaderBufferTarget targets[SHADER_BUFFER_COUNT];
+	shaderBuffers.takeTargets(targets);
+	shaderCache.keepTargets(targets);
+
+	// Half built in the background: finishing it beats starting over
+	shaderPrefetch.complete(path, shaderCache);
+	ShaderSources sources;
+	if (!shaderCache.has(path, file.hash)) {
+		// Buffer A-D passes sit next to the shader as Foo.bufA.frag etc.
+		// The prefetch worker may have read them all already.
+		if (!shaderPrefetch.takeSources(path, sources) && !readShaderSources(path, sources)) {
+			printf("Failed to open shader file: %s\n", path.c_str());
+		}
+		if (sources.image.empty()) {
+			printf("Shader file is empty, using fallback\n");
+		}
+		// Edited since the scan: from now on look for what is there now
+		file.hash = sources.hash;
+	}
+	uint64_t hash = file.hash;
+
+	CachedShader cached;
+	switchCached = shaderCache.find(path, hash, cached);
+	if (switchCached) {
+		printf("Shader cache hit (%d of %d kept)\n", shaderCache.getCount(), shaderCache.getCapacity());
+	} else {
+		cached.path = path;
+		cached.hash = hash;
+		memset(cached.passes, 0, sizeof(cached.passes));
+		memset(cached.targets, 0, sizeof(cached.targets));
+		for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+			if (sources.passes[b].empty()) continue;
+			cached.passes[b] = buildShaderPass(b, sources.passes[b].c_str(), NULL, shaderBufferPath(path, b).c_str(),
+				&sources.binaries[b]);
+		}
+		cached.image = sources.image.empty() ? fallbackProgram() :
+			loadShaderProgram(sources.image.c_str(), NULL, path.c_str(), &sources.binaries[SHADER_BUFFER_COUNT]);
+		shaderCache.insert(cached);
+	}
+	shaderCache.pin(path);
+	shaderCache.takeTargets(targets);
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		shaderBuffers.usePass(b, cached.passes[b], &targets[b]);
+	}
+
+	// Measurements from now on belong to this source
+	costPath = path;
+	costHash = hash;
+	costEstimate = file.estimate;
+	costGpuMs = 0.0;
+	costGpuSamples = 0;
+	return cached.image;
+}
+
+// === Estimate what a shader will cost before it is ever compiled ===
+// The sources are hashed on the way, the same as readShaderSources does
+ShaderEstimate estimateShaderFile(const std::string& path, uint64_t& hash) {
+	ShaderEstimate estimate;
+	std::string source = loadFile(path.c_str());
+	estimateShaderCost(source.empty() ? fallbackFragmentShader : source.c_str(), estimate);
+	hash = shaderSourceHash(source.data(), source.size());
+
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		std::string bufferPath = shaderBufferPath(path, b);
+		struct stat st;
+		if (stat(bufferPath.c_str(), &st) != 0) continue;
+		std::string bufferSource = loadFile(bufferPath.c_str());
+		ShaderEstimate pass;
+		estimateShaderCost(bufferSource.c_str(), pass);
+		addShaderEstimate(estimate, pass);
+		hash = shaderSourceHash(bufferSource.data(), bufferSource.size(), hash);
 	}
-	const char* fragSrcCStr = fragSource.empty() ? fallbackFragmentShader : fragSource.c_str();
-	return loadShaderProgram(fragSrcCStr);
+	return estimate;
 }
 
 // === Recursively scan shader folder and subfolders ===
-void scanShaderFolderRecursive(const std::string& dirPath, std::vector<std::string>& files) {
+void scanShaderFolderRecursive(const std::string& dirPath, std::vector<ShaderFile>& files) {
 	DIR* dir = opendir(dirPath.c_str());
 	if (!dir) {
 		printf("Could not open directory: %s\n", dirPath.c_str());
@@ -223,18 +285,26 @@ void scanShaderFolderRecursive(const std::string& dirPath, std::vector<std::stri
 			// Recursively scan subdirectory
 			scanShaderFolderRecursive(fullPath, files);
 		}
+		// Buffer passes load with their shader, not on their own
+		else if (isShaderBufferFile(name)) {
+			continue;
+		}
 		// Check if it's a .frag file
 		else if ((name.size() > 5 && name.substr(name.size() - 5) == ".frag") || (name.size() > 5 && name.substr(name.size() - 5) == ".glsl")) {
-			files.push_back(fullPath);
-			printf("Found shader: %s\n", fullPath.c_str());
+			ShaderFile file;
+			file.path = fullPath;
+			file.estimate = estimateShaderFile(fullPath, file.hash);
+			files.push_back(file);
+			printf("Found shader: %s (%s, score %.0f)\n", fullPath.c_str(),
+				shaderCostClassName(file.estimate.costClass), file.estimate.score);
 		}
 	}
 	closedir(dir);
 }
 
 // === Scan shader folders (wrapper function) ===
-std::vector<std::string> scanShaderFolders(const char* dirPath) {
-	std::vector<std::string> files;
+std::vector<ShaderFile> scanShaderFolders(const char* dirPath) {
+	std::vector<ShaderFile> files;
 	scanShaderFolderRecursive(dirPath, files);
 	printf("Found %zu shader files in %s\n", files.size(), dirPath);
 	return files;
@@ -315,56 +385,252 @@ void checkDirectories() {
 }
 
 // === Audio globals ===
-const int FFT_SIZE = 512;   // must be power of 2
-static float audioWaveform[FFT_SIZE];
-static float audioSpectrum[FFT_SIZE / 2];
+const int AUDIO_SAMPLE_RATE = 44100;
+const int AUDIO_BUFFER_FRAMES = 1024;
+const int AUDIO_HISTORY_SECONDS = 4;
+
+// STFT over the capture ring (window/hop from settings.txt)
+static StftEngine stftEngine;
+
+// Smoothed, peak-held and gain-normalised spectrum for iChannel1
+static SpectrumSmoother spectrumSmoother;
+
+// Left/right/mid/side spectra of the newest window, smoothed with the
+// same timing and gain as the mono row
+static StereoAnalyzer stereoAnalyzer;
+static SpectrumSmoother stereoSmoother;
+
+// Band/energy scalars computed once per frame for the shader uniforms
+static AudioFeatureExtractor featureExtractor;
+static AudioFeatures audioFeatures;
 
-static kiss_fft_cfg fftCfg = nullptr;
-static kiss_fft_cpx fftIn[FFT_SIZE];
-static kiss_fft_cpx fftOut[FFT_SIZE];
+// Onset/tempo tracking, fed by the STFT on every hop
+static BeatTracker beatTracker;
 
-// OpenGL textures for audio
-GLuint audioTexWaveform;
-GLuint audioTexSpectrum;
+// Render-thread analysis cost (STFT + features + beat tracking)
+static float audioAnalysisUs = 0.0f;
+
+// iChannel0/iChannel1, allocated once and refreshed in place
+static AudioTextures audioTextures;
+static std::vector<float> bandRow;
+
+// Swap interval, 60/30/adaptive rate and frame-time stats
+static FramePacer framePacer;
+static int appliedSwapInterval = -1;
+
+// Shader pass resolution, lowered while the GPU can't keep up
+static ResolutionScaler resolutionScaler;
+static ScaledTarget scaledTarget;
+
+// GPU time of the shader passes, without stalling, where the driver can
+static GpuTimer gpuTimer;
+
+// Captured PCM history shared between the mixer thread and the renderer
+static AudioRing audioRing;
+
+// Converts the negotiated mixer format into the ring's float stereo
+static AudioCapture audioCapture;
+
+// Maps display time to the sample being heard
+static AvSync avSync;
+static uint64_t analysedNewestFrame = 0;
 
 // Music object
 Mix_Music* music = nullptr;
+// Capture and analysis are running (the mixer can be open without them)
+static bool audioAnalysis = false;
 
-// Effect callback to capture PCM
+// Effect callback to capture PCM (runs on the mixer thread, must never block)
 void audioEffectCallback(int chan, void* stream, int len, void* udata) {
-	int16_t* samples = (int16_t*)stream;
-	int count = len / 2; // 16-bit samples
-	static int idx = 0;
-	for (int i = 0; i < count; i += 2) { // left channel
-		float sample = samples[i] / 32768.0f;
-		audioWaveform[idx % FFT_SIZE] = sample;
-		idx++;
+	uint64_t start = audioRing.writePosition();
+	audioCapture.push(stream, len);
+	avSync.stampCapture(start, SDL_GetPerformanceCounter());
+}
+
+// Analyse every STFT hop captured since the last frame.
+// Returns the number of hops processed (0 = no new audio).
+int analyzeAudio() {
+	static Uint64 lastStart = 0;
+	Uint64 start = SDL_GetPerformanceCounter();
+	float dt = lastStart ? (start - lastStart) / (float)SDL_GetPerformanceFrequency() : 0.0f;
+	lastStart = start;
+
+	// Analyse up to the sample that will be audible when this frame shows
+	analysedNewestFrame = audioRing.writePosition();
+	int hops = stftEngine.process(avSync.targetFrame(start, analysedNewestFrame));
+	spectrumSmoother.update(stftEngine.getMagnitudes(), dt);
+
+	// Stereo spectra only for the newest window, once per frame
+	if (hops > 0) {
+		stereoAnalyzer.analyze(stftEngine.getAnalyzer(), stftEngine.getCaptured(), stftEngine.getChannels());
 	}
+	stereoSmoother.setGain(spectrumSmoother.getGain());
+	stereoSmoother.update(stereoAnalyzer.getRows(), dt);
+	featureExtractor.compute(spectrumSmoother.getSmoothed(), stftEngine.getSamples(), stftEngine.getSize(), audioFeatures);
+	audioAnalysisUs = (SDL_GetPerformanceCounter() - start) * 1000000.0f / SDL_GetPerformanceFrequency();
+	return hops;
 }
 
-// Compute FFT from waveform
-void computeFFT() {
-	for (int i = 0; i < FFT_SIZE; i++) {
-		fftIn[i].r = audioWaveform[i];
-		fftIn[i].i = 0;
+// Upload audio data to textures, only when a new hop was analysed
+void uploadAudioTextures(int hops) {
+	if (audioTextures.getWaveform() == 0) return; // audio failed to initialise
+	if (hops == 0) {
+		audioTextures.skip();
+		return;
 	}
-	kiss_fft(fftCfg, fftIn, fftOut);
 
-	for (int i = 0; i < FFT_SIZE / 2; i++) {
-		float mag = sqrtf(fftOut[i].r * fftOut[i].r + fftOut[i].i * fftOut[i].i);
-		audioSpectrum[i] = mag / (FFT_SIZE / 2);
+	int bins = stftEngine.getBins();
+	bandRow.resize(bins);
+	featureExtractor.fillBandRow(audioFeatures, bandRow.data());
+
+	const float* stereo = stereoSmoother.getSmoothed();
+	AudioTextureFrame frame;
+	frame.waveMono = stftEngine.getSamples();
+	frame.waveStereo = stftEngine.getChannels() == 2 ? stftEngine.getCaptured() : NULL;
+	frame.smoothed = spectrumSmoother.getSmoothed();
+	frame.peaks = spectrumSmoother.getPeaks();
+	frame.left = stereo + (size_t)bins * STEREO_ROW_LEFT;
+	frame.right = stereo + (size_t)bins * STEREO_ROW_RIGHT;
+	frame.mid = stereo + (size_t)bins * STEREO_ROW_MID;
+	frame.side = stereo + (size_t)bins * STEREO_ROW_SIDE;
+	frame.bands = bandRow.data();
+	frame.raw = stftEngine.getMagnitudes();
+	frame.rawGain = spectrumSmoother.getGain();
+	audioTextures.upload(frame);
+}
+
+// Hand the pacer's swap interval to the driver when it changes
+void applySwapInterval() {
+	int interval = framePacer.getSwapInterval();
+	if (interval == appliedSwapInterval) return;
+	if (SDL_GL_SetSwapInterval(interval) != 0) {
+		printf("Swap interval %d not supported (%s), pacing by sleeping instead\n", interval, SDL_GetError());
 	}
+	appliedSwapInterval = interval;
 }
 
-// Upload audio data to textures
-void uploadAudioTextures() {
-	// Waveform -> iChannel0
-	glBindTexture(GL_TEXTURE_2D, audioTexWaveform);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, FFT_SIZE, 1, 0, GL_LUMINANCE, GL_FLOAT, audioWaveform);
+// Sleep until `ticks` on the performance counter: the scheduler for all
+// but the last half millisecond, then spin so the wake-up is exact
+void sleepUntil(Uint64 ticks) {
+	Uint64 freq = SDL_GetPerformanceFrequency();
+	Uint64 margin = freq / 2000;
+	Uint64 now = SDL_GetPerformanceCounter();
+	if (now + margin < ticks) {
+		svcSleepThread((s64)((ticks - margin - now) * 1000000000.0 / freq));
+	}
+	while (SDL_GetPerformanceCounter() < ticks) {
+	}
+}
 
-	// Spectrum -> iChannel1
-	glBindTexture(GL_TEXTURE_2D, audioTexSpectrum);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, FFT_SIZE / 2, 1, 0, GL_LUMINANCE, GL_FLOAT, audioSpectrum);
+// Fold what the current shader cost into the database (written out every
+// SHADER_COSTS_SAVE_SECONDS and on exit, not on every switch)
+void recordShaderCost() {
+	if (costPath.empty()) return;
+	shaderCosts.record(costPath, costHash, costGpuSamples ? (float)(costGpuMs / costGpuSamples) : 0.0f, costGpuSamples,
+		costTimer, framePacer.getPercentileMs(0.5f), framePacer.getFrames(), resolutionScaler.getScale());
+	costGpuMs = 0.0;
+	costGpuSamples = 0;
+}
+
+// A shader measured before that was too heavy starts at the render scale
+// it needs, instead of finding it again over the first second. One never
+// measured goes by its scan-time estimate: heavy ones start smaller, and
+// extreme ones at 30 fps in adaptive mode.
+void applyKnownCost() {
+	const ShaderCost* cost = shaderCosts.find(costPath, costHash);
+	if (cost && cost->gpuSamples > 0) {
+		printf("Known cost: %.1f ms at full size (%d samples), %.1f ms per frame\n",
+			cost->gpuMs, cost->gpuSamples, cost->frameMs);
+		if (g_settings.dynamic_resolution) {
+			printf("Starting at render scale %.2f\n", resolutionScaler.prime(cost->gpuMs, framePacer.getTargetMs()));
+		}
+		return;
+	}
+
+	float share = shaderCostBudgetShare(costEstimate.costClass);
+	if (share <= 0.0f) return;
+	printf("Estimated %s (score %.0f): %.0f ALU, %.0f transcendental, %.0f texture ops per pixel\n",
+		shaderCostClassName(costEstimate.costClass), costEstimate.score, costEstimate.arithmetic,
+		costEstimate.transcendentals, costEstimate.textureFetches);
+	// The share is of the full-rate budget, whatever rate it starts at
+	float fullScaleMs = framePacer.getTargetMs() * share;
+	if (costEstimate.costClass == SHADER_COST_EXTREME && framePacer.startReduced(SDL_GetPerformanceCounter())) {
+		printf("Starting at 30 fps\n");
+	}
+	if (g_settings.dynamic_resolution) {
+		printf("Starting at render scale %.2f\n", resolutionScaler.prime(fullScaleMs, framePacer.getTargetMs()));
+	}
+}
+
+// A new shader has its own frame cost: report the old one and start
+// pacing and scaling over at full rate and size
+void shaderChanged() {
+	switchStart = SDL_GetPerformanceCounter();
+	recordShaderCost();
+	gpuTimer.discard();
+	framePacer.dump("previous shader");
+	framePacer.resetStats();
+	framePacer.resetAdaptive();
+	resolutionScaler.reset();
+	scaledTarget.invalidateHistory();
+}
+
+// Programs loaded from files belong to the shader cache; only the
+// no-shaders fallback is ours to delete
+void dropShader(ShaderProgram& sp) {
+	if (!shaderCache.contains(sp.prog)) deleteShaderProgram(sp.prog);
+	sp.prog = 0;
+}
+
+// Have the shaders L and R lead to built before they are pressed.
+// Ones the cache already holds under their scan hash aren't read again.
+void prefetchNeighbours(const std::vector<ShaderFile>& files, int current) {
+	pendingShader = -1;
+	std::vector<std::string> paths;
+	int count = (int)files.size();
+	// Only when the cache has room for them and the shader on screen
+	if (count > 1 && shaderCache.getCapacity() >= 1 + 2 * PREFETCH_NEIGHBOURS) {
+		for (int d = 1; d <= PREFETCH_NEIGHBOURS; d++) {
+			int sides[2] = { (current + d) % count, ((current - d) % count + count) % count };
+			for (int side : sides) {
+				const ShaderFile& file = files[side];
+				if (file.path == files[current].path || shaderCache.has(file.path, file.hash)) continue;
+				if (std::find(paths.begin(), paths.end(), file.path) == paths.end()) paths.push_back(file.path);
+			}
+		}
+	}
+	shaderPrefetch.want(paths);
+}
+
+// Switch to files[index] once it is built. A cached or prefetched
+// neighbour already is, and swaps in on this frame.
+void requestShader(const std::vector<ShaderFile>& files, int index) {
+	if (files[index].path == costPath) {
+		// Back to the one still on screen
+		prefetchNeighbours(files, index);
+		return;
+	}
+	if (pendingShader < 0) pendingStart = SDL_GetPerformanceCounter();
+	pendingShader = index;
+	if (shaderCache.has(files[index].path, files[index].hash)) return;
+	shaderPrefetch.want(std::vector<std::string>(1, files[index].path));
+}
+
+// The shader picked with L/R can be swapped in without a build
+bool pendingShaderBuilt(const std::vector<ShaderFile>& files) {
+	const ShaderFile& file = files[pendingShader];
+	return shaderCache.has(file.path, file.hash) || shaderPrefetch.isBuilt(file.path, shaderCache);
+}
+
+// Half-rate pattern for this frame: the shader's own choice, or the
+// scaler's once even the smallest render size is too slow
+HalfRatePattern halfRatePattern(const ShaderProgram& sp) {
+	switch (sp.directives.halfRate) {
+	case SHADER_HALF_RATE_CHECKERBOARD: return HALF_RATE_CHECKERBOARD;
+	case SHADER_HALF_RATE_INTERLACED: return HALF_RATE_INTERLACED;
+	case SHADER_HALF_RATE_OFF: return HALF_RATE_OFF;
+	default: return resolutionScaler.isHalfRate() ? HALF_RATE_CHECKERBOARD : HALF_RATE_OFF;
+	}
 }
 
 // Load and play a specific music file
@@ -385,32 +651,85 @@ bool loadAndPlayMusic(const std::string& musicPath) {
 		return false;
 	}
 
+	beatTracker.reset(); // new song, new tempo
+	spectrumSmoother.reset();
+	stereoSmoother.reset();
 	printf("Now playing: %s\n", musicPath.c_str());
 	return true;
 }
 
 // Initialize audio system
-bool initAudio() {
-	// Initialize SDL_mixer
-	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 1024) < 0) {
-		printf("SDL_mixer init failed: %s\n", Mix_GetError());
+// Capture and analysis of what the mixer plays. False leaves it off, and
+// the shaders see silence, but the mixer stays open for the music.
+bool initAudioAnalysis() {
+	// Capture whatever the device actually gave us, not what we asked for
+	int rate = 0, channels = 0;
+	Uint16 format = 0;
+	if (!Mix_QuerySpec(&rate, &format, &channels)) {
+		printf("Mix_QuerySpec failed: %s\n", Mix_GetError());
 		return false;
 	}
 
-	// Initialize KissFFT
-	fftCfg = kiss_fft_alloc(FFT_SIZE, 0, NULL, NULL);
+	CaptureFormat captureFormat;
+	switch (format) {
+	case AUDIO_S16SYS: captureFormat = CAPTURE_FORMAT_S16; break;
+	case AUDIO_S32SYS: captureFormat = CAPTURE_FORMAT_S32; break;
+	case AUDIO_F32SYS: captureFormat = CAPTURE_FORMAT_F32; break;
+	default:
+		printf("Unsupported mixer format 0x%04x\n", format);
+		return false;
+	}
 
-	// Initialize audio buffers
-	for (int i = 0; i < FFT_SIZE; i++) {
-		audioWaveform[i] = 0.0f;
+	// Keep a few seconds of stereo history so analysis never races the mixer
+	if (!audioRing.init(rate * AUDIO_HISTORY_SECONDS, 2, rate)) {
+		return false;
 	}
-	for (int i = 0; i < FFT_SIZE / 2; i++) {
-		audioSpectrum[i] = 0.0f;
+	if (!audioCapture.configure(&audioRing, captureFormat, channels)) {
+		audioRing.release();
+		return false;
+	}
+
+	// A mixed block is heard once the device buffer ahead of it has played
+	double outputLatency = AUDIO_BUFFER_FRAMES / (double)rate + g_settings.av_offset_ms / 1000.0;
+	avSync.configure(rate, SDL_GetPerformanceFrequency(), outputLatency);
+	avSync.setEnabled(g_settings.av_sync);
+
+	// Initialize STFT (KissFFT real-input path), falling back to defaults
+	// if settings.txt asked for something unusable
+	if (!stftEngine.init(&audioRing, g_settings.fft_size, g_settings.hop_size, g_settings.fft_window) &&
+		!stftEngine.init(&audioRing, 1024, 256, FFT_WINDOW_HANN)) {
+		audioRing.release();
+		return false;
 	}
+	spectrumSmoother.configure(stftEngine.getBins());
+	spectrumSmoother.setTimes(g_settings.spectrum_attack_ms, g_settings.spectrum_release_ms,
+		g_settings.peak_hold_ms, g_settings.peak_fall_ms);
+	spectrumSmoother.setAgc(g_settings.agc_enabled, g_settings.agc_target);
+	stereoAnalyzer.configure(stftEngine.getSize());
+	stereoSmoother.configure(stftEngine.getBins() * STEREO_ROW_COUNT);
+	stereoSmoother.setTimes(g_settings.spectrum_attack_ms, g_settings.spectrum_release_ms,
+		g_settings.peak_hold_ms, g_settings.peak_fall_ms);
+	stereoSmoother.setAgc(false, g_settings.agc_target); // follows the mono row's gain
+	featureExtractor.configure(stftEngine.getBins(), stftEngine.getBinHz());
+	beatTracker.configure(stftEngine.getBins(), stftEngine.getBinHz(),
+		rate / (float)stftEngine.getHop());
+	stftEngine.addListener(BeatTracker::onStftFrame, &beatTracker);
 
 	return true;
 }
 
+bool initAudio() {
+	// Initialize SDL_mixer
+	if (Mix_OpenAudio(AUDIO_SAMPLE_RATE, MIX_DEFAULT_FORMAT, 2, AUDIO_BUFFER_FRAMES) < 0) {
+		printf("SDL_mixer init failed: %s\n", Mix_GetError());
+		return false;
+	}
+
+	audioAnalysis = initAudioAnalysis();
+	if (!audioAnalysis) printf("Audio analysis disabled, music plays without it\n");
+	return true;
+}
+
 // Cleanup audio system
 void cleanupAudio() {
 	if (music) {
@@ -419,11 +738,7 @@ void cleanupAudio() {
 		music = nullptr;
 	}
 	Mix_CloseAudio();
-
-	if (fftCfg) {
-		kiss_fft_free(fftCfg);
-		fftCfg = nullptr;
-	}
+	audioRing.release();
 }
 
 /*
@@ -609,7 +924,7 @@ bool print_ip_local() {
 	return false;
 }
 // === Rescan functions ===
-void rescanShaders(std::vector<std::string>& shaderFiles, int& currentShader) {
+void rescanShaders(std::vector<ShaderFile>& shaderFiles, int& currentShader) {
 	printf("Rescanning shaders...\n");
 
 	// Clear current list
@@ -695,6 +1010,7 @@ int main(int argc, char* argv[]) {
 	Uint32 startTicks = SDL_GetTicks();
 	bool running = true;
 	Uint32 lastShaderChange = 0;
+	Uint32 costsSavedTicks = SDL_GetTicks();
 	int frameCount = 0;
 	//
 
@@ -747,7 +1063,7 @@ int main(int argc, char* argv[]) {
 
 	SDL_Window* window = SDL_CreateWindow("Shaderfun Switch - Audio Reactive",
 		SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-		1280, 720, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
+		SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
 
 	if (!window) {
 		printf("Failed to create window: %s\n", SDL_GetError());
@@ -760,12 +1076,19 @@ int main(int argc, char* argv[]) {
 		return -1;
 	}
 
+	// Load user settings before anything that depends on them
+	load_settings();
+	g_glState.setDebug(g_settings.gl_debug);
+
+	framePacer.configure(SDL_GetPerformanceFrequency(), 60.0f, g_settings.frame_rate);
+	applySwapInterval();
+
 	// Initialize audio system
 	bool audioInitialized = initAudio();
 	printf("Audio system %s\n", audioInitialized ? "initialized successfully" : "failed to initialize");
 
 	// Register audio effect callback
-	Mix_RegisterEffect(MIX_CHANNEL_POST, audioEffectCallback, NULL, NULL);
+	if (audioAnalysis) Mix_RegisterEffect(MIX_CHANNEL_POST, audioEffectCallback, NULL, NULL);
 
 	// Test OpenGL functionality
 	printf("OpenGL vendor: %s\n", glGetString(GL_VENDOR));
@@ -773,7 +1096,7 @@ int main(int argc, char* argv[]) {
 	printf("OpenGL version: %s\n", glGetString(GL_VERSION));
 
 	// Critical OpenGL setup
-	glViewport(0, 0, 1280, 720);
+	g_glState.viewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
 	// Test OpenGL rendering with a simple color
 	glClearColor(1.0f, 0.0f, 0.0f, 1.0f); // Red
@@ -803,32 +1126,40 @@ int main(int argc, char* argv[]) {
 	// Create VBO (Vertex Buffer Object)
 	GLuint vbo;
 	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	g_glState.bindArrayBuffer(vbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
+	// Attribute 0 stays pointed at the quad for every draw, so this is set up once
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
 	glEnableVertexAttribArray(0);
 
-	// Initialize audio textures
-	glGenTextures(1, &audioTexWaveform);
-	glBindTexture(GL_TEXTURE_2D, audioTexWaveform);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-	glGenTextures(1, &audioTexSpectrum);
-	glBindTexture(GL_TEXTURE_2D, audioTexSpectrum);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	// Initialize audio textures (sized to the analysis window, never reallocated)
+	if (stftEngine.getSize() > 0) {
+		audioTextures.init(stftEngine.getSize(), stftEngine.getBins());
+	}
+
+	// Offscreen target for rendering heavy shaders below full size or at half rate
+	resolutionScaler.configure(g_settings.dynamic_resolution ? g_settings.resolution_min_scale : 1.0f, 1.0f);
+	scaledTarget.init(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+	// Shaders that stay linked after switching away
+	shaderCache.setCapacity(g_settings.shader_cache);
+	// Shaders compiled in earlier runs, then the vertex shader and fallback every shader shares
+	g_programBinaries.init((GlProcLoader)SDL_GL_GetProcAddress, PROGRAM_BINARY_DIR, g_settings.program_cache_mb * 1024 * 1024);
+	setShaderErrorFile(SHADER_ERRORS_FILE);
+	initShaderCompiler((GlProcLoader)SDL_GL_GetProcAddress);
+	shaderPrefetch.start();
+
+	// Shader costs: timer queries where available, and what earlier runs measured
+	gpuTimer.init((GlProcLoader)SDL_GL_GetProcAddress);
+	costTimer = gpuTimer.isAvailable() ? SHADER_TIMER_QUERY : SHADER_TIMER_FINISH;
+	shaderCosts.load(SHADER_COSTS_FILE);
 
 	// Check directories first
 	checkDirectories();
 
 	// Scan shader directories with fallback logic
-	std::vector<std::string> shaderFiles;
+	std::vector<ShaderFile> shaderFiles;
 
 	// First try SDMC directory
 	shaderFiles = scanShaderFolders("sdmc:/switch/shaderfun/test");
@@ -877,8 +1208,19 @@ int main(int argc, char* argv[]) {
 	Mix_VolumeMusic(volume); // Set initial volume
 
 	ShaderProgram shader = shaderFiles.empty() ?
-		loadShaderProgram(fallbackFragmentShader) :
+		fallbackProgram() :
 		loadShaderFromFile(shaderFiles[currentShader]);
+	applyKnownCost();
+	if (!shaderFiles.empty()) prefetchNeighbours(shaderFiles, currentShader);
+
+	// Frame timing for the shader uniforms
+	Uint64 lastFrameCounter = 0;
+	float frameRate = 60.0f;
+
+	// GPU time samples taken with glFinish, when there are no timer queries
+	int finishInterval = SCALE_SAMPLE_INTERVAL;
+	int lastFinishFrame = 0;
+	uint64_t finishMissed = 0;
 
 	// Add FTP state variable
 	bool ftpEnabled = false;
@@ -886,6 +1228,7 @@ int main(int argc, char* argv[]) {
 
 	while (running) {
 		frameCount++;
+		Uint64 frameStart = SDL_GetPerformanceCounter();
 
 		padUpdate(&pad);
 		u64 kDown = padGetButtonsDown(&pad);
@@ -976,11 +1319,17 @@ int main(int argc, char* argv[]) {
 				printf("Rescanned folders - Shaders: %zu, Music: %zu\n",
 					shaderFiles.size(), musicFiles.size());
 
+				// Sources read before the rescan may be out of date
+				shaderPrefetch.want(std::vector<std::string>());
+				pendingShader = -1;
 				// Reload current shader if we have shaders
 				if (!shaderFiles.empty()) {
-					glDeleteProgram(shader.prog);
+					shaderChanged();
+					dropShader(shader);
 					shader = loadShaderFromFile(shaderFiles[currentShader]);
-					printf("Reloaded current shader: %s\n", shaderFiles[currentShader].c_str());
+					applyKnownCost();
+					prefetchNeighbours(shaderFiles, currentShader);
+					printf("Reloaded current shader: %s\n", shaderFiles[currentShader].path.c_str());
 				}
 
 				lastShaderChange = SDL_GetTicks();
@@ -990,9 +1339,14 @@ int main(int argc, char* argv[]) {
 		// For shaders only (maybe L3 button?)
 		if (kDown & HidNpadButton_StickL) {
 			rescanShaders(shaderFiles, currentShader);
+			shaderPrefetch.want(std::vector<std::string>());
+			pendingShader = -1;
 			if (!shaderFiles.empty()) {
-				glDeleteProgram(shader.prog);
+				shaderChanged();
+				dropShader(shader);
 				shader = loadShaderFromFile(shaderFiles[currentShader]);
+				applyKnownCost();
+				prefetchNeighbours(shaderFiles, currentShader);
 				printf("Reloaded shaders: %zu found\n", shaderFiles.size());
 			}
 		}
@@ -1032,14 +1386,14 @@ int main(int argc, char* argv[]) {
 				if (!shaderFiles.empty()) {
 					currentShader = (currentShader - 1 + shaderFiles.size()) % shaderFiles.size();
 					changed = true;
-					printf("Previous shader: %s\n", shaderFiles[currentShader].c_str());
+					printf("Previous shader: %s\n", shaderFiles[currentShader].path.c_str());
 				}
 			}
 			if (kDown & HidNpadButton_R) {  // Right shoulder button - Next shader
 				if (!shaderFiles.empty()) {
 					currentShader = (currentShader + 1) % shaderFiles.size();
 					changed = true;
-					printf("Next shader: %s\n", shaderFiles[currentShader].c_str());
+					printf("Next shader: %s\n", shaderFiles[currentShader].path.c_str());
 				}
 			}
 
@@ -1152,18 +1506,37 @@ int main(int argc, char* argv[]) {
 
 			if (changed) {
 				if (kDown & (HidNpadButton_L | HidNpadButton_R)) {
-					glDeleteProgram(shader.prog);
-					shader = loadShaderFromFile(shaderFiles[currentShader]);
+					requestShader(shaderFiles, currentShader);
 				}
 				lastShaderChange = SDL_GetTicks();
 			}
 		}
 
+		// The shader picked with L/R is built: swap it in
+		if (pendingShader >= 0 && pendingShaderBuilt(shaderFiles)) {
+			shaderChanged();
+			switchStart = pendingStart;
+			dropShader(shader);
+			shader = loadShaderFromFile(shaderFiles[pendingShader]);
+			printf("Shader ready to swap in after %.1f ms\n",
+				(SDL_GetPerformanceCounter() - pendingStart) * 1000.0f / SDL_GetPerformanceFrequency());
+			applyKnownCost();
+			prefetchNeighbours(shaderFiles, currentShader);
+		}
+
 		float time = (SDL_GetTicks() - startTicks) / 1000.0f;
 
+		// Frame timing for iTimeDelta / iFrameRate
+		Uint64 frameNow = SDL_GetPerformanceCounter();
+		float frameDelta = lastFrameCounter ? (frameNow - lastFrameCounter) / (float)SDL_GetPerformanceFrequency() : 0.0f;
+		lastFrameCounter = frameNow;
+		if (frameDelta > 0.0f) {
+			frameRate += (1.0f / frameDelta - frameRate) * 0.1f;
+		}
+
 		// Process audio data
-		computeFFT();
-		uploadAudioTextures();
+		int hops = audioAnalysis ? analyzeAudio() : 0;
+		uploadAudioTextures(hops);
 
 		// Debug output every 5 seconds
 		if (frameCount % 300 == 0) {
@@ -1171,47 +1544,178 @@ int main(int argc, char* argv[]) {
 				frameCount, time, currentShader + 1, shaderFiles.size(),
 				currentMusic + 1, musicFiles.size(),
 				musicPlaying ? "(Playing)" : "(Stopped)", musicPosition);
+			printf("Audio: %.0f us/frame, BPM: %.1f (conf %.2f), beats: %llu, gain: %.1f\n",
+				audioAnalysisUs, beatTracker.getBpm(), beatTracker.getConfidence(),
+				(unsigned long long)beatTracker.getBeatCount(), spectrumSmoother.getGain());
+			printf("A/V sync %s: error %.1f ms avg, %.1f ms max (unsynced lead %.1f ms)\n",
+				avSync.isEnabled() ? "on" : "off", avSync.getMeanAbsErrorMs(),
+				avSync.getMaxAbsErrorMs(), avSync.getMeanLeadMs());
+			avSync.resetStats();
+			printf("Audio textures (%s): %d uploads, %d skipped, %.0f bytes / %.0f us per upload (was %d bytes every frame)\n",
+				audioTextures.getFormat() == AUDIO_TEX_HALF_FLOAT ? "half float" : "rgba8",
+				audioTextures.getUploads(), audioTextures.getSkippedFrames(),
+				audioTextures.getBytesPerUpload(), audioTextures.getMicrosPerUpload(),
+				audioTextures.getLegacyBytesPerFrame());
+			audioTextures.resetStats();
+			printf("Frames (%s, swap interval %d): p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, missed %d of %d\n",
+				framePaceModeName(framePacer.getMode()), framePacer.getSwapInterval(),
+				framePacer.getPercentileMs(0.50f), framePacer.getPercentileMs(0.95f),
+				framePacer.getPercentileMs(0.99f), framePacer.getMissedDeadlines(), framePacer.getFrames());
+			printf("GL: %d calls last frame, %d redundant binds skipped%s\n",
+				g_glState.getFrameCalls(), g_glState.getFrameSkipped(), g_glState.isDebug() ? " (error checks on)" : "");
+			if (scaledTarget.isReady()) {
+				printf("Render scale: %.2f (%dx%d)%s, shader pass %.1f ms\n", resolutionScaler.getScale(),
+					resolutionScaler.scaled(SCREEN_WIDTH), resolutionScaler.scaled(SCREEN_HEIGHT),
+					scaledTarget.isHalfFrame() ? " at half rate" : "", resolutionScaler.getGpuMs());
+			}
 		}
 
-		glUseProgram(shader.prog);
-		glUniform3f(shader.iResolutionLoc, 1280.0f, 720.0f, 1.0f);
-		glUniform1f(shader.iTimeLoc, time);
-
-		// Bind audio textures to shader channels
-		GLint loc0 = glGetUniformLocation(shader.prog, "iChannel0");
-		if (loc0 != -1) {
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, audioTexWaveform);
-			glUniform1i(loc0, 0);
+		// Shader pass size and rate: the whole screen every frame, or less while the shader is too heavy
+		resolutionScaler.allowHalfRate(g_settings.half_rate_auto && scaledTarget.hasStencil() &&
+			shader.directives.halfRate == SHADER_HALF_RATE_AUTO);
+		HalfRatePattern halfRate = scaledTarget.hasStencil() ? halfRatePattern(shader) : HALF_RATE_OFF;
+		bool offscreen = scaledTarget.isReady() && (resolutionScaler.getScale() < 1.0f || halfRate != HALF_RATE_OFF);
+		int sceneWidth = offscreen ? resolutionScaler.scaled(SCREEN_WIDTH) : SCREEN_WIDTH;
+		int sceneHeight = offscreen ? resolutionScaler.scaled(SCREEN_HEIGHT) : SCREEN_HEIGHT;
+
+		// Everything the shader might use, then upload just what it declares
+		ShaderInputs inputs;
+		inputs.resolution[0] = (float)sceneWidth;
+		inputs.resolution[1] = (float)sceneHeight;
+		inputs.resolution[2] = 1.0f;
+		inputs.time = time;
+		inputs.timeDelta = frameDelta;
+		inputs.frame = frameCount - 1;
+		inputs.frameRate = frameRate;
+		updateDate(inputs.date);
+		updateStickMouse(inputs.mouse, frameDelta);
+		if (sceneWidth != SCREEN_WIDTH) {
+			// iMouse is in iResolution pixels
+			for (int i = 0; i < 4; i++) inputs.mouse[i] *= (i & 1) ? (float)sceneHeight / SCREEN_HEIGHT : (float)sceneWidth / SCREEN_WIDTH;
+		}
+		memset(inputs.channelResolution, 0, sizeof(inputs.channelResolution));
+		inputs.channelResolution[0] = (float)stftEngine.getSize();
+		inputs.channelResolution[1] = 1.0f;
+		inputs.channelResolution[2] = 1.0f;
+		inputs.channelResolution[3] = (float)stftEngine.getBins();
+		inputs.channelResolution[4] = (float)AUDIO_TEX_SPECTRUM_ROWS;
+		inputs.channelResolution[5] = 1.0f;
+		shaderBuffers.fillChannelResolution(inputs.channelResolution);
+		inputs.audio = audioFeatures;
+		inputs.beat = beatTracker.getBeat();
+		inputs.beatPhase = beatTracker.getBeatPhase();
+		inputs.bpm = beatTracker.getBpm();
+		inputs.stereoCorrelation = stereoAnalyzer.getCorrelation();
+
+		// Audio textures live on fixed units (samplers were pointed at them at link time)
+		g_glState.bindTexture(SHADER_UNIT_WAVEFORM, audioTextures.getWaveform());
+		g_glState.bindTexture(SHADER_UNIT_SPECTRUM, audioTextures.getSpectrum());
+
+		// Now and then, time the shader passes on the GPU to pick the next scale. A
+		// timer query costs nothing, so it always runs; without one, glFinish on both
+		// sides stalls the pipeline, so that only happens when the scale can change,
+		// and less and less often while the frame is well inside its budget.
+		bool sampleGpu = frameCount % SCALE_SAMPLE_INTERVAL == 0;
+		bool queryGpu = sampleGpu && gpuTimer.isAvailable() && gpuTimer.begin();
+		if (framePacer.getTotalMissed() != finishMissed) {
+			finishMissed = framePacer.getTotalMissed();
+			finishInterval = SCALE_SAMPLE_INTERVAL;
+		}
+		bool finishGpu = !gpuTimer.isAvailable() && frameCount - lastFinishFrame >= finishInterval &&
+			scaledTarget.isReady() && (g_settings.dynamic_resolution || g_settings.half_rate_auto);
+		Uint64 gpuStart = 0;
+		if (finishGpu) {
+			glFinish();
+			gpuStart = SDL_GetPerformanceCounter();
 		}
 
-		GLint loc1 = glGetUniformLocation(shader.prog, "iChannel1");
-		if (loc1 != -1) {
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, audioTexSpectrum);
-			glUniform1i(loc1, 1);
+		// Buffer A-D first, at the same size as the image pass
+		if (shaderBuffers.getPassCount() > 0) {
+			shaderBuffers.render(inputs, sceneWidth, sceneHeight);
 		}
 
-		glClear(GL_COLOR_BUFFER_BIT);
+		// No clear: the quad covers every pixel
+		if (offscreen) {
+			scaledTarget.begin(sceneWidth, sceneHeight, halfRate, frameCount & 1);
+		} else {
+			g_glState.bindFramebuffer(0);
+			g_glState.viewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+			scaledTarget.invalidateHistory();
+		}
 
-		// Re-bind the vertex attributes before drawing
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
-		glEnableVertexAttribArray(0);
+		g_glState.useProgram(shader.prog);
+		applyShaderUniforms(shader, inputs);
 
 		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		g_glState.count();
+
+		// Share of a full-size, full-rate frame that was shaded
+		float shaded = offscreen ? resolutionScaler.getScale() * resolutionScaler.getScale() : 1.0f;
+		if (scaledTarget.isHalfFrame()) shaded *= 0.5f;
 
-		GLenum error = glGetError();
-		if (error != GL_NO_ERROR) {
-			printf("OpenGL error: %d\n", error);
+		float gpuMs = 0.0f;
+		if (queryGpu) {
+			gpuTimer.end(shaded);
+		}
+		if (finishGpu) {
+			glFinish();
+			gpuMs = (SDL_GetPerformanceCounter() - gpuStart) * 1000.0f / SDL_GetPerformanceFrequency();
+			lastFinishFrame = frameCount;
+			finishInterval = gpuMs < framePacer.getTargetMs() * SCALE_FINISH_IDLE_SHARE ?
+				std::min(finishInterval * 2, SCALE_FINISH_MAX_INTERVAL) : SCALE_SAMPLE_INTERVAL;
+		} else if (!gpuTimer.poll(gpuMs, &shaded)) {
+			gpuMs = 0.0f;
+		}
+		if (gpuMs > 0.0f) {
+			costGpuMs += gpuMs / shaded;
+			costGpuSamples++;
+			if (resolutionScaler.update(gpuMs, framePacer.getTargetMs())) {
+				printf("Render scale %.2f (%dx%d)%s, shader pass took %.1f ms\n", resolutionScaler.getScale(),
+					resolutionScaler.scaled(SCREEN_WIDTH), resolutionScaler.scaled(SCREEN_HEIGHT),
+					resolutionScaler.isHalfRate() ? " at half rate" : "", gpuMs);
+			}
+		}
+		if (offscreen) {
+			scaledTarget.present();
 		}
 
+		g_glState.checkErrors("frame");
+		g_glState.endFrame();
+		shaderCompilerNextFrame();
+
+		float frameWorkMs = (SDL_GetPerformanceCounter() - frameStart) * 1000.0f / SDL_GetPerformanceFrequency();
+		applySwapInterval();
 		SDL_GL_SwapWindow(window);
+		Uint64 swapTicks = SDL_GetPerformanceCounter();
+		avSync.onPresent(swapTicks, stftEngine.getLastEndFrame(), analysedNewestFrame);
+
+		if (switchStart) {
+			printf("Shader switch to first frame: %.1f ms (%s)\n",
+				(swapTicks - switchStart) * 1000.0f / SDL_GetPerformanceFrequency(), switchCached ? "cached" : "compiled");
+			switchStart = 0;
+		}
+
+		// Vsync normally did the waiting already; if not, wait for the deadline
+		sleepUntil(framePacer.afterSwap(swapTicks));
 
-		// Small delay to prevent excessive CPU usage
-		SDL_Delay(16);
+		// What the next frame shouldn't need goes to building the neighbours
+		float slackMs = framePacer.getTargetMs() - frameWorkMs - PREFETCH_MARGIN_MS;
+		// A pressed shader makes progress even through heavy frames
+		if (pendingShader >= 0 && slackMs < PREFETCH_MIN_SLACK_MS) slackMs = PREFETCH_MIN_SLACK_MS;
+		// With no slack it still hands the program binaries to the worker to write
+		shaderPrefetch.update(shaderCache, slackMs >= PREFETCH_MIN_SLACK_MS ? slackMs : 0.0f);
+
+		// Only writes if a switch recorded something since the last time
+		if (SDL_GetTicks() - costsSavedTicks >= (Uint32)SHADER_COSTS_SAVE_SECONDS * 1000) {
+			shaderCosts.save(SHADER_COSTS_FILE);
+			costsSavedTicks = SDL_GetTicks();
+		}
 	}
 
+	framePacer.dump("last shader");
+	recordShaderCost();
+	shaderCosts.save(SHADER_COSTS_FILE);
+
 	// Cleanup
 	if (g_led_state) {
 		turn_led_off();
@@ -1220,9 +1724,16 @@ int main(int argc, char* argv[]) {
 	appletSetMediaPlaybackState(false); //allow switch to go back to sleep
 	ftp_cleanup(&pad);  // Pass the pad parameter
 	cleanupAudio();
-	glDeleteTextures(1, &audioTexWaveform);
-	glDeleteTextures(1, &audioTexSpectrum);
-	glDeleteProgram(shader.prog);
+	audioTextures.release();
+	scaledTarget.release();
+	shaderBuffers.release();
+	gpuTimer.release();
+	dropShader(shader);
+	shaderPrefetch.stop();
+	shaderCache.release();
+	releaseShaderCompiler();
+	setShaderErrorFile(NULL);
+	g_programBinaries.save();
 	glDeleteBuffers(1, &vbo);
 	SDL_GL_DeleteContext(glContext);
 	SDL_DestroyWindow(window);
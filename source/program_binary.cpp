@@ -0,0 +1,367 @@
+/*
+Shader Fun - Program binary cache
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include "program_binary.h"
+#include "shader_costs.h"
+#include "shader_program.h"
+#include "gl_state.h"
+
+#ifndef GL_PROGRAM_BINARY_LENGTH_OES
+#define GL_PROGRAM_BINARY_LENGTH_OES 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS_OES
+#define GL_NUM_PROGRAM_BINARY_FORMATS_OES 0x87FE
+#endif
+
+ProgramBinaryCache g_programBinaries;
+
+static const char INDEX_FILE[] = "index.csv";
+static const uint32_t BINARY_VERSION = 1;
+
+// Start of every .bin file, the program binary follows
+struct BinaryHeader {
+	char magic[4];           // "SFPB"
+	uint32_t version;
+	uint64_t driverHash;
+	uint64_t vertexHash;
+	uint64_t fragmentHash;
+	uint32_t format;         // binaryFormat from glGetProgramBinaryOES
+	uint32_t length;
+};
+
+static uint64_t nowMs() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ProgramBinaryCache::ProgramBinaryCache()
+	: getProgramBinary(NULL), programBinary(NULL), available(false), driverHash(0), vertexHash(0),
+	maxBytes(0), totalBytes(0), clock(0), dirty(false), indexWrittenMs(0), hits(0), misses(0) {
+	dir[0] = 0;
+}
+
+bool ProgramBinaryCache::init(GlProcLoader loader, const char* path, int limitBytes) {
+	available = false;
+	entries.clear();
+	pending.clear();
+	totalBytes = 0;
+
+	if (limitBytes <= 0) {
+		printf("Program binary cache off\n");
+		return false;
+	}
+	if (!glHasExtension("GL_OES_get_program_binary")) {
+		printf("No GL_OES_get_program_binary, shaders compile from source every run\n");
+		return false;
+	}
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+	getProgramBinary = (GetProgramBinaryProc)loader("glGetProgramBinaryOES");
+	programBinary = (ProgramBinaryProc)loader("glProgramBinaryOES");
+	if (formats <= 0 || !getProgramBinary || !programBinary) {
+		printf("Program binaries not supported by this driver\n");
+		return false;
+	}
+
+	snprintf(dir, sizeof(dir), "%s", path);
+	mkdir(dir, 0777);
+
+	const char* renderer = (const char*)glGetString(GL_RENDERER);
+	const char* version = (const char*)glGetString(GL_VERSION);
+	driverHash = shaderSourceHash(renderer ? renderer : "", renderer ? strlen(renderer) : 0);
+	driverHash = shaderSourceHash(version ? version : "", version ? strlen(version) : 0, driverHash);
+	vertexHash = shaderSourceHash(vertexShaderSrc, strlen(vertexShaderSrc));
+	maxBytes = (uint64_t)limitBytes;
+
+	loadIndex();
+	indexWrittenMs = nowMs();
+	available = true;
+	printf("Program binary cache: %d programs, %.1f of %.1f MB\n", (int)entries.size(),
+		totalBytes / (1024.0f * 1024.0f), maxBytes / (1024.0f * 1024.0f));
+	return true;
+}
+
+uint64_t ProgramBinaryCache::keyFor(const char* fragSrc, uint64_t* fragHash) const {
+	uint64_t hash = shaderSourceHash(fragSrc, strlen(fragSrc));
+	if (fragHash) *fragHash = hash;
+	uint64_t key = shaderSourceHash((const char*)&driverHash, sizeof(driverHash), hash);
+	return shaderSourceHash((const char*)&vertexHash, sizeof(vertexHash), key);
+}
+
+void ProgramBinaryCache::filePath(uint64_t key, char* out, size_t size) const {
+	snprintf(out, size, "%s/%016llx.bin", dir, (unsigned long long)key);
+}
+
+int ProgramBinaryCache::findEntry(uint64_t key) const {
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (entries[i].key == key) return (int)i;
+	}
+	return -1;
+}
+
+void ProgramBinaryCache::removeEntry(int index) {
+	char path[320];
+	filePath(entries[index].key, path, sizeof(path));
+	ProgramBinaryFile file;
+	file.path = path;
+	pending.push_back(file);
+	totalBytes -= entries[index].bytes;
+	entries.erase(entries.begin() + index);
+	dirty = true;
+}
+
+// The index lists the files of this driver in last-use order. Files from
+// another driver, or that the index doesn't know, are deleted.
+void ProgramBinaryCache::loadIndex() {
+	std::vector<uint64_t> files;
+	DIR* d = opendir(dir);
+	if (d) {
+		struct dirent* ent;
+		while ((ent = readdir(d)) != NULL) {
+			unsigned long long key;
+			char ext[8];
+			if (sscanf(ent->d_name, "%16llx.%7s", &key, ext) == 2 && strcmp(ext, "bin") == 0) files.push_back(key);
+		}
+		closedir(d);
+	}
+
+	char path[320];
+	snprintf(path, sizeof(path), "%s/%s", dir, INDEX_FILE);
+	FILE* f = fopen(path, "r");
+	bool sameDriver = false;
+	if (f) {
+		char line[128];
+		while (fgets(line, sizeof(line), f)) {
+			unsigned long long key, used, driver;
+			unsigned int bytes;
+			if (sscanf(line, "# driver %llx", &driver) == 1) {
+				sameDriver = driver == driverHash;
+				continue;
+			}
+			if (!sameDriver || sscanf(line, "%llx,%u,%llu", &key, &bytes, &used) != 3) continue;
+
+			for (size_t i = 0; i < files.size(); i++) {
+				if (files[i] != key) continue;
+				Entry e;
+				e.key = key;
+				e.bytes = bytes;
+				e.lastUsed = used;
+				entries.push_back(e);
+				totalBytes += bytes;
+				if (used > clock) clock = used;
+				files.erase(files.begin() + i);
+				break;
+			}
+		}
+		fclose(f);
+	}
+
+	if (!files.empty()) {
+		printf("Program binary cache: deleting %d old programs\n", (int)files.size());
+		for (uint64_t key : files) {
+			filePath(key, path, sizeof(path));
+			unlink(path);
+		}
+		dirty = true;
+	}
+	evict(0);
+}
+
+bool ProgramBinaryCache::read(const char* fragSrc, ProgramBinary& out) const {
+	out.key = 0;
+	out.format = 0;
+	out.data.clear();
+	if (!available) return false;
+	uint64_t fragHash;
+	out.key = keyFor(fragSrc, &fragHash);
+
+	char path[320];
+	filePath(out.key, path, sizeof(path));
+	FILE* f = fopen(path, "rb");
+	if (!f) return false;
+	struct stat st;
+	BinaryHeader header;
+	bool valid = fstat(fileno(f), &st) == 0 && fread(&header, sizeof(header), 1, f) == 1 &&
+		memcmp(header.magic, "SFPB", 4) == 0 && header.version == BINARY_VERSION &&
+		header.driverHash == driverHash && header.vertexHash == vertexHash && header.fragmentHash == fragHash;
+	// Never size a buffer from the header alone: it must be the rest of the file
+	valid = valid && header.length > 0 && header.length <= maxBytes &&
+		(uint64_t)st.st_size == sizeof(header) + (uint64_t)header.length;
+	if (valid) {
+		out.data.resize(header.length);
+		valid = fread(&out.data[0], 1, header.length, f) == header.length;
+	}
+	fclose(f);
+	if (!valid) {
+		out.data.clear();
+		return false;
+	}
+	out.format = header.format;
+	return true;
+}
+
+GLuint ProgramBinaryCache::create(const ProgramBinary& binary) {
+	if (!available) return 0;
+	int index = findEntry(binary.key);
+	// Nothing read: no entry, or its file not written yet or not read. The
+	// entry stays; the compile that follows stores the program again.
+	if (index < 0 || binary.data.empty()) {
+		misses++;
+		return 0;
+	}
+
+	// The file must be the one the index recorded: same size, header included
+	GLuint prog = 0;
+	if (entries[index].bytes == sizeof(BinaryHeader) + binary.data.size()) {
+		prog = glCreateProgram();
+		programBinary(prog, binary.format, &binary.data[0], (GLint)binary.data.size());
+		GLint linked = GL_FALSE;
+		glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+		if (!linked) {
+			// A refused binary may also raise GL_INVALID_ENUM; don't leave it
+			// for the next glGetError to blame on something else
+			while (glGetError() != GL_NO_ERROR) {
+			}
+			g_glState.deleteProgram(prog);
+			prog = 0;
+		}
+	}
+	if (!prog) {
+		// Not the file the index recorded, or refused by the driver: compile
+		// instead, and save again after
+		printf("Program binary %016llx unusable, compiling from source\n", (unsigned long long)binary.key);
+		removeEntry(index);
+		misses++;
+		return 0;
+	}
+
+	entries[index].lastUsed = ++clock;
+	dirty = true;
+	hits++;
+	return prog;
+}
+
+void ProgramBinaryCache::store(const char* fragSrc, GLuint prog) {
+	if (!available || !prog) return;
+	GLint length = 0;
+	glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+	if (length <= 0 || (uint64_t)length > maxBytes) return;
+
+	BinaryHeader header;
+	memcpy(header.magic, "SFPB", 4);
+	header.version = BINARY_VERSION;
+	header.driverHash = driverHash;
+	header.vertexHash = vertexHash;
+	uint64_t key = keyFor(fragSrc, &header.fragmentHash);
+
+	// The header goes in front of the binary, in one buffer for the writer
+	ProgramBinaryFile file;
+	file.contents.resize(sizeof(header) + length);
+	GLsizei written = 0;
+	GLenum format = 0;
+	getProgramBinary(prog, length, &written, &format, &file.contents[sizeof(header)]);
+	if (written <= 0) return;
+	header.format = format;
+	header.length = (uint32_t)written;
+	memcpy(&file.contents[0], &header, sizeof(header));
+	file.contents.resize(sizeof(header) + written);
+
+	char path[320];
+	filePath(key, path, sizeof(path));
+	file.path = path;
+	pending.push_back(file);
+
+	int index = findEntry(key);
+	if (index >= 0) {
+		totalBytes -= entries[index].bytes;
+		entries.erase(entries.begin() + index);
+	}
+	Entry e;
+	e.key = key;
+	e.bytes = (uint32_t)file.contents.size();
+	e.lastUsed = ++clock;
+	entries.push_back(e);
+	totalBytes += e.bytes;
+	dirty = true;
+	evict(key);
+}
+
+// Least recently used first, never the one just saved
+void ProgramBinaryCache::evict(uint64_t keep) {
+	while (totalBytes > maxBytes || (int)entries.size() > PROGRAM_BINARY_MAX_FILES) {
+		int oldest = -1;
+		for (size_t i = 0; i < entries.size(); i++) {
+			if (entries[i].key == keep) continue;
+			if (oldest < 0 || entries[i].lastUsed < entries[oldest].lastUsed) oldest = (int)i;
+		}
+		if (oldest < 0) break;
+		removeEntry(oldest);
+	}
+}
+
+void ProgramBinaryCache::queueIndex() {
+	std::string text = "# Shader Fun program binaries - delete the folder to rebuild every shader\n";
+	char line[96];
+	snprintf(line, sizeof(line), "# driver %016llx\n", (unsigned long long)driverHash);
+	text += line;
+	for (const Entry& e : entries) {
+		snprintf(line, sizeof(line), "%016llx,%u,%llu\n", (unsigned long long)e.key, e.bytes, (unsigned long long)e.lastUsed);
+		text += line;
+	}
+
+	char path[320];
+	snprintf(path, sizeof(path), "%s/%s", dir, INDEX_FILE);
+	ProgramBinaryFile file;
+	file.path = path;
+	file.contents.assign(text.begin(), text.end());
+	pending.push_back(file);
+	dirty = false;
+	indexWrittenMs = nowMs();
+}
+
+void ProgramBinaryCache::takeFileWork(std::vector<ProgramBinaryFile>& out) {
+	if (!available) return;
+	if (dirty && nowMs() - indexWrittenMs >= (uint64_t)PROGRAM_BINARY_INDEX_SECONDS * 1000) queueIndex();
+	for (ProgramBinaryFile& file : pending) {
+		out.push_back(ProgramBinaryFile());
+		out.back().path.swap(file.path);
+		out.back().contents.swap(file.contents);
+	}
+	pending.clear();
+}
+
+void ProgramBinaryCache::doFileWork(const ProgramBinaryFile& file) {
+	if (file.contents.empty()) {
+		unlink(file.path.c_str());
+		return;
+	}
+	FILE* f = fopen(file.path.c_str(), "wb");
+	if (!f) {
+		printf("Could not write %s\n", file.path.c_str());
+		return;
+	}
+	bool ok = fwrite(&file.contents[0], 1, file.contents.size(), f) == file.contents.size();
+	ok = fclose(f) == 0 && ok;
+	if (!ok) {
+		// SD card full, most likely: don't leave half a file behind. The
+		// index may still list it; a read then finds nothing and drops it.
+		printf("Could not write %s\n", file.path.c_str());
+		unlink(file.path.c_str());
+	}
+}
+
+void ProgramBinaryCache::save() {
+	if (!available) return;
+	if (dirty) queueIndex();
+	for (const ProgramBinaryFile& file : pending) doFileWork(file);
+	pending.clear();
+}
@@ -0,0 +1,117 @@
+/*
+Shader Fun - Program binary cache
+Created By MrDude
+*/
+
+#ifndef PROGRAM_BINARY_H
+#define PROGRAM_BINARY_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <GLES2/gl2.h>
+#include "gl_state.h"
+
+#define PROGRAM_BINARY_DIR "sdmc:/switch/shaderfun/program_cache"
+
+// Files kept at most, whatever their size
+const int PROGRAM_BINARY_MAX_FILES = 256;
+// The index is written at most this often while running, and on exit
+const int PROGRAM_BINARY_INDEX_SECONDS = 30;
+
+// A saved program as read from the card, not yet given to GL
+struct ProgramBinary {
+	uint64_t key;
+	uint32_t format;
+	std::vector<char> data;     // empty: nothing saved for this source
+};
+
+// A file the cache wants written (or deleted, when contents is empty).
+// Done by whoever is off the render thread; see doFileWork.
+struct ProgramBinaryFile {
+	std::string path;
+	std::vector<char> contents;
+};
+
+// Linked programs saved with GL_OES_get_program_binary, so a shader seen
+// in an earlier run loads without a compile or link. Each file is named
+// after a hash of the fragment source, the built-in vertex shader and the
+// GL_RENDERER/GL_VERSION strings, and its header repeats all three: after
+// a driver or firmware update nothing matches and the old files are
+// cleared out. An index file keeps the last-use order so that, over the
+// size limit, the least recently used programs are deleted first.
+//
+// Only read() and doFileWork() touch the SD card, and neither touches GL
+// or the index, so both are safe on a worker thread. Everything else is
+// for the render thread: store() queues its file and takeFileWork() hands
+// the queue over.
+class ProgramBinaryCache {
+public:
+	ProgramBinaryCache();
+
+	// Needs a current context. False (and isAvailable() false) when the
+	// driver can't save programs or maxBytes is 0.
+	bool init(GlProcLoader loader, const char* dir, int maxBytes);
+	bool isAvailable() const { return available; }
+
+	// The file saved for this fragment source, if any (no GL; any thread)
+	bool read(const char* fragSrc, ProgramBinary& out) const;
+	// A program linked from a binary read(), or 0: nothing was read, or the
+	// data doesn't match the index or the driver rejected it (the file is
+	// then deleted)
+	GLuint create(const ProgramBinary& binary);
+	// Queue a program just linked from fragSrc to be saved, trimming to
+	// the limits
+	void store(const char* fragSrc, GLuint prog);
+
+	// Move the queued writes and deletes to out, with the index when it
+	// changed and wasn't written in the last PROGRAM_BINARY_INDEX_SECONDS
+	void takeFileWork(std::vector<ProgramBinaryFile>& out);
+	static void doFileWork(const ProgramBinaryFile& file);
+	// Everything queued and the index, now (on exit)
+	void save();
+
+	int getHits() const { return hits; }
+	int getMisses() const { return misses; }
+
+private:
+	struct Entry {
+		uint64_t key;
+		uint32_t bytes;
+		uint64_t lastUsed;
+	};
+
+	uint64_t keyFor(const char* fragSrc, uint64_t* fragHash) const;
+	void filePath(uint64_t key, char* out, size_t size) const;
+	int findEntry(uint64_t key) const;
+	void removeEntry(int index);
+	void evict(uint64_t keep);
+	void loadIndex();
+	void queueIndex();
+
+	typedef void (GL_APIENTRY* GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length,
+		GLenum* binaryFormat, void* binary);
+	typedef void (GL_APIENTRY* ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary,
+		GLint length);
+
+	GetProgramBinaryProc getProgramBinary;
+	ProgramBinaryProc programBinary;
+
+	bool available;
+	char dir[256];
+	uint64_t driverHash;     // GL_RENDERER + GL_VERSION
+	uint64_t vertexHash;     // vertexShaderSrc
+	uint64_t maxBytes;
+	uint64_t totalBytes;
+	uint64_t clock;
+	std::vector<Entry> entries;
+	std::vector<ProgramBinaryFile> pending;
+	bool dirty;
+	uint64_t indexWrittenMs;
+	int hits;
+	int misses;
+};
+
+extern ProgramBinaryCache g_programBinaries;
+
+#endif // PROGRAM_BINARY_H
@@ -0,0 +1,336 @@
+/*
+Shader Fun - Dynamic resolution
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include "render_scale.h"
+#include "shader_program.h"
+#include "gl_state.h"
+
+#ifndef GL_DEPTH24_STENCIL8_OES
+#define GL_DEPTH24_STENCIL8_OES 0x88F0
+#endif
+
+static const float SCALE_AIM = 0.75f;      // of the budget, when picking a new scale
+static const float SCALE_HIGH = 0.85f;     // over this: too slow
+static const float SCALE_LOW = 0.60f;      // under this: room to grow
+static const int SCALE_DOWN_SAMPLES = 2;
+static const int SCALE_UP_SAMPLES = 15;
+static const float SCALE_UP_LIMIT = 0.1f;  // largest single increase
+static const float SCALE_SMOOTHING = 0.3f;
+
+// Bilinear upscale of the rendered corner. uUv.xy maps the window to the
+// corner, uUv.zw stops half a texel short of its edge so filtering never
+// pulls in stale texels from outside it.
+static const char* upscaleFragmentSrc = R"(
+precision mediump float;
+uniform sampler2D uImage;
+uniform vec4 uUv;
+varying vec2 vUV;
+void main() {
+    gl_FragColor = texture2D(uImage, min(vUV * uUv.xy, uUv.zw));
+}
+)";
+
+// Stencil mask for half-rate frames: blocks this passes get 2, the rest
+// keep the cleared 1. uPattern is 1 for a checkerboard, 0 for row pairs.
+static const char* maskFragmentSrc = R"(
+precision mediump float;
+uniform float uPattern;
+void main() {
+    vec2 block = floor(gl_FragCoord.xy * 0.5);
+    if (mod(block.x * uPattern + block.y, 2.0) < 0.5) discard;
+    gl_FragColor = vec4(0.0);
+}
+)";
+
+static GLuint linkQuadProgram(const char* fragSrc) {
+	GLuint fs = compileShader(GL_FRAGMENT_SHADER, fragSrc);
+	GLuint prog = glCreateProgram();
+	glAttachShader(prog, sharedVertexShader());
+	glAttachShader(prog, fs);
+	glBindAttribLocation(prog, 0, "aPos");
+	glLinkProgram(prog);
+	glDeleteShader(fs);
+
+	GLint linked = 0;
+	glGetProgramiv(prog, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		glDeleteProgram(prog);
+		return 0;
+	}
+	return prog;
+}
+
+ResolutionScaler::ResolutionScaler()
+	: minScale(0.5f), maxScale(1.0f), scale(1.0f), halfRateAllowed(false), halfRate(false) {
+	reset();
+}
+
+void ResolutionScaler::configure(float minS, float maxS) {
+	if (maxS > 1.0f) maxS = 1.0f;
+	if (minS < SCALE_MIN) minS = SCALE_MIN;
+	if (minS > maxS) minS = maxS;
+	minScale = minS;
+	maxScale = maxS;
+	reset();
+}
+
+void ResolutionScaler::reset() {
+	scale = maxScale;
+	smoothedMs = 0.0f;
+	samples = 0;
+	overBudget = 0;
+	underBudget = 0;
+	settling = false;
+	halfRate = false;
+}
+
+float ResolutionScaler::prime(float fullScaleMs, float budgetMs) {
+	if (fullScaleMs > budgetMs * SCALE_HIGH) {
+		float wanted = sqrtf(budgetMs * SCALE_AIM / fullScaleMs);
+		wanted = floorf(wanted / SCALE_STEP + 0.001f) * SCALE_STEP;
+		if (wanted < minScale) wanted = minScale;
+		if (wanted > maxScale) wanted = maxScale;
+		scale = wanted;
+	}
+	return scale;
+}
+
+void ResolutionScaler::allowHalfRate(bool on) {
+	halfRateAllowed = on;
+	if (!on) halfRate = false;
+}
+
+int ResolutionScaler::scaled(int size) const {
+	int s = (int)(size * scale + 0.5f);
+	return s < 1 ? 1 : s;
+}
+
+bool ResolutionScaler::update(float gpuMs, float budgetMs) {
+	if (gpuMs <= 0.0f || budgetMs <= 0.0f) return false;
+
+	// The first sample after a change can still include the old size
+	if (settling) {
+		settling = false;
+		return false;
+	}
+
+	smoothedMs = samples++ ? smoothedMs + (gpuMs - smoothedMs) * SCALE_SMOOTHING : gpuMs;
+
+	if (smoothedMs > budgetMs * SCALE_HIGH) {
+		overBudget++;
+		underBudget = 0;
+	} else if (smoothedMs < budgetMs * SCALE_LOW) {
+		underBudget++;
+		overBudget = 0;
+	} else {
+		overBudget = 0;
+		underBudget = 0;
+	}
+
+	float wanted;
+	if (overBudget >= SCALE_DOWN_SAMPLES) {
+		overBudget = 0;
+		// Nothing left to shrink: shade half the pixels per frame instead
+		if (scale <= minScale + SCALE_STEP * 0.5f) {
+			if (!halfRateAllowed || halfRate) return false;
+			halfRate = true;
+			smoothedMs = 0.0f;
+			samples = 0;
+			settling = true;
+			return true;
+		}
+		wanted = scale * sqrtf(budgetMs * SCALE_AIM / smoothedMs);
+	} else if (underBudget >= SCALE_UP_SAMPLES) {
+		underBudget = 0;
+		// Back to full rate first, once it would fit with room to spare
+		if (halfRate && smoothedMs * 2.0f < budgetMs * SCALE_LOW) {
+			halfRate = false;
+			smoothedMs = 0.0f;
+			samples = 0;
+			settling = true;
+			return true;
+		}
+		wanted = scale * sqrtf(budgetMs * SCALE_AIM / smoothedMs);
+		if (wanted > scale + SCALE_UP_LIMIT) wanted = scale + SCALE_UP_LIMIT;
+	} else {
+		return false;
+	}
+
+	// Whole steps, rounding towards the cheaper size
+	wanted = floorf(wanted / SCALE_STEP + 0.001f) * SCALE_STEP;
+	if (wanted < minScale) wanted = minScale;
+	if (wanted > maxScale) wanted = maxScale;
+	if (fabsf(wanted - scale) < SCALE_STEP * 0.5f) return false;
+
+	scale = wanted;
+	smoothedMs = 0.0f;
+	samples = 0;
+	settling = true;
+	return true;
+}
+
+ScaledTarget::ScaledTarget()
+	: fbo(0), texture(0), stencilBuffer(0), program(0), maskProgram(0), uvLocation(-1), patternLocation(-1),
+	fullWidth(0), fullHeight(0), width(0), height(0),
+	maskPattern(HALF_RATE_OFF), historyValid(false), halfFrame(false) {
+}
+
+ScaledTarget::~ScaledTarget() {
+	// GL objects go with the context; call release() while it is current
+}
+
+bool ScaledTarget::init(int w, int h) {
+	release();
+
+	glGenTextures(1, &texture);
+	g_glState.editTexture(texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	glGenFramebuffers(1, &fbo);
+	g_glState.bindFramebuffer(fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	g_glState.bindFramebuffer(0);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		printf("Scaled render target incomplete (0x%04x), dynamic resolution off\n", status);
+		release();
+		return false;
+	}
+
+	program = linkQuadProgram(upscaleFragmentSrc);
+	if (!program) {
+		printf("Upscale shader failed to link, dynamic resolution off\n");
+		release();
+		return false;
+	}
+	g_glState.useProgram(program);
+	glUniform1i(glGetUniformLocation(program, "uImage"), SCALE_BLIT_UNIT);
+	uvLocation = glGetUniformLocation(program, "uUv");
+
+	fullWidth = w;
+	fullHeight = h;
+	width = w;
+	height = h;
+	historyValid = false;
+
+	// Half-rate needs a stencil buffer; without one it just stays off
+	maskProgram = linkQuadProgram(maskFragmentSrc);
+	if (maskProgram && attachStencil()) {
+		patternLocation = glGetUniformLocation(maskProgram, "uPattern");
+	}
+	else {
+		printf("No stencil for the render target, half-rate rendering off\n");
+		g_glState.deleteProgram(maskProgram);
+		maskProgram = 0;
+	}
+	return true;
+}
+
+bool ScaledTarget::attachStencil() {
+	// Plain 8-bit stencil is core GLES2, but some drivers only take it
+	// packed with depth
+	glGenRenderbuffers(1, &stencilBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, stencilBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_STENCIL_INDEX8, fullWidth, fullHeight);
+	g_glState.bindFramebuffer(fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, stencilBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE && glHasExtension("GL_OES_packed_depth_stencil")) {
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8_OES, fullWidth, fullHeight);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, stencilBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, stencilBuffer);
+		status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	}
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, 0);
+		glDeleteRenderbuffers(1, &stencilBuffer);
+		stencilBuffer = 0;
+	}
+	g_glState.bindFramebuffer(0);
+	maskPattern = HALF_RATE_OFF;
+	return stencilBuffer != 0;
+}
+
+void ScaledTarget::buildMask(HalfRatePattern pattern) {
+	g_glState.bindFramebuffer(fbo);
+	g_glState.viewport(0, 0, fullWidth, fullHeight);
+	g_glState.stencilTest(true);
+
+	glClearStencil(1);
+	glClear(GL_STENCIL_BUFFER_BIT);
+	glStencilFunc(GL_ALWAYS, 2, 0xFF);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+	g_glState.useProgram(maskProgram);
+	glUniform1f(patternLocation, pattern == HALF_RATE_CHECKERBOARD ? 1.0f : 0.0f);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+	g_glState.count(8);
+	maskPattern = pattern;
+}
+
+void ScaledTarget::release() {
+	g_glState.deleteProgram(program);
+	g_glState.deleteProgram(maskProgram);
+	g_glState.deleteFramebuffer(fbo);
+	g_glState.deleteTexture(texture);
+	if (stencilBuffer) glDeleteRenderbuffers(1, &stencilBuffer);
+	program = 0;
+	maskProgram = 0;
+	fbo = 0;
+	texture = 0;
+	stencilBuffer = 0;
+	uvLocation = -1;
+	patternLocation = -1;
+	maskPattern = HALF_RATE_OFF;
+	historyValid = false;
+}
+
+void ScaledTarget::begin(int w, int h, HalfRatePattern pattern, int phase) {
+	// Half a frame is only worth anything on top of a whole one of the same size
+	halfFrame = pattern != HALF_RATE_OFF && stencilBuffer && historyValid && w == width && h == height;
+	if (halfFrame && pattern != maskPattern) {
+		buildMask(pattern);
+	}
+
+	width = w;
+	height = h;
+	historyValid = true;
+	g_glState.bindFramebuffer(fbo);
+	g_glState.viewport(0, 0, w, h);
+	g_glState.stencilTest(halfFrame);
+	if (halfFrame) {
+		glStencilFunc(GL_EQUAL, 1 + (phase & 1), 0xFF);
+		g_glState.count();
+	}
+}
+
+void ScaledTarget::present() {
+	g_glState.stencilTest(false);
+	g_glState.bindFramebuffer(0);
+	g_glState.viewport(0, 0, fullWidth, fullHeight);
+
+	g_glState.useProgram(program);
+	glUniform4f(uvLocation,
+		(float)width / fullWidth, (float)height / fullHeight,
+		(width - 0.5f) / fullWidth, (height - 0.5f) / fullHeight);
+	g_glState.bindTexture(SCALE_BLIT_UNIT, texture);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	g_glState.count(2);
+}
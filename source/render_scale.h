@@ -0,0 +1,144 @@
+/*
+Shader Fun - Dynamic resolution
+Created By MrDude
+*/
+
+#ifndef RENDER_SCALE_H
+#define RENDER_SCALE_H
+
+#include <GLES2/gl2.h>
+#include "gl_state.h"
+
+// Scale is per axis, so 0.5 renders a quarter of the pixels
+const float SCALE_MIN = 0.25f;
+const float SCALE_STEP = 0.05f;
+
+// Frames between GPU time samples. Each sample waits for the GPU
+// (glFinish) around the shader pass, so not every frame.
+const int SCALE_SAMPLE_INTERVAL = 4;
+// Without timer queries, glFinish samples space out, doubling up to this
+// many frames apart, while the passes take under SCALE_FINISH_IDLE_SHARE
+// of the frame budget. A missed deadline brings them back to every
+// SCALE_SAMPLE_INTERVAL frames.
+const int SCALE_FINISH_MAX_INTERVAL = 64;
+const float SCALE_FINISH_IDLE_SHARE = 0.5f;
+
+// Texture unit the upscale pass reads from, clear of every iChannel
+// (0-5) and of the scratch unit texture updates bind on
+const int SCALE_BLIT_UNIT = 6;
+static_assert(SCALE_BLIT_UNIT != GL_STATE_SCRATCH_UNIT, "no shader may sample the scratch unit");
+
+// Which half of the pixels a half-rate frame shades. Both patterns work
+// in 2x2 blocks because GPUs shade whole 2x2 quads - a per-pixel
+// checkerboard would still run the shader on every pixel.
+enum HalfRatePattern {
+	HALF_RATE_OFF,
+	HALF_RATE_CHECKERBOARD,   // alternating 2x2 blocks
+	HALF_RATE_INTERLACED      // alternating pairs of rows
+};
+
+// Picks the render scale from measured shader-pass GPU time.
+//
+// The pass cost is taken to be proportional to the pixel count, so the
+// scale that would land on 75% of the budget is sqrt(target / measured)
+// times the current one. Hysteresis keeps it from hunting: dropping needs
+// the smoothed time over 85% of the budget for 2 samples in a row,
+// rising needs it under 60% for 15 samples (about a second) and rises at
+// most one 0.1 step at a time, and the sample right after a change is
+// ignored.
+//
+// Once the scale is at its floor and still over budget, it can switch to
+// half-rate rendering instead, and switches back when twice the measured
+// half-rate cost would sit under 60% of the budget.
+class ResolutionScaler {
+public:
+	ResolutionScaler();
+
+	void configure(float minScale, float maxScale);
+	// Back to full size and full rate (a new shader)
+	void reset();
+	// Start a shader at the scale its known full-size cost calls for,
+	// instead of finding it over the first second. Returns the new scale.
+	float prime(float fullScaleMs, float budgetMs);
+	// Whether the current shader may go half-rate on its own
+	void allowHalfRate(bool on);
+
+	// One shader-pass GPU time at the current scale. Returns true if the
+	// scale or half-rate state changed.
+	bool update(float gpuMs, float budgetMs);
+
+	float getScale() const { return scale; }
+	bool isHalfRate() const { return halfRate; }
+	float getGpuMs() const { return smoothedMs; }
+	// size * scale, at least 1
+	int scaled(int size) const;
+
+private:
+	float minScale;
+	float maxScale;
+	float scale;
+	float smoothedMs;
+	int samples;
+	int overBudget;
+	int underBudget;
+	bool settling;
+	bool halfRateAllowed;
+	bool halfRate;
+};
+
+// Full-size offscreen colour target plus the bilinear upscale to the
+// window. The texture is allocated once at full size; lower scales render
+// into its bottom-left corner, so changing scale costs nothing.
+//
+// It also does half-rate rendering: a stencil mask splits the target into
+// two halves, each frame shades only one of them, and the other half is
+// simply last frame's pixels, still in the texture because it is never
+// cleared.
+class ScaledTarget {
+public:
+	ScaledTarget();
+	~ScaledTarget();
+
+	// Needs a current GL context
+	bool init(int width, int height);
+	void release();
+	bool isReady() const { return fbo != 0; }
+	bool hasStencil() const { return stencilBuffer != 0; }
+
+	// Bind the target and set the viewport to a width x height corner. With
+	// a pattern, only the half picked by phase (0/1) will be drawn - unless
+	// there is no previous frame of the same size to fill the other half.
+	void begin(int width, int height, HalfRatePattern pattern, int phase);
+	bool isHalfFrame() const { return halfFrame; }
+	// Draw the corner to the default framebuffer at full size. Uses the
+	// fullscreen quad already set up on attribute 0.
+	void present();
+	// The pixels in the target no longer match the shader (new shader, or
+	// the last frame went straight to the window)
+	void invalidateHistory() { historyValid = false; }
+
+private:
+	ScaledTarget(const ScaledTarget&);
+	ScaledTarget& operator=(const ScaledTarget&);
+
+	bool attachStencil();
+	void buildMask(HalfRatePattern pattern);
+
+	GLuint fbo;
+	GLuint texture;
+	GLuint stencilBuffer;
+	GLuint program;
+	GLuint maskProgram;
+	GLint uvLocation;
+	GLint patternLocation;
+	int fullWidth;
+	int fullHeight;
+	int width;
+	int height;
+
+	HalfRatePattern maskPattern;   // what the stencil currently holds
+	bool historyValid;
+	bool halfFrame;
+};
+
+#endif // RENDER_SCALE_H
@@ -0,0 +1,222 @@
+/*
+Shader Fun - User settings
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "settings.h"
+#include "audio_stft.h"
+
+// Default settings
+AppSettings g_settings = {
+	1024,           // fft_size
+	256,            // hop_size
+	FFT_WINDOW_HANN, // fft_window
+	10.0f,          // spectrum_attack_ms
+	150.0f,         // spectrum_release_ms
+	500.0f,         // peak_hold_ms
+	300.0f,         // peak_fall_ms
+	true,           // agc_enabled
+	0.8f,           // agc_target
+	true,           // av_sync
+	0.0f,           // av_offset_ms
+	FRAME_PACE_ADAPTIVE, // frame_rate
+	true,           // dynamic_resolution
+	0.5f,           // resolution_min_scale
+	true,           // half_rate_auto
+	8,              // shader_cache
+	32,             // program_cache_mb
+	false           // gl_debug
+};
+
+static FramePaceMode parse_frame_rate(const char* value, FramePaceMode fallback) {
+	if (strcmp(value, "60") == 0) return FRAME_PACE_60;
+	if (strcmp(value, "30") == 0) return FRAME_PACE_30;
+	if (strcmp(value, "adaptive") == 0) return FRAME_PACE_ADAPTIVE;
+	return fallback;
+}
+
+static FftWindow parse_window(const char* value, FftWindow fallback) {
+	if (strcmp(value, "none") == 0) return FFT_WINDOW_NONE;
+	if (strcmp(value, "hann") == 0) return FFT_WINDOW_HANN;
+	if (strcmp(value, "blackman") == 0) return FFT_WINDOW_BLACKMAN;
+	return fallback;
+}
+
+// === Settings File Parser ===
+bool load_settings(void) {
+	FILE* file = fopen(SETTINGS_FILE, "r");
+
+	if (!file) {
+		printf("No settings file found, using defaults\n");
+		create_default_settings();
+		return false;
+	}
+
+	char line[256];
+
+	while (fgets(line, sizeof(line), file)) {
+		// Skip empty lines and comments
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+			continue;
+		}
+
+		// Remove trailing newline
+		line[strcspn(line, "\r\n")] = 0;
+
+		// Parse key-value pairs
+		char key[64], value[128];
+		if (sscanf(line, "%63[^=]=%127[^\n]", key, value) == 2) {
+			// Trim whitespace from value
+			char* trimmed_value = value;
+			while (*trimmed_value == ' ') trimmed_value++;
+
+			if (strcmp(key, "fft_size") == 0) {
+				int size = atoi(trimmed_value);
+				if (size >= 256 && size <= 4096 && (size & (size - 1)) == 0) {
+					g_settings.fft_size = size;
+				}
+			}
+			else if (strcmp(key, "hop_size") == 0) {
+				int hop = atoi(trimmed_value);
+				if (hop > 0) {
+					g_settings.hop_size = hop;
+				}
+			}
+			else if (strcmp(key, "fft_window") == 0) {
+				g_settings.fft_window = parse_window(trimmed_value, g_settings.fft_window);
+			}
+			else if (strcmp(key, "spectrum_attack_ms") == 0) {
+				float ms = (float)atof(trimmed_value);
+				if (ms >= 0.0f) g_settings.spectrum_attack_ms = ms;
+			}
+			else if (strcmp(key, "spectrum_release_ms") == 0) {
+				float ms = (float)atof(trimmed_value);
+				if (ms >= 0.0f) g_settings.spectrum_release_ms = ms;
+			}
+			else if (strcmp(key, "peak_hold_ms") == 0) {
+				float ms = (float)atof(trimmed_value);
+				if (ms >= 0.0f) g_settings.peak_hold_ms = ms;
+			}
+			else if (strcmp(key, "peak_fall_ms") == 0) {
+				float ms = (float)atof(trimmed_value);
+				if (ms >= 0.0f) g_settings.peak_fall_ms = ms;
+			}
+			else if (strcmp(key, "agc") == 0) {
+				g_settings.agc_enabled = strcmp(trimmed_value, "true") == 0 || strcmp(trimmed_value, "1") == 0;
+			}
+			else if (strcmp(key, "agc_target") == 0) {
+				float target = (float)atof(trimmed_value);
+				if (target > 0.0f && target <= 1.0f) g_settings.agc_target = target;
+			}
+			else if (strcmp(key, "av_sync") == 0) {
+				g_settings.av_sync = strcmp(trimmed_value, "true") == 0 || strcmp(trimmed_value, "1") == 0;
+			}
+			else if (strcmp(key, "av_offset_ms") == 0) {
+				float ms = (float)atof(trimmed_value);
+				if (ms >= -500.0f && ms <= 500.0f) g_settings.av_offset_ms = ms;
+			}
+			else if (strcmp(key, "frame_rate") == 0) {
+				g_settings.frame_rate = parse_frame_rate(trimmed_value, g_settings.frame_rate);
+			}
+			else if (strcmp(key, "dynamic_resolution") == 0) {
+				g_settings.dynamic_resolution = strcmp(trimmed_value, "true") == 0 || strcmp(trimmed_value, "1") == 0;
+			}
+			else if (strcmp(key, "resolution_min_scale") == 0) {
+				float scale = (float)atof(trimmed_value);
+				if (scale >= 0.25f && scale <= 1.0f) g_settings.resolution_min_scale = scale;
+			}
+			else if (strcmp(key, "half_rate") == 0) {
+				if (strcmp(trimmed_value, "auto") == 0) g_settings.half_rate_auto = true;
+				else if (strcmp(trimmed_value, "off") == 0) g_settings.half_rate_auto = false;
+			}
+			else if (strcmp(key, "shader_cache") == 0) {
+				int shaders = atoi(trimmed_value);
+				if (shaders >= 1 && shaders <= 32) g_settings.shader_cache = shaders;
+			}
+			else if (strcmp(key, "program_cache_mb") == 0) {
+				int mb = atoi(trimmed_value);
+				if (mb >= 0 && mb <= 256) g_settings.program_cache_mb = mb;
+			}
+			else if (strcmp(key, "gl_debug") == 0) {
+				g_settings.gl_debug = strcmp(trimmed_value, "true") == 0 || strcmp(trimmed_value, "1") == 0;
+			}
+		}
+	}
+
+	fclose(file);
+
+	// Hop can never exceed the window, nor be so small that hops pile up
+	if (g_settings.hop_size > g_settings.fft_size) {
+		g_settings.hop_size = g_settings.fft_size;
+	}
+	if (g_settings.hop_size < g_settings.fft_size / STFT_MAX_OVERLAP) {
+		g_settings.hop_size = g_settings.fft_size / STFT_MAX_OVERLAP;
+	}
+
+	printf("Settings loaded from %s\n", SETTINGS_FILE);
+	return true;
+}
+
+// === Create default settings file ===
+void create_default_settings(void) {
+	FILE* file = fopen(SETTINGS_FILE, "w");
+
+	if (!file) {
+		return;
+	}
+
+	fprintf(file, "# Shader Fun Settings\n");
+	fprintf(file, "# Created automatically - modify as needed\n\n");
+
+	fprintf(file, "# Audio analysis window in samples (256, 512, 1024, 2048, 4096)\n");
+	fprintf(file, "# Bigger windows resolve bass better but react slower\n");
+	fprintf(file, "fft_size=%d\n\n", g_settings.fft_size);
+
+	fprintf(file, "# Samples between analysed windows (fft_size/8 - fft_size)\n");
+	fprintf(file, "hop_size=%d\n\n", g_settings.hop_size);
+
+	fprintf(file, "# Analysis window function (none/hann/blackman)\n");
+	fprintf(file, "fft_window=%s\n\n", fftWindowName(g_settings.fft_window));
+
+	fprintf(file, "# Spectrum texture smoothing in milliseconds (0 = off)\n");
+	fprintf(file, "spectrum_attack_ms=%.0f\n", g_settings.spectrum_attack_ms);
+	fprintf(file, "spectrum_release_ms=%.0f\n\n", g_settings.spectrum_release_ms);
+
+	fprintf(file, "# Peak-hold row: hold time, then fall time, in milliseconds\n");
+	fprintf(file, "peak_hold_ms=%.0f\n", g_settings.peak_hold_ms);
+	fprintf(file, "peak_fall_ms=%.0f\n\n", g_settings.peak_fall_ms);
+
+	fprintf(file, "# Automatic gain so quiet and loud tracks look the same (true/false)\n");
+	fprintf(file, "agc=%s\n", g_settings.agc_enabled ? "true" : "false");
+	fprintf(file, "# Level (0 - 1) the loudest part of the spectrum is scaled to\n");
+	fprintf(file, "agc_target=%.2f\n\n", g_settings.agc_target);
+
+	fprintf(file, "# Delay the analysis so visuals match the sound you hear (true/false)\n");
+	fprintf(file, "av_sync=%s\n", g_settings.av_sync ? "true" : "false");
+	fprintf(file, "# Extra audio latency in ms, e.g. for Bluetooth/TV output (+ = visuals later)\n");
+	fprintf(file, "av_offset_ms=%.0f\n\n", g_settings.av_offset_ms);
+
+	fprintf(file, "# Frame rate: 60, 30, or adaptive (60, dropping to 30 for heavy shaders)\n");
+	fprintf(file, "frame_rate=%s\n\n", framePaceModeName(g_settings.frame_rate));
+
+	fprintf(file, "# Render heavy shaders at a lower resolution and upscale (true/false)\n");
+	fprintf(file, "dynamic_resolution=%s\n", g_settings.dynamic_resolution ? "true" : "false");
+	fprintf(file, "# Smallest scale per axis (0.25 - 1.0, 0.5 = 640x360)\n");
+	fprintf(file, "resolution_min_scale=%.2f\n", g_settings.resolution_min_scale);
+	fprintf(file, "# Past that, shade half the pixels each frame and keep the rest (auto/off)\n");
+	fprintf(file, "half_rate=%s\n\n", g_settings.half_rate_auto ? "auto" : "off");
+
+	fprintf(file, "# Shaders kept compiled so switching back to them is instant (1 - 32)\n");
+	fprintf(file, "shader_cache=%d\n\n", g_settings.shader_cache);
+
+	fprintf(file, "# SD card space for compiled shaders, so they load without compiling next time (MB, 0 - 256, 0 = off)\n");
+	fprintf(file, "program_cache_mb=%d\n\n", g_settings.program_cache_mb);
+
+	fprintf(file, "# Check for OpenGL errors every frame - for shader debugging, costs speed (true/false)\n");
+	fprintf(file, "gl_debug=%s\n", g_settings.gl_debug ? "true" : "false");
+
+	fclose(file);
+}
@@ -0,0 +1,49 @@
+/*
+Shader Fun - User settings
+Created By MrDude
+*/
+
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include "audio_fft.h"
+#include "frame_pacer.h"
+
+#define SETTINGS_FILE "sdmc:/switch/shaderfun/settings.txt"
+
+// === Settings Structure ===
+typedef struct {
+	// Audio analysis (STFT)
+	int fft_size;           // 256 - 4096, power of two
+	int hop_size;           // samples between analysed windows
+	FftWindow fft_window;
+
+	// Spectrum texture (iChannel1) smoothing
+	float spectrum_attack_ms;   // how fast bins rise
+	float spectrum_release_ms;  // how fast bins fall
+	float peak_hold_ms;         // how long peaks stay put
+	float peak_fall_ms;         // how fast held peaks drop afterwards
+	bool agc_enabled;           // normalise loudness across tracks
+	float agc_target;           // 0 - 1, level the loudest bin settles at
+
+	// Audio/visual sync
+	bool av_sync;               // aim analysis at the sample being heard
+	float av_offset_ms;         // extra output latency (+ = visuals later)
+
+	// Display
+	FramePaceMode frame_rate;   // 60, 30 or adaptive
+	bool dynamic_resolution;    // render heavy shaders smaller and upscale
+	float resolution_min_scale; // 0.25 - 1, per axis
+	bool half_rate_auto;        // shade half the pixels per frame when even that is too slow
+	int shader_cache;           // shaders kept linked for instant switching (1 - 32)
+	int program_cache_mb;       // linked programs saved to the SD card (0 = off)
+	bool gl_debug;              // glGetError every frame (slow)
+} AppSettings;
+
+extern AppSettings g_settings;
+
+// Load SETTINGS_FILE over the defaults; writes a default file if missing
+bool load_settings(void);
+void create_default_settings(void);
+
+#endif // SETTINGS_H
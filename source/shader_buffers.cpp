@@ -0,0 +1,211 @@
+/*
+Shader Fun - Multipass buffers
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include "shader_buffers.h"
+#include "gl_state.h"
+
+#ifndef GL_HALF_FLOAT_OES
+#define GL_HALF_FLOAT_OES 0x8D61
+#endif
+
+static const char BUFFER_LETTERS[SHADER_BUFFER_COUNT] = { 'A', 'B', 'C', 'D' };
+
+std::string shaderBufferPath(const std::string& imagePath, int buffer) {
+	size_t dot = imagePath.rfind('.');
+	size_t slash = imagePath.rfind('/');
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = imagePath.size();
+	return imagePath.substr(0, dot) + ".buf" + BUFFER_LETTERS[buffer] + imagePath.substr(dot);
+}
+
+bool isShaderBufferFile(const std::string& name) {
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		char tag[8] = ".bufX.";
+		tag[4] = BUFFER_LETTERS[b];
+		if (name.find(tag) != std::string::npos) return true;
+	}
+	return false;
+}
+
+ShaderBuffers::ShaderBuffers() : width(0), height(0) {
+	memset(passes, 0, sizeof(passes));
+}
+
+ShaderBuffers::~ShaderBuffers() {
+	// GL objects go with the context; call release() while it is current
+}
+
+ShaderProgram buildShaderPass(int buffer, const char* src, ShaderBuildTimes* times, const char* name, ProgramBinary* binary) {
+	ShaderProgram program = loadShaderProgram(src, times, name, binary);
+	if (program.fallback) {
+		// The resident fallback, not ours to delete
+		printf("Buffer %c failed to build, its channel stays black\n", BUFFER_LETTERS[buffer]);
+		program.prog = 0;
+		return program;
+	}
+	printf("Buffer %c loaded (iChannel%d)\n", BUFFER_LETTERS[buffer], SHADER_UNIT_BUFFER0 + buffer);
+	return program;
+}
+
+bool ShaderBuffers::setPass(int buffer, const char* src, ShaderBuildTimes* times, const char* name, ProgramBinary* binary) {
+	if (buffer < 0 || buffer >= SHADER_BUFFER_COUNT) return false;
+	ShaderProgram program = buildShaderPass(buffer, src, times, name, binary);
+	usePass(buffer, program);
+	passes[buffer].ownsProgram = program.prog != 0;
+	return program.prog != 0;
+}
+
+void ShaderBuffers::usePass(int buffer, const ShaderProgram& program, ShaderBufferTarget* target) {
+	if (buffer < 0 || buffer >= SHADER_BUFFER_COUNT) return;
+	Pass& pass = passes[buffer];
+	freeShaderBufferTarget(pass.target);
+	if (pass.ownsProgram) deleteShaderProgram(pass.program.prog);
+	memset(&pass, 0, sizeof(pass));
+	if (target) {
+		if (program.prog) pass.target = *target;
+		else freeShaderBufferTarget(*target);
+		memset(target, 0, sizeof(*target));
+	}
+	if (!program.prog) return;
+
+	// Sized on the next render, unless the target already is
+	pass.program = program;
+}
+
+void ShaderBuffers::takeTargets(ShaderBufferTarget* out) {
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		out[b] = passes[b].target;
+		memset(&passes[b].target, 0, sizeof(passes[b].target));
+	}
+}
+
+void ShaderBuffers::release() {
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		freeShaderBufferTarget(passes[b].target);
+		if (passes[b].ownsProgram) deleteShaderProgram(passes[b].program.prog);
+	}
+	memset(passes, 0, sizeof(passes));
+	width = height = 0;
+}
+
+int ShaderBuffers::getPassCount() const {
+	int count = 0;
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		if (passes[b].program.prog) count++;
+	}
+	return count;
+}
+
+void freeShaderBufferTarget(ShaderBufferTarget& target) {
+	for (int i = 0; i < 2; i++) {
+		g_glState.deleteFramebuffer(target.fbos[i]);
+		g_glState.deleteTexture(target.textures[i]);
+	}
+	memset(&target, 0, sizeof(target));
+}
+
+bool ShaderBuffers::allocate(Pass& pass) {
+	ShaderBufferTarget& target = pass.target;
+	freeShaderBufferTarget(target);
+	// Failed or not, this size has had its try
+	target.width = width;
+	target.height = height;
+
+	// Half-float keeps feedback effects from banding or sticking at 1.0,
+	// but only some GPUs can render to it
+	static int canRenderHalf = -1;
+	static bool halfLinear = false;
+	if (canRenderHalf < 0) {
+		canRenderHalf = glHasExtension("GL_OES_texture_half_float") && glHasExtension("GL_EXT_color_buffer_half_float");
+		halfLinear = glHasExtension("GL_OES_texture_half_float_linear");
+	}
+	bool tryHalf = canRenderHalf && pass.program.directives.bufferFormat == SHADER_BUFFER_HALF_FLOAT;
+
+	for (int attempt = tryHalf ? 0 : 1; attempt < 2; attempt++) {
+		target.halfFloat = attempt == 0;
+		GLenum type = target.halfFloat ? GL_HALF_FLOAT_OES : GL_UNSIGNED_BYTE;
+		GLint filter = target.halfFloat && !halfLinear ? GL_NEAREST : GL_LINEAR;
+
+		bool complete = true;
+		for (int i = 0; i < 2; i++) {
+			glGenTextures(1, &target.textures[i]);
+			g_glState.editTexture(target.textures[i]);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, type, NULL);
+
+			glGenFramebuffers(1, &target.fbos[i]);
+			g_glState.bindFramebuffer(target.fbos[i]);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.textures[i], 0);
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+				complete = false;
+				break;
+			}
+			// New texture contents are undefined; feedback needs a clean start
+			g_glState.viewport(0, 0, width, height);
+			glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+		if (complete) {
+			target.front = 0;
+			return true;
+		}
+		freeShaderBufferTarget(target);
+		target.width = width;
+		target.height = height;
+	}
+	printf("Could not create a %dx%d buffer render target\n", width, height);
+	return false;
+}
+
+void ShaderBuffers::bindOutputs() {
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		const Pass& pass = passes[b];
+		g_glState.bindTexture(SHADER_UNIT_BUFFER0 + b, pass.target.textures[0] ? pass.target.textures[pass.target.front] : 0);
+	}
+}
+
+void ShaderBuffers::render(const ShaderInputs& in, int w, int h) {
+	width = w;
+	height = h;
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		const ShaderBufferTarget& target = passes[b].target;
+		if (passes[b].program.prog && (target.width != w || target.height != h)) allocate(passes[b]);
+	}
+
+	// The half-rate mask belongs to the scaled target, not these
+	g_glState.stencilTest(false);
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		Pass& pass = passes[b];
+		if (!pass.program.prog || !pass.target.textures[0]) continue;
+
+		bindOutputs();
+		int back = pass.target.front ^ 1;
+		g_glState.bindFramebuffer(pass.target.fbos[back]);
+		g_glState.viewport(0, 0, width, height);
+		g_glState.useProgram(pass.program.prog);
+		applyShaderUniforms(pass.program, in);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		g_glState.count();
+		pass.target.front = back;
+	}
+	bindOutputs();
+}
+
+void ShaderBuffers::fillChannelResolution(float* channelResolution) const {
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		float* r = channelResolution + (SHADER_UNIT_BUFFER0 + b) * 3;
+		bool live = passes[b].target.textures[0] != 0;
+		r[0] = live ? (float)width : 0.0f;
+		r[1] = live ? (float)height : 0.0f;
+		r[2] = live ? 1.0f : 0.0f;
+	}
+}
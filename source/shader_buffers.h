@@ -0,0 +1,94 @@
+/*
+Shader Fun - Multipass buffers
+Created By MrDude
+*/
+
+#ifndef SHADER_BUFFERS_H
+#define SHADER_BUFFERS_H
+
+#include <string>
+#include <GLES2/gl2.h>
+#include "shader_program.h"
+
+// Shadertoy-style Buffer A-D. "Foo.bufA.frag" next to "Foo.frag" is
+// rendered before Foo every frame, and its output is iChannel2 (A) to
+// iChannel5 (D) in every pass - a pass reading its own channel, or one
+// that runs after it, sees the previous frame.
+const int SHADER_BUFFER_COUNT = 4;
+
+// "dir/Foo.frag" -> "dir/Foo.bufA.frag" (buffer 0)
+std::string shaderBufferPath(const std::string& imagePath, int buffer);
+// "Foo.bufA.frag" and friends are passes, not shaders of their own
+bool isShaderBufferFile(const std::string& name);
+
+// Build one pass program. A pass that doesn't compile comes back with
+// prog 0 (its channel reads black) rather than as the fallback shader.
+// name is the pass's file, for the error record.
+ShaderProgram buildShaderPass(int buffer, const char* src, ShaderBuildTimes* times = NULL, const char* name = NULL,
+	ProgramBinary* binary = NULL);
+
+// Each buffer is a pair of textures: the pass reads last frame's
+// output (front) while drawing into the other (back), then they swap.
+// They are sized to the render resolution and cleared to 0 whenever it
+// changes.
+struct ShaderBufferTarget {
+	GLuint textures[2];
+	GLuint fbos[2];
+	int front;
+	int width;
+	int height;
+	bool halfFloat;
+};
+
+// Delete a target's textures and FBOs and zero it (context current)
+void freeShaderBufferTarget(ShaderBufferTarget& target);
+
+class ShaderBuffers {
+public:
+	ShaderBuffers();
+	~ShaderBuffers();
+
+	// Build a pass from source with buildShaderPass; the program is
+	// deleted again on release()
+	bool setPass(int buffer, const char* src, ShaderBuildTimes* times = NULL, const char* name = NULL,
+		ProgramBinary* binary = NULL);
+	// Run a program someone else owns (the shader cache) as a pass;
+	// release() leaves it alone. target, if given, is taken over: the
+	// textures this program drew into last time, kept unless the size
+	// changed.
+	void usePass(int buffer, const ShaderProgram& program, ShaderBufferTarget* target = NULL);
+	// Hand every pass's target to the caller (out[SHADER_BUFFER_COUNT])
+	// instead of deleting them
+	void takeTargets(ShaderBufferTarget* out);
+	// Every pass and texture (call with the context current)
+	void release();
+
+	int getPassCount() const;
+	bool hasPass(int buffer) const { return passes[buffer].program.prog != 0; }
+
+	// Run the passes in A-D order at width x height, then leave their
+	// outputs bound for the image pass
+	void render(const ShaderInputs& in, int width, int height);
+	void bindOutputs();
+
+	// iChannelResolution entries for the buffer channels
+	void fillChannelResolution(float* channelResolution) const;
+
+private:
+	ShaderBuffers(const ShaderBuffers&);
+	ShaderBuffers& operator=(const ShaderBuffers&);
+
+	struct Pass {
+		ShaderProgram program;
+		ShaderBufferTarget target;
+		bool ownsProgram;
+	};
+
+	bool allocate(Pass& pass);
+
+	Pass passes[SHADER_BUFFER_COUNT];
+	int width;
+	int height;
+};
+
+#endif // SHADER_BUFFERS_H
@@ -0,0 +1,147 @@
+/*
+Shader Fun - Linked program cache
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "shader_cache.h"
+#include "shader_costs.h"
+#include "gl_state.h"
+
+static bool readFile(const std::string& path, std::string& out) {
+	out.clear();
+	FILE* f = fopen(path.c_str(), "rb");
+	if (!f) return false;
+	char buffer[4096];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) out.append(buffer, n);
+	fclose(f);
+	return true;
+}
+
+bool readShaderSources(const std::string& path, ShaderSources& out) {
+	out.path = path;
+	bool found = readFile(path, out.image);
+	out.hash = shaderSourceHash(out.image.data(), out.image.size());
+	g_programBinaries.read(out.image.c_str(), out.binaries[SHADER_BUFFER_COUNT]);
+
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		std::string bufferPath = shaderBufferPath(path, b);
+		struct stat st;
+		out.passes[b].clear();
+		out.binaries[b].data.clear();
+		if (stat(bufferPath.c_str(), &st) != 0) continue;
+		readFile(bufferPath, out.passes[b]);
+		out.hash = shaderSourceHash(out.passes[b].data(), out.passes[b].size(), out.hash);
+		if (!out.passes[b].empty()) g_programBinaries.read(out.passes[b].c_str(), out.binaries[b]);
+	}
+	return found;
+}
+
+ShaderCache::ShaderCache() : capacity(8), clock(0), hits(0), misses(0) {
+}
+
+void ShaderCache::setCapacity(int shaders) {
+	if (shaders < 1) shaders = 1;
+	if (shaders > SHADER_CACHE_MAX) shaders = SHADER_CACHE_MAX;
+	capacity = shaders;
+	evict();
+}
+
+bool ShaderCache::find(const std::string& path, uint64_t hash, CachedShader& out) {
+	for (CachedShader& entry : entries) {
+		if (entry.hash == hash && entry.path == path) {
+			entry.lastUsed = ++clock;
+			out = entry;
+			hits++;
+			return true;
+		}
+	}
+	misses++;
+	return false;
+}
+
+bool ShaderCache::has(const std::string& path, uint64_t hash) const {
+	for (const CachedShader& entry : entries) {
+		if (entry.hash == hash && entry.path == path) return true;
+	}
+	return false;
+}
+
+void ShaderCache::insert(const CachedShader& shader) {
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (entries[i].path == shader.path) {
+			erase(i);
+			break;
+		}
+	}
+	entries.push_back(shader);
+	entries.back().lastUsed = ++clock;
+	evict();
+}
+
+bool ShaderCache::contains(GLuint prog) const {
+	if (!prog) return false;
+	for (const CachedShader& entry : entries) {
+		if (entry.image.prog == prog) return true;
+		for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+			if (entry.passes[b].prog == prog) return true;
+		}
+	}
+	return false;
+}
+
+void ShaderCache::keepTargets(ShaderBufferTarget* targets) {
+	for (CachedShader& entry : entries) {
+		if (entry.path != pinned) continue;
+		for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+			freeShaderBufferTarget(entry.targets[b]);
+			entry.targets[b] = targets[b];
+			memset(&targets[b], 0, sizeof(targets[b]));
+		}
+		return;
+	}
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) freeShaderBufferTarget(targets[b]);
+}
+
+void ShaderCache::takeTargets(ShaderBufferTarget* out) {
+	memset(out, 0, sizeof(ShaderBufferTarget) * SHADER_BUFFER_COUNT);
+	for (CachedShader& entry : entries) {
+		if (entry.path != pinned) continue;
+		for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+			out[b] = entry.targets[b];
+			memset(&entry.targets[b], 0, sizeof(entry.targets[b]));
+		}
+		return;
+	}
+}
+
+void ShaderCache::release() {
+	while (!entries.empty()) erase(entries.size() - 1);
+}
+
+void ShaderCache::erase(size_t index) {
+	CachedShader& entry = entries[index];
+	deleteShaderProgram(entry.image.prog);
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		deleteShaderProgram(entry.passes[b].prog);
+		freeShaderBufferTarget(entry.targets[b]);
+	}
+	entries.erase(entries.begin() + index);
+}
+
+void ShaderCache::evict() {
+	while ((int)entries.size() > capacity) {
+		// The newest entry and the one on screen always stay
+		size_t oldest = entries.size();
+		for (size_t i = 0; i + 1 < entries.size(); i++) {
+			if (entries[i].path == pinned) continue;
+			if (oldest == entries.size() || entries[i].lastUsed < entries[oldest].lastUsed) oldest = i;
+		}
+		if (oldest == entries.size()) break;
+		printf("Shader cache: dropping %s\n", entries[oldest].path.c_str());
+		erase(oldest);
+	}
+}
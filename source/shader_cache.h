@@ -0,0 +1,94 @@
+/*
+Shader Fun - Linked program cache
+Created By MrDude
+*/
+
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <GLES2/gl2.h>
+#include "shader_buffers.h"
+#include "shader_program.h"
+
+// Shaders kept linked at most (settings.txt shader_cache)
+const int SHADER_CACHE_MAX = 32;
+
+// The sources of one shader and its Buffer A-D passes, as read from disk.
+// An empty pass source means no pass.
+struct ShaderSources {
+	std::string path;
+	uint64_t hash;          // everything below, as shaderSourceHash
+	std::string image;      // empty: the file is empty or unreadable
+	std::string passes[SHADER_BUFFER_COUNT];
+	ProgramBinary binaries[SHADER_BUFFER_COUNT + 1];   // saved programs: passes, then the image
+};
+
+// Read a shader and the Foo.bufA.frag etc. passes next to it, with any
+// programs saved for them (safe off the render thread - no GL)
+bool readShaderSources(const std::string& path, ShaderSources& out);
+
+// Everything one shader draws with: its image program and Buffer A-D pass
+// programs (prog 0 where there is no pass, or it didn't build)
+struct CachedShader {
+	std::string path;
+	uint64_t hash;          // shader + buffer sources, as shaderSourceHash
+	ShaderProgram image;
+	ShaderProgram passes[SHADER_BUFFER_COUNT];
+	// What the passes drew into, kept while another shader is on screen
+	ShaderBufferTarget targets[SHADER_BUFFER_COUNT];
+	uint64_t lastUsed;
+};
+
+// Recently used shaders stay linked, so going back to one costs a
+// glUseProgram instead of a compile and link. Entries are keyed by path
+// and source hash: an edited shader misses and replaces its old entry.
+// Once over capacity the least recently used entry is deleted.
+class ShaderCache {
+public:
+	ShaderCache();
+
+	// Shaders to keep, 1 - SHADER_CACHE_MAX; evicts down to it
+	void setCapacity(int shaders);
+	int getCapacity() const { return capacity; }
+
+	// Copy of the entry for exactly this source, now the most recently used
+	bool find(const std::string& path, uint64_t hash, CachedShader& out);
+	// Whether it is there, without counting as a use
+	bool has(const std::string& path, uint64_t hash) const;
+	// Takes over the programs. Replaces any entry with the same path, then
+	// evicts down to capacity (never the one just added).
+	void insert(const CachedShader& shader);
+
+	// The shader on screen is never evicted, however old its last use
+	void pin(const std::string& path) { pinned = path; }
+	// Store the buffer targets of the pinned shader as it leaves the
+	// screen (deleted if it has no entry), and take them back out when it
+	// returns. Arrays of SHADER_BUFFER_COUNT; taken over either way.
+	void keepTargets(ShaderBufferTarget* targets);
+	void takeTargets(ShaderBufferTarget* out);
+
+	// Whether a program belongs to some entry (and so isn't the caller's to delete)
+	bool contains(GLuint prog) const;
+	// Delete every program and target (call with the context current)
+	void release();
+
+	int getCount() const { return (int)entries.size(); }
+	int getHits() const { return hits; }
+	int getMisses() const { return misses; }
+
+private:
+	void erase(size_t index);
+	void evict();
+
+	std::vector<CachedShader> entries;
+	std::string pinned;
+	int capacity;
+	uint64_t clock;
+	int hits;
+	int misses;
+};
+
+#endif // SHADER_CACHE_H
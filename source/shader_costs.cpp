@@ -0,0 +1,149 @@
+/*
+Shader Fun - Shader cost database
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shader_costs.h"
+
+// Older measurements stop counting for more than this many samples, so a
+// shader that got cheaper (driver update, new firmware) catches up
+static const int MAX_WEIGHT_SAMPLES = 2000;
+
+static const char* TIMER_NAMES[] = { "none", "finish", "query" };
+
+uint64_t shaderSourceHash(const char* data, size_t length, uint64_t seed) {
+	uint64_t hash = seed;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static ShaderTimerSource parseTimer(const char* value) {
+	for (int i = 0; i < 3; i++) {
+		if (strcmp(value, TIMER_NAMES[i]) == 0) return (ShaderTimerSource)i;
+	}
+	return SHADER_TIMER_NONE;
+}
+
+ShaderCostDb::ShaderCostDb() : dirty(false) {
+}
+
+bool ShaderCostDb::load(const char* file) {
+	entries.clear();
+	dirty = false;
+
+	FILE* f = fopen(file, "r");
+	if (!f) {
+		printf("No shader cost file yet (%s)\n", file);
+		return false;
+	}
+
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\r\n")] = 0;
+		// Comments and the column header
+		if (line[0] != '"') continue;
+
+		char* end = strchr(line + 1, '"');
+		if (!end || end[1] != ',') continue;
+		*end = 0;
+
+		ShaderCost cost;
+		cost.path = line + 1;
+		char timer[16];
+		unsigned long long hash = 0;
+		if (sscanf(end + 2, "%llx,%f,%d,%15[^,],%f,%d,%f", &hash, &cost.gpuMs, &cost.gpuSamples, timer,
+			&cost.frameMs, &cost.frames, &cost.scale) != 7) {
+			continue;
+		}
+		cost.hash = hash;
+		cost.timer = parseTimer(timer);
+		entries.push_back(cost);
+	}
+	fclose(f);
+	printf("Loaded costs for %d shaders\n", (int)entries.size());
+	return true;
+}
+
+bool ShaderCostDb::save(const char* file) {
+	if (!dirty) return true;
+
+	FILE* f = fopen(file, "w");
+	if (!f) {
+		printf("Could not write %s\n", file);
+		return false;
+	}
+	fprintf(f, "# Shader Fun - measured shader costs, written automatically\n");
+	fprintf(f, "# gpu_ms: shader passes scaled to 1280x720 at full rate, frame_ms: median swap to swap\n");
+	fprintf(f, "path,hash,gpu_ms,gpu_samples,timer,frame_ms,frames,scale\n");
+	for (const ShaderCost& c : entries) {
+		fprintf(f, "\"%s\",%016llx,%.3f,%d,%s,%.2f,%d,%.2f\n", c.path.c_str(), (unsigned long long)c.hash,
+			c.gpuMs, c.gpuSamples, TIMER_NAMES[c.timer], c.frameMs, c.frames, c.scale);
+	}
+	fclose(f);
+	dirty = false;
+	return true;
+}
+
+const ShaderCost* ShaderCostDb::find(const std::string& path, uint64_t hash) const {
+	for (const ShaderCost& c : entries) {
+		if (c.hash == hash && c.path == path) return &c;
+	}
+	return NULL;
+}
+
+static float blend(float old, int oldCount, float value, int count) {
+	if (oldCount > MAX_WEIGHT_SAMPLES) oldCount = MAX_WEIGHT_SAMPLES;
+	return (old * oldCount + value * count) / (oldCount + count);
+}
+
+void ShaderCostDb::record(const std::string& path, uint64_t hash, float gpuMs, int gpuSamples, ShaderTimerSource timer,
+	float frameMs, int frames, float scale) {
+	if (gpuSamples <= 0 && frames <= 0) return;
+
+	ShaderCost* cost = NULL;
+	for (ShaderCost& c : entries) {
+		if (c.path == path) {
+			cost = &c;
+			break;
+		}
+	}
+	if (!cost) {
+		entries.push_back(ShaderCost());
+		cost = &entries.back();
+		cost->path = path;
+		cost->hash = hash + 1;  // forces the reset below
+	}
+	// A different source: the old numbers describe something else
+	if (cost->hash != hash) {
+		cost->hash = hash;
+		cost->gpuMs = 0.0f;
+		cost->gpuSamples = 0;
+		cost->timer = SHADER_TIMER_NONE;
+		cost->frameMs = 0.0f;
+		cost->frames = 0;
+	}
+
+	if (gpuSamples > 0) {
+		// Timer queries beat glFinish timing, which includes the stall itself
+		if (timer > cost->timer) {
+			cost->gpuSamples = 0;
+			cost->timer = timer;
+		}
+		if (timer == cost->timer) {
+			cost->gpuMs = blend(cost->gpuMs, cost->gpuSamples, gpuMs, gpuSamples);
+			cost->gpuSamples += gpuSamples;
+		}
+	}
+	if (frames > 0) {
+		cost->frameMs = blend(cost->frameMs, cost->frames, frameMs, frames);
+		cost->frames += frames;
+	}
+	cost->scale = scale;
+	dirty = true;
+}
@@ -0,0 +1,68 @@
+/*
+Shader Fun - Shader cost database
+Created By MrDude
+*/
+
+#ifndef SHADER_COSTS_H
+#define SHADER_COSTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define SHADER_COSTS_FILE "sdmc:/switch/shaderfun/shader_costs.csv"
+// While running, new measurements are written out at most this often
+const int SHADER_COSTS_SAVE_SECONDS = 60;
+
+// FNV-1a over the shader source; pass the previous result as seed to
+// hash several files (the shader and its buffer passes) together
+const uint64_t SHADER_HASH_SEED = 14695981039346656037ull;
+uint64_t shaderSourceHash(const char* data, size_t length, uint64_t seed = SHADER_HASH_SEED);
+
+enum ShaderTimerSource {
+	SHADER_TIMER_NONE,      // no GPU time, only swap-to-swap
+	SHADER_TIMER_FINISH,    // glFinish on both sides of the passes
+	SHADER_TIMER_QUERY      // GL_EXT_disjoint_timer_query
+};
+
+// What one shader has been measured to cost. gpuMs is scaled up to the
+// full 1280x720 at full rate (cost taken as proportional to the pixels
+// shaded), so runs at different render scales can be combined.
+struct ShaderCost {
+	std::string path;
+	uint64_t hash;          // of the source the numbers belong to
+	float gpuMs;
+	int gpuSamples;
+	ShaderTimerSource timer;
+	float frameMs;          // median swap-to-swap time
+	int frames;
+	float scale;            // render scale it was last left at
+};
+
+// Shader path + source hash -> measured cost, kept in a CSV file so it
+// survives restarts and opens in a spreadsheet. Editing a shader changes
+// its hash, and the old numbers are replaced by the next measurement.
+class ShaderCostDb {
+public:
+	ShaderCostDb();
+
+	bool load(const char* file);
+	// Only writes when something changed since the load or the last save
+	bool save(const char* file);
+
+	// Numbers for exactly this source, or NULL
+	const ShaderCost* find(const std::string& path, uint64_t hash) const;
+
+	// Merge one viewing's measurements in, weighted by sample counts
+	void record(const std::string& path, uint64_t hash, float gpuMs, int gpuSamples, ShaderTimerSource timer,
+		float frameMs, int frames, float scale);
+
+	int getCount() const { return (int)entries.size(); }
+
+private:
+	std::vector<ShaderCost> entries;
+	bool dirty;
+};
+
+#endif // SHADER_COSTS_H
@@ -0,0 +1,463 @@
+/*
+Shader Fun - Static shader cost estimate
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "shader_estimate.h"
+
+// Relative cost of one operation of each kind. Transcendentals run on the
+// special function units at a quarter of the ALU rate; a texture fetch
+// also pays for memory.
+static const float WEIGHT_ARITHMETIC = 1.0f;
+static const float WEIGHT_TRANSCENDENTAL = 4.0f;
+static const float WEIGHT_TEXTURE = 8.0f;
+
+// Score limits of each class. The 60 fps budget at 1280x720 works out at a
+// few thousand operations per pixel on the Switch GPU.
+static const float SCORE_MODERATE = 300.0f;
+static const float SCORE_HEAVY = 1500.0f;
+static const float SCORE_EXTREME = 6000.0f;
+
+// Trip counts above this are taken to be typos or sentinels
+static const float MAX_TRIPS = 10000.0f;
+
+// Calls nested deeper than this aren't followed (GLSL has no recursion,
+// so only a broken source gets there)
+static const int MAX_CALL_DEPTH = 16;
+
+static const char* TEXTURE_CALLS[] = {
+	"texture2D", "texture2DLod", "texture2DProj", "texture2DProjLod", "texture2DLodEXT",
+	"textureCube", "textureCubeLod", "texture", "textureLod", "texelFetch", NULL
+};
+
+static const char* TRANSCENDENTAL_CALLS[] = {
+	"sin", "cos", "tan", "asin", "acos", "atan", "sinh", "cosh", "tanh",
+	"pow", "exp", "exp2", "log", "log2", "sqrt", "inversesqrt", NULL
+};
+
+// Constructors and qualifiers look like calls but cost nothing by themselves
+static const char* FREE_CALLS[] = {
+	"float", "int", "bool", "vec2", "vec3", "vec4", "ivec2", "ivec3", "ivec4",
+	"bvec2", "bvec3", "bvec4", "mat2", "mat3", "mat4", "if", "return", NULL
+};
+
+enum TokenType {
+	TOKEN_NAME,
+	TOKEN_NUMBER,
+	TOKEN_PUNCT
+};
+
+struct Token {
+	TokenType type;
+	std::string text;
+	float value;
+};
+
+struct FunctionBody {
+	int begin;    // first token inside the braces
+	int end;      // the closing brace
+};
+
+struct Costs {
+	float arithmetic;
+	float transcendentals;
+	float textureFetches;
+	int unknownLoops;
+};
+
+static bool inList(const char* const* list, const std::string& name) {
+	for (int i = 0; list[i]; i++) {
+		if (name == list[i]) return true;
+	}
+	return false;
+}
+
+static bool isNumber(const char* p) {
+	return isdigit((unsigned char)p[0]) || (p[0] == '.' && isdigit((unsigned char)p[1]));
+}
+
+// Drop comments, turn "#define NAME number" into a constant and skip other
+// preprocessor lines, then split the rest into tokens
+static void tokenize(const char* src, std::vector<Token>& tokens, std::map<std::string, float>& constants) {
+	static const char* TWO_CHAR[] = { "++", "--", "+=", "-=", "*=", "/=", "<=", ">=", "==", "!=", "&&", "||", NULL };
+	bool lineStart = true;
+
+	const char* p = src;
+	while (*p) {
+		if (p[0] == '/' && p[1] == '/') {
+			while (*p && *p != '\n') p++;
+			continue;
+		}
+		if (p[0] == '/' && p[1] == '*') {
+			const char* close = strstr(p + 2, "*/");
+			p = close ? close + 2 : p + strlen(p);
+			continue;
+		}
+		if (*p == '\n') {
+			lineStart = true;
+			p++;
+			continue;
+		}
+		if (isspace((unsigned char)*p)) {
+			p++;
+			continue;
+		}
+		if (*p == '#' && lineStart) {
+			char name[64];
+			float value;
+			if (sscanf(p, "#%*[ \t]define %63s %f", name, &value) == 2 || sscanf(p, "#define %63s %f", name, &value) == 2) {
+				constants[name] = value;
+			}
+			while (*p && *p != '\n') p++;
+			continue;
+		}
+		lineStart = false;
+
+		Token t;
+		t.value = 0.0f;
+		if (isalpha((unsigned char)*p) || *p == '_') {
+			const char* start = p;
+			while (isalnum((unsigned char)*p) || *p == '_') p++;
+			t.type = TOKEN_NAME;
+			t.text.assign(start, p - start);
+		} else if (isNumber(p)) {
+			char* end;
+			t.type = TOKEN_NUMBER;
+			t.value = strtof(p, &end);
+			p = end;
+			// 1.0f / 2u suffixes
+			while (isalpha((unsigned char)*p)) p++;
+		} else {
+			t.type = TOKEN_PUNCT;
+			t.text.assign(p, 1);
+			for (int i = 0; TWO_CHAR[i]; i++) {
+				if (strncmp(p, TWO_CHAR[i], 2) == 0) {
+					t.text = TWO_CHAR[i];
+					break;
+				}
+			}
+			p += t.text.size();
+		}
+		tokens.push_back(t);
+	}
+}
+
+static bool isPunct(const std::vector<Token>& tokens, int i, const char* text) {
+	return i >= 0 && i < (int)tokens.size() && tokens[i].type == TOKEN_PUNCT && tokens[i].text == text;
+}
+
+// Index of the bracket that closes the one at `open`, or `end` if none
+static int matching(const std::vector<Token>& tokens, int open, int end) {
+	const std::string& opener = tokens[open].text;
+	const char* closer = opener == "(" ? ")" : opener == "{" ? "}" : "]";
+	int depth = 0;
+	for (int i = open; i < end; i++) {
+		if (tokens[i].type != TOKEN_PUNCT) continue;
+		if (tokens[i].text == opener) depth++;
+		else if (tokens[i].text == closer && --depth == 0) return i;
+	}
+	return end;
+}
+
+// "const float STEPS = 64.0;" and "int n = 8;" anywhere in the source. A
+// name assigned twice keeps its last value - close enough for bounds.
+static void collectConstants(const std::vector<Token>& tokens, std::map<std::string, float>& constants) {
+	for (int i = 0; i + 4 < (int)tokens.size(); i++) {
+		if (tokens[i].type != TOKEN_NAME || (tokens[i].text != "int" && tokens[i].text != "float")) continue;
+		if (tokens[i + 1].type != TOKEN_NAME || !isPunct(tokens, i + 2, "=")) continue;
+		int v = i + 3;
+		float sign = 1.0f;
+		if (isPunct(tokens, v, "-")) {
+			sign = -1.0f;
+			v++;
+		}
+		if (tokens[v].type == TOKEN_NUMBER && (isPunct(tokens, v + 1, ";") || isPunct(tokens, v + 1, ","))) {
+			constants[tokens[i + 1].text] = sign * tokens[v].value;
+		}
+	}
+}
+
+// A literal or constant, optionally negated or wrapped in int()/float()
+static bool constantValue(const std::vector<Token>& tokens, int begin, int end,
+	const std::map<std::string, float>& constants, float& value) {
+	float sign = 1.0f;
+	if (isPunct(tokens, begin, "-")) {
+		sign = -1.0f;
+		begin++;
+	}
+	if (end - begin == 4 && tokens[begin].type == TOKEN_NAME && isPunct(tokens, begin + 1, "(") && isPunct(tokens, end - 1, ")") &&
+		(tokens[begin].text == "int" || tokens[begin].text == "float")) {
+		begin += 2;
+		end--;
+	}
+	if (end - begin != 1) return false;
+
+	const Token& t = tokens[begin];
+	if (t.type == TOKEN_NUMBER) {
+		value = sign * t.value;
+		return true;
+	}
+	if (t.type == TOKEN_NAME) {
+		std::map<std::string, float>::const_iterator it = constants.find(t.text);
+		if (it == constants.end()) return false;
+		value = sign * it->second;
+		return true;
+	}
+	return false;
+}
+
+static int findPunct(const std::vector<Token>& tokens, int begin, int end, const char* text) {
+	for (int i = begin; i < end; i++) {
+		if (isPunct(tokens, i, text)) return i;
+	}
+	return -1;
+}
+
+// Iterations of "for (init; cond; step)", the header being tokens
+// [begin, end). Negative when the bounds aren't known.
+static float forTrips(const std::vector<Token>& tokens, int begin, int end, const std::map<std::string, float>& constants) {
+	int semi1 = findPunct(tokens, begin, end, ";");
+	int semi2 = semi1 < 0 ? -1 : findPunct(tokens, semi1 + 1, end, ";");
+	if (semi2 < 0) return -1.0f;
+
+	// init: [type] var = start
+	int assign = findPunct(tokens, begin, semi1, "=");
+	if (assign <= begin || tokens[assign - 1].type != TOKEN_NAME) return -1.0f;
+	const std::string& var = tokens[assign - 1].text;
+	float start;
+	if (!constantValue(tokens, assign + 1, semi1, constants, start)) return -1.0f;
+
+	// cond: var op limit, or limit op var
+	int c = semi1 + 1;
+	if (semi2 - c < 3) return -1.0f;
+	std::string op;
+	float limit;
+	if (tokens[c].type == TOKEN_NAME && tokens[c].text == var) {
+		op = tokens[c + 1].text;
+		if (!constantValue(tokens, c + 2, semi2, constants, limit)) return -1.0f;
+	} else if (tokens[semi2 - 1].type == TOKEN_NAME && tokens[semi2 - 1].text == var) {
+		const std::string& reversed = tokens[semi2 - 2].text;
+		op = reversed == "<" ? ">" : reversed == ">" ? "<" : reversed == "<=" ? ">=" : reversed == ">=" ? "<=" : reversed;
+		if (!constantValue(tokens, c, semi2 - 2, constants, limit)) return -1.0f;
+	} else {
+		return -1.0f;
+	}
+
+	// step: var++, ++var, var--, --var, var += n, var -= n, var = var + n
+	int s = semi2 + 1;
+	float step = 0.0f;
+	if (findPunct(tokens, s, end, "++") >= 0) {
+		step = 1.0f;
+	} else if (findPunct(tokens, s, end, "--") >= 0) {
+		step = -1.0f;
+	} else {
+		int op2 = findPunct(tokens, s, end, "+=");
+		if (op2 < 0) op2 = findPunct(tokens, s, end, "-=");
+		if (op2 >= 0) {
+			if (!constantValue(tokens, op2 + 1, end, constants, step)) return -1.0f;
+			if (tokens[op2].text == "-=") step = -step;
+		} else {
+			int eq = findPunct(tokens, s, end, "=");
+			if (eq < 0 || end - eq != 4 || tokens[eq + 1].text != var) return -1.0f;
+			if (!constantValue(tokens, eq + 3, end, constants, step)) return -1.0f;
+			if (tokens[eq + 2].text == "-") step = -step;
+			else if (tokens[eq + 2].text != "+") return -1.0f;
+		}
+	}
+	if (step == 0.0f) return -1.0f;
+
+	float trips;
+	if (op == "<" && step > 0.0f) trips = ceilf((limit - start) / step);
+	else if (op == "<=" && step > 0.0f) trips = floorf((limit - start) / step) + 1.0f;
+	else if (op == ">" && step < 0.0f) trips = ceilf((start - limit) / -step);
+	else if (op == ">=" && step < 0.0f) trips = floorf((start - limit) / -step) + 1.0f;
+	else if (op == "!=") trips = fabsf((limit - start) / step);
+	else return -1.0f;
+
+	if (trips < 0.0f) trips = 0.0f;
+	if (trips > MAX_TRIPS) trips = MAX_TRIPS;
+	return trips;
+}
+
+class Estimator {
+public:
+	Estimator(const std::vector<Token>& t, const std::map<std::string, float>& c) : tokens(t), constants(c) {
+		findFunctions();
+	}
+
+	bool costOf(const std::string& name, Costs& out, int depth) {
+		std::map<std::string, FunctionBody>::const_iterator fn = functions.find(name);
+		if (fn == functions.end() || depth > MAX_CALL_DEPTH) return false;
+
+		std::map<std::string, Costs>::const_iterator done = known.find(name);
+		if (done != known.end()) {
+			out = done->second;
+			return true;
+		}
+		Costs c = Costs();
+		walk(fn->second.begin, fn->second.end, 1.0f, c, depth);
+		known[name] = c;
+		out = c;
+		return true;
+	}
+
+private:
+	// "type name(params) {" at the top level; prototypes end in ';' instead
+	void findFunctions() {
+		int depth = 0;
+		for (int i = 0; i < (int)tokens.size(); i++) {
+			if (isPunct(tokens, i, "{")) depth++;
+			else if (isPunct(tokens, i, "}")) depth--;
+			if (depth != 0 || i < 1) continue;
+			if (tokens[i].type != TOKEN_NAME || tokens[i - 1].type != TOKEN_NAME || !isPunct(tokens, i + 1, "(")) continue;
+
+			int close = matching(tokens, i + 1, (int)tokens.size());
+			if (!isPunct(tokens, close + 1, "{")) continue;
+			FunctionBody body;
+			body.begin = close + 2;
+			body.end = matching(tokens, close + 1, (int)tokens.size());
+			functions[tokens[i].text] = body;
+			i = body.end;
+		}
+	}
+
+	// Where the statement starting at `i` ends (its closing brace or semicolon)
+	int statementEnd(int i, int end) {
+		if (isPunct(tokens, i, "{")) return matching(tokens, i, end);
+		int depth = 0;
+		for (; i < end; i++) {
+			if (tokens[i].type != TOKEN_PUNCT) continue;
+			const std::string& p = tokens[i].text;
+			if (p == "(" || p == "{") depth++;
+			else if (p == ")" || p == "}") depth--;
+			else if (p == ";" && depth == 0) return i;
+		}
+		return end;
+	}
+
+	void walk(int begin, int end, float mult, Costs& c, int depth) {
+		for (int i = begin; i < end; i++) {
+			const Token& t = tokens[i];
+
+			if (t.type == TOKEN_PUNCT) {
+				const std::string& p = t.text;
+				if (p == "+" || p == "-" || p == "*" || p == "/" || p == "+=" || p == "-=" || p == "*=" || p == "/=") {
+					c.arithmetic += mult;
+				}
+				continue;
+			}
+			if (t.type != TOKEN_NAME) continue;
+
+			if ((t.text == "for" || t.text == "while") && isPunct(tokens, i + 1, "(")) {
+				int close = matching(tokens, i + 1, end);
+				float trips = t.text == "for" ? forTrips(tokens, i + 2, close, constants) : -1.0f;
+				if (trips < 0.0f) {
+					trips = (float)ESTIMATE_UNKNOWN_TRIPS;
+					c.unknownLoops++;
+				}
+				int bodyEnd = statementEnd(close + 1, end);
+				// The header runs once per iteration too
+				walk(i + 2, close, mult * trips, c, depth);
+				walk(close + 1, bodyEnd, mult * trips, c, depth);
+				i = bodyEnd;
+				continue;
+			}
+			if (t.text == "do") {
+				int bodyEnd = statementEnd(i + 1, end);
+				c.unknownLoops++;
+				walk(i + 1, bodyEnd, mult * ESTIMATE_UNKNOWN_TRIPS, c, depth);
+				// Skip the trailing while (cond);
+				i = bodyEnd;
+				if (i + 2 < end && tokens[i + 1].text == "while" && isPunct(tokens, i + 2, "(")) {
+					int close = matching(tokens, i + 2, end);
+					walk(i + 3, close, mult * ESTIMATE_UNKNOWN_TRIPS, c, depth);
+					i = close;
+				}
+				continue;
+			}
+
+			if (!isPunct(tokens, i + 1, "(")) continue;
+			if (inList(TEXTURE_CALLS, t.text)) {
+				c.textureFetches += mult;
+			} else if (inList(TRANSCENDENTAL_CALLS, t.text)) {
+				c.transcendentals += mult;
+			} else if (!inList(FREE_CALLS, t.text)) {
+				Costs callee;
+				if (costOf(t.text, callee, depth + 1)) {
+					c.arithmetic += callee.arithmetic * mult;
+					c.transcendentals += callee.transcendentals * mult;
+					c.textureFetches += callee.textureFetches * mult;
+					c.unknownLoops += callee.unknownLoops;
+				} else {
+					// Any other built-in: dot, mix, length, normalize, ...
+					c.arithmetic += mult;
+				}
+			}
+		}
+	}
+
+	const std::vector<Token>& tokens;
+	const std::map<std::string, float>& constants;
+	std::map<std::string, FunctionBody> functions;
+	std::map<std::string, Costs> known;
+};
+
+const char* shaderCostClassName(ShaderCostClass costClass) {
+	switch (costClass) {
+	case SHADER_COST_LIGHT: return "light";
+	case SHADER_COST_MODERATE: return "moderate";
+	case SHADER_COST_HEAVY: return "heavy";
+	case SHADER_COST_EXTREME: return "extreme";
+	}
+	return "unknown";
+}
+
+static void classify(ShaderEstimate& e) {
+	e.score = e.arithmetic * WEIGHT_ARITHMETIC + e.transcendentals * WEIGHT_TRANSCENDENTAL +
+		e.textureFetches * WEIGHT_TEXTURE;
+	if (e.score >= SCORE_EXTREME) e.costClass = SHADER_COST_EXTREME;
+	else if (e.score >= SCORE_HEAVY) e.costClass = SHADER_COST_HEAVY;
+	else if (e.score >= SCORE_MODERATE) e.costClass = SHADER_COST_MODERATE;
+	else e.costClass = SHADER_COST_LIGHT;
+}
+
+void estimateShaderCost(const char* src, ShaderEstimate& out) {
+	std::vector<Token> tokens;
+	std::map<std::string, float> constants;
+	tokenize(src ? src : "", tokens, constants);
+	collectConstants(tokens, constants);
+
+	Estimator estimator(tokens, constants);
+	Costs c = Costs();
+	estimator.costOf("main", c, 0);
+
+	out.arithmetic = c.arithmetic;
+	out.transcendentals = c.transcendentals;
+	out.textureFetches = c.textureFetches;
+	out.unknownLoops = c.unknownLoops;
+	classify(out);
+}
+
+void addShaderEstimate(ShaderEstimate& total, const ShaderEstimate& pass) {
+	total.arithmetic += pass.arithmetic;
+	total.transcendentals += pass.transcendentals;
+	total.textureFetches += pass.textureFetches;
+	total.unknownLoops += pass.unknownLoops;
+	classify(total);
+}
+
+float shaderCostBudgetShare(ShaderCostClass costClass) {
+	switch (costClass) {
+	case SHADER_COST_HEAVY: return 1.5f;
+	case SHADER_COST_EXTREME: return 3.0f;
+	default: return 0.0f;
+	}
+}
@@ -0,0 +1,48 @@
+/*
+Shader Fun - Static shader cost estimate
+Created By MrDude
+*/
+
+#ifndef SHADER_ESTIMATE_H
+#define SHADER_ESTIMATE_H
+
+// Loops whose bounds aren't constants (uniforms, while loops) are taken
+// to run this many times
+const int ESTIMATE_UNKNOWN_TRIPS = 16;
+
+// Rough per-pixel cost, from the source alone
+enum ShaderCostClass {
+	SHADER_COST_LIGHT,
+	SHADER_COST_MODERATE,
+	SHADER_COST_HEAVY,        // likely over the 60 fps budget at full size
+	SHADER_COST_EXTREME       // likely needs the lowest scale, or 30 fps
+};
+
+const char* shaderCostClassName(ShaderCostClass costClass);
+
+// Operations one pixel runs, with loop trip counts multiplied out and
+// user functions counted at every call
+struct ShaderEstimate {
+	float arithmetic;         // operators and cheap built-ins (dot, mix, ...)
+	float transcendentals;    // sin, cos, pow, exp, log, atan, ...
+	float textureFetches;
+	int unknownLoops;         // loops counted at ESTIMATE_UNKNOWN_TRIPS
+	float score;              // weighted sum of the above
+	ShaderCostClass costClass;
+};
+
+// Count what main() does in a fragment shader. No compiler involved, so
+// it is cheap enough to run while scanning: comments and preprocessor
+// lines are dropped (simple numeric #defines are kept as constants), for
+// loops are sized from literal or constant bounds, and both sides of
+// every branch are counted.
+void estimateShaderCost(const char* src, ShaderEstimate& out);
+
+// Fold a buffer pass into its shader's estimate (every pass runs per pixel)
+void addShaderEstimate(ShaderEstimate& total, const ShaderEstimate& pass);
+
+// Full-size GPU time to assume for a class, as a multiple of the frame
+// budget, until the shader has been measured (0 = no reason to expect trouble)
+float shaderCostBudgetShare(ShaderCostClass costClass);
+
+#endif // SHADER_ESTIMATE_H
@@ -0,0 +1,294 @@
+/*
+Shader Fun - Neighbouring shader prefetch
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include "shader_prefetch.h"
+#include "gl_state.h"
+
+static bool contains(const std::vector<std::string>& list, const std::string& path) {
+	return std::find(list.begin(), list.end(), path) != list.end();
+}
+
+ShaderPrefetcher::ShaderPrefetcher()
+	: running(false), quit(false), stage(0), busy(false), warmTexture(0), warmFbo(0), built(0) {
+	mutexInit(&mutex);
+	condvarInit(&wake);
+	memset(&thread, 0, sizeof(thread));
+}
+
+bool ShaderPrefetcher::start() {
+	if (running) return true;
+	quit = false;
+	// Below the render thread's priority: reading can always wait a frame
+	Result rc = threadCreate(&thread, workerMain, this, NULL, 0x10000, 0x2D, -2);
+	if (R_FAILED(rc)) {
+		printf("Shader prefetch: could not create the worker (0x%x), reading on the render thread\n", rc);
+		return false;
+	}
+	rc = threadStart(&thread);
+	if (R_FAILED(rc)) {
+		printf("Shader prefetch: could not start the worker (0x%x), reading on the render thread\n", rc);
+		threadClose(&thread);
+		return false;
+	}
+	running = true;
+	return true;
+}
+
+void ShaderPrefetcher::stop() {
+	if (running) {
+		mutexLock(&mutex);
+		quit = true;
+		condvarWakeAll(&wake);
+		mutexUnlock(&mutex);
+		threadWaitForExit(&thread);
+		threadClose(&thread);
+		running = false;
+	}
+	// Whatever the worker didn't get to
+	for (const ProgramBinaryFile& file : files) ProgramBinaryCache::doFileWork(file);
+	files.clear();
+	writeShaderErrors(errors);
+	errors.clear();
+	cancelJob();
+	wanted.clear();
+	queue.clear();
+	ready.clear();
+	g_glState.deleteFramebuffer(warmFbo);
+	g_glState.deleteTexture(warmTexture);
+	warmFbo = warmTexture = 0;
+}
+
+void ShaderPrefetcher::workerMain(void* arg) {
+	((ShaderPrefetcher*)arg)->run();
+}
+
+void ShaderPrefetcher::run() {
+	mutexLock(&mutex);
+	while (!quit) {
+		if (!files.empty() || !errors.empty()) {
+			std::vector<ProgramBinaryFile> work;
+			std::string text;
+			work.swap(files);
+			text.swap(errors);
+			mutexUnlock(&mutex);
+			for (const ProgramBinaryFile& file : work) ProgramBinaryCache::doFileWork(file);
+			writeShaderErrors(text);
+			mutexLock(&mutex);
+			continue;
+		}
+		if (queue.empty()) {
+			condvarWait(&wake, &mutex);
+			continue;
+		}
+		std::string path = queue.front();
+		queue.erase(queue.begin());
+		mutexUnlock(&mutex);
+
+		// A missing or empty file still counts: it builds as the fallback
+		ShaderSources sources;
+		readShaderSources(path, sources);
+
+		mutexLock(&mutex);
+		// The list may have moved on while the card was being read
+		if (contains(wanted, path)) ready.push_back(sources);
+	}
+	mutexUnlock(&mutex);
+}
+
+void ShaderPrefetcher::want(const std::vector<std::string>& paths) {
+	mutexLock(&mutex);
+	wanted = paths;
+	for (size_t i = 0; i < ready.size();) {
+		if (contains(wanted, ready[i].path)) i++;
+		else ready.erase(ready.begin() + i);
+	}
+	queue.clear();
+	for (const std::string& path : wanted) {
+		bool haveIt = false;
+		for (const ShaderSources& r : ready) {
+			if (r.path == path) haveIt = true;
+		}
+		if (!haveIt) queue.push_back(path);
+	}
+
+	// No worker: read them here, between frames
+	if (!running) {
+		for (const std::string& path : queue) {
+			ShaderSources sources;
+			readShaderSources(path, sources);
+			ready.push_back(sources);
+		}
+		queue.clear();
+	}
+	condvarWakeOne(&wake);
+	mutexUnlock(&mutex);
+}
+
+bool ShaderPrefetcher::takeSources(const std::string& path, ShaderSources& out) {
+	mutexLock(&mutex);
+	bool found = false;
+	for (size_t i = 0; i < ready.size(); i++) {
+		if (ready[i].path == path) {
+			out = ready[i];
+			ready.erase(ready.begin() + i);
+			found = true;
+			break;
+		}
+	}
+	mutexUnlock(&mutex);
+	return found;
+}
+
+bool ShaderPrefetcher::isBuilt(const std::string& path, const ShaderCache& cache) {
+	mutexLock(&mutex);
+	bool yes = false;
+	for (const ShaderSources& r : ready) {
+		if (r.path == path) yes = cache.has(path, r.hash);
+	}
+	mutexUnlock(&mutex);
+	return yes;
+}
+
+bool ShaderPrefetcher::isWanted(const std::string& path) {
+	mutexLock(&mutex);
+	bool yes = contains(wanted, path);
+	mutexUnlock(&mutex);
+	return yes;
+}
+
+// Next read shader that the cache doesn't already have
+bool ShaderPrefetcher::nextJob(ShaderCache& cache) {
+	mutexLock(&mutex);
+	bool found = false;
+	for (const ShaderSources& r : ready) {
+		if (cache.has(r.path, r.hash)) continue;
+		job = r;
+		found = true;
+		break;
+	}
+	mutexUnlock(&mutex);
+	if (!found) return false;
+
+	building.path = job.path;
+	building.hash = job.hash;
+	memset(&building.image, 0, sizeof(building.image));
+	memset(building.passes, 0, sizeof(building.passes));
+	memset(building.targets, 0, sizeof(building.targets));
+	stage = 0;
+	while (stage < SHADER_BUFFER_COUNT && job.passes[stage].empty()) stage++;
+	busy = true;
+	return true;
+}
+
+void ShaderPrefetcher::stepJob(ShaderCache& cache, bool wait) {
+	ShaderProgram sp;
+	if (stage == SHADER_BUFFER_COUNT && job.image.empty()) {
+		// An empty or missing file shows the fallback, nothing to build
+		sp = fallbackProgram();
+	} else {
+		if (!builder.isBusy()) {
+			bool pass = stage < SHADER_BUFFER_COUNT;
+			std::string name = pass ? shaderBufferPath(job.path, stage) : job.path;
+			builder.start(pass ? job.passes[stage].c_str() : job.image.c_str(), name.c_str(), &job.binaries[stage]);
+		}
+		if (!builder.step(wait)) return;
+		if (!builder.succeeded()) reportShaderBuildError(builder.getError());
+		sp = builder.take();
+	}
+
+	if (stage < SHADER_BUFFER_COUNT) {
+		// Same as a pass built on the spot: a broken one just stays black
+		if (sp.prog) warm(sp);
+		building.passes[stage] = sp;
+		stage++;
+		while (stage < SHADER_BUFFER_COUNT && job.passes[stage].empty()) stage++;
+		return;
+	}
+
+	// Kept as the fallback, as loading it on the spot would
+	if (!sp.prog) sp = fallbackProgram();
+	if (sp.prog) warm(sp);
+	building.image = sp;
+	cache.insert(building);
+	busy = false;
+	built++;
+	printf("Prefetched %s (%d of %d kept)\n", job.path.c_str(), cache.getCount(), cache.getCapacity());
+}
+
+void ShaderPrefetcher::cancelJob() {
+	builder.cancel();
+	if (busy) {
+		deleteShaderProgram(building.image.prog);
+		for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+			deleteShaderProgram(building.passes[b].prog);
+		}
+	}
+	memset(&building.image, 0, sizeof(building.image));
+	memset(building.passes, 0, sizeof(building.passes));
+	busy = false;
+}
+
+// A 1x1 draw into a scratch target: drivers often leave part of the
+// compile for the first draw, and this way it isn't the first visible one
+void ShaderPrefetcher::warm(const ShaderProgram& sp) {
+	if (!warmFbo) {
+		glGenTextures(1, &warmTexture);
+		g_glState.editTexture(warmTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glGenFramebuffers(1, &warmFbo);
+		g_glState.bindFramebuffer(warmFbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, warmTexture, 0);
+	}
+	g_glState.bindFramebuffer(warmFbo);
+	g_glState.viewport(0, 0, 1, 1);
+	g_glState.stencilTest(false);
+	g_glState.useProgram(sp.prog);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	g_glState.count();
+}
+
+int ShaderPrefetcher::update(ShaderCache& cache, float budgetMs) {
+	std::vector<ProgramBinaryFile> work;
+	std::string text;
+	g_programBinaries.takeFileWork(work);
+	takeShaderErrors(text);
+	if (running && (!work.empty() || !text.empty())) {
+		mutexLock(&mutex);
+		for (ProgramBinaryFile& file : work) {
+			files.push_back(ProgramBinaryFile());
+			files.back().path.swap(file.path);
+			files.back().contents.swap(file.contents);
+		}
+		errors += text;
+		condvarWakeOne(&wake);
+		mutexUnlock(&mutex);
+	} else {
+		// No worker: write them here, between frames
+		for (const ProgramBinaryFile& file : work) ProgramBinaryCache::doFileWork(file);
+		writeShaderErrors(text);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int steps = 0;
+	while (std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() < budgetMs) {
+		if (busy && !isWanted(job.path)) cancelJob();
+		if (!busy && !nextJob(cache)) break;
+		stepJob(cache, false);
+		// Still compiling: come back next frame rather than wait for it
+		if (builder.isWaiting()) break;
+		steps++;
+	}
+	return steps;
+}
+
+bool ShaderPrefetcher::complete(const std::string& path, ShaderCache& cache) {
+	if (!busy || job.path != path) return false;
+	while (busy) stepJob(cache, true);
+	return true;
+}
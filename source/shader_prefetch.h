@@ -0,0 +1,100 @@
+/*
+Shader Fun - Neighbouring shader prefetch
+Created By MrDude
+*/
+
+#ifndef SHADER_PREFETCH_H
+#define SHADER_PREFETCH_H
+
+#include <switch.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <GLES2/gl2.h>
+#include "shader_cache.h"
+#include "shader_program.h"
+
+// Shaders either side of the current one that are kept ready
+const int PREFETCH_NEIGHBOURS = 1;
+// Frame time left unused for CPU jitter, and the least slack worth a step
+const float PREFETCH_MARGIN_MS = 2.0f;
+const float PREFETCH_MIN_SLACK_MS = 2.0f;
+
+// Builds the shaders L and R would switch to before they are asked for.
+//
+// A worker thread reads their sources from the SD card. The renderer then
+// builds them one step at a time (compile, link, reflect, a 1x1 warm-up
+// draw so the driver finishes anything it left for first use) in the
+// slack at the end of frames, and hands them to the shader cache. A press
+// then finds the program linked and warm. Steps never wait on the driver:
+// a compile still running is looked at again next frame. A shader that
+// doesn't build is reported and cached as the fallback, the same as
+// loading it would. The worker also reads the saved program binaries with
+// the sources, and writes out the ones g_programBinaries queues, and the
+// shader error records.
+class ShaderPrefetcher {
+public:
+	ShaderPrefetcher();
+
+	bool start();
+	// Stops the worker and drops anything half built (context current)
+	void stop();
+
+	// Paths to have ready, most wanted first; replaces the last list.
+	// Anything no longer wanted is dropped. Leave out paths the cache
+	// already holds, or their sources are read from the card again.
+	void want(const std::vector<std::string>& paths);
+
+	// Sources the worker already read for this path, so a press needn't
+	// go to the SD card again
+	bool takeSources(const std::string& path, ShaderSources& out);
+
+	// Hand queued program binaries and error records to the worker to
+	// write, then build steps
+	// until budgetMs is used up or the driver is busy. Returns the steps
+	// run. Drivers that compile inside glCompileShader can still
+	// overrun the budget by one compile.
+	int update(ShaderCache& cache, float budgetMs);
+	// If this path is part built, finish it now (a press got there first)
+	bool complete(const std::string& path, ShaderCache& cache);
+	// The cache holds this path, built from the sources last read for it
+	bool isBuilt(const std::string& path, const ShaderCache& cache);
+
+	int getBuilt() const { return built; }
+
+private:
+	ShaderPrefetcher(const ShaderPrefetcher&);
+	ShaderPrefetcher& operator=(const ShaderPrefetcher&);
+
+	static void workerMain(void* arg);
+	void run();
+	bool isWanted(const std::string& path);
+	bool nextJob(ShaderCache& cache);
+	void stepJob(ShaderCache& cache, bool wait);
+	void cancelJob();
+	void warm(const ShaderProgram& sp);
+
+	// Shared with the worker, under mutex
+	Thread thread;
+	Mutex mutex;
+	CondVar wake;
+	bool running;
+	bool quit;
+	std::vector<std::string> wanted;
+	std::vector<std::string> queue;        // still to read
+	std::vector<ShaderSources> ready;      // read, oldest first
+	std::vector<ProgramBinaryFile> files;  // still to write
+	std::string errors;                    // for writeShaderErrors
+
+	// Render thread only
+	ShaderBuilder builder;
+	ShaderSources job;
+	CachedShader building;
+	int stage;                             // pass 0-3, then SHADER_BUFFER_COUNT = image
+	bool busy;
+	GLuint warmTexture;
+	GLuint warmFbo;
+	int built;
+};
+
+#endif // SHADER_PREFETCH_H
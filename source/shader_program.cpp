@@ -0,0 +1,563 @@
+/*
+Shader Fun - Shader programs and uniform reflection
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "shader_program.h"
+#include "gl_state.h"
+
+// === Built-in vertex shader (always used) ===
+const char* vertexShaderSrc = R"(
+attribute vec2 aPos;
+varying vec2 vUV;
+void main() {
+    vUV = (aPos + 1.0) * 0.5;
+    gl_Position = vec4(aPos, 0.0, 1.0);
+}
+)";
+
+// === Fallback fragment shader (if no frag files are found) ===
+const char* fallbackFragmentShader = R"(
+precision mediump float;
+uniform vec3 iResolution;
+uniform float iTime;
+uniform sampler2D iChannel0; // Waveform
+uniform sampler2D iChannel1; // Spectrum
+varying vec2 vUV;
+
+vec3 palette(float t) {
+    vec3 a = vec3(0.5, 0.5, 0.5);
+    vec3 b = vec3(0.5, 0.5, 0.5);
+    vec3 c = vec3(1.0, 1.0, 1.0);
+    vec3 d = vec3(0.263, 0.416, 0.557);
+    return a + b * cos(6.28318 * (c * t + d));
+}
+
+void main() {
+    vec2 uv = (vUV * iResolution.xy * 2.0 - iResolution.xy) / iResolution.y;
+    vec2 uv0 = uv;
+    vec3 finalColor = vec3(0.0);
+    
+    // Sample audio data for reactivity
+    float waveform = texture2D(iChannel0, vec2(uv.x, 0.0)).r;
+    float spectrum = texture2D(iChannel1, vec2(uv.x * 0.5, 0.0)).r;
+    
+    for (float i = 0.0; i < 4.0; i++) {
+        uv = fract(uv * 1.5) - 0.5;
+        float d = length(uv) * exp(-length(uv0));
+        vec3 col = palette(length(uv0) + i * 0.4 + iTime * 0.4 + spectrum * 2.0);
+        d = sin(d * 8.0 + iTime + waveform * 10.0) / 8.0;
+        d = abs(d);
+        d = pow(0.01 / d, 1.2 + spectrum);
+        finalColor += col * d;
+    }
+        
+    gl_FragColor = vec4(finalColor, 1.0);
+}
+)";
+
+// Name -> uniform, with the type the app uploads. iFrame is also accepted
+// as a float since a lot of ported shaders declare it that way.
+struct UniformInfo {
+	const char* name;
+	ShaderUniform id;
+	GLenum type;
+	GLenum altType;
+	GLint maxCount;
+};
+
+static const UniformInfo uniformTable[UNIFORM_COUNT] = {
+	{ "iResolution",        UNIFORM_RESOLUTION,         GL_FLOAT_VEC3, GL_FLOAT_VEC3, 1 },
+	{ "iTime",              UNIFORM_TIME,               GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iTimeDelta",         UNIFORM_TIME_DELTA,         GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iFrame",             UNIFORM_FRAME,              GL_INT,        GL_FLOAT,      1 },
+	{ "iFrameRate",         UNIFORM_FRAME_RATE,         GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iDate",              UNIFORM_DATE,               GL_FLOAT_VEC4, GL_FLOAT_VEC4, 1 },
+	{ "iMouse",             UNIFORM_MOUSE,              GL_FLOAT_VEC4, GL_FLOAT_VEC4, 1 },
+	{ "iChannelResolution", UNIFORM_CHANNEL_RESOLUTION, GL_FLOAT_VEC3, GL_FLOAT_VEC3, SHADER_CHANNEL_COUNT },
+	{ "iAudioBands",        UNIFORM_AUDIO_BANDS,        GL_FLOAT,      GL_FLOAT,      AUDIO_BAND_COUNT },
+	{ "iBass",              UNIFORM_BASS,               GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iMid",               UNIFORM_MID,                GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iTreble",            UNIFORM_TREBLE,             GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iEnergy",            UNIFORM_ENERGY,             GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iPeak",              UNIFORM_PEAK,               GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iBeat",              UNIFORM_BEAT,               GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iBeatPhase",         UNIFORM_BEAT_PHASE,         GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iBPM",               UNIFORM_BPM,                GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iStereoCorrelation", UNIFORM_STEREO_CORRELATION, GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iAudioLevel",        UNIFORM_AUDIO_LEVEL,        GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iAudioBass",         UNIFORM_AUDIO_BASS,         GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iAudioMid",          UNIFORM_AUDIO_MID,          GL_FLOAT,      GL_FLOAT,      1 },
+	{ "iAudioHigh",         UNIFORM_AUDIO_HIGH,         GL_FLOAT,      GL_FLOAT,      1 },
+};
+
+// Samplers get their unit once at link time instead of every frame
+struct SamplerInfo {
+	const char* name;
+	GLint unit;
+};
+
+static const SamplerInfo samplerTable[] = {
+	{ "iChannel0", SHADER_UNIT_WAVEFORM },
+	{ "iChannel1", SHADER_UNIT_SPECTRUM },
+	{ "iChannel2", SHADER_UNIT_BUFFER0 },
+	{ "iChannel3", SHADER_UNIT_BUFFER0 + 1 },
+	{ "iChannel4", SHADER_UNIT_BUFFER0 + 2 },
+	{ "iChannel5", SHADER_UNIT_BUFFER0 + 3 },
+};
+
+GLuint startShaderCompile(GLenum type, const char* src) {
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &src, NULL);
+	glCompileShader(shader);
+	return shader;
+}
+
+bool checkShaderCompile(GLuint shader, std::string* log) {
+	GLint status;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (!status) {
+		char buffer[1024];
+		buffer[0] = 0;
+		glGetShaderInfoLog(shader, sizeof(buffer), NULL, buffer);
+		if (log) *log = buffer;
+		else printf("Shader compile error: %s\n", buffer);
+	}
+	return status != 0;
+}
+
+GLuint compileShader(GLenum type, const char* src) {
+	GLuint shader = startShaderCompile(type, src);
+	checkShaderCompile(shader);
+	return shader;
+}
+
+static GLuint vertexShader = 0;
+
+GLuint sharedVertexShader() {
+	if (!vertexShader) {
+		vertexShader = startShaderCompile(GL_VERTEX_SHADER, vertexShaderSrc);
+		if (!checkShaderCompile(vertexShader)) {
+			glDeleteShader(vertexShader);
+			vertexShader = 0;
+		}
+	}
+	return vertexShader;
+}
+
+// KHR_parallel_shader_compile: the driver says when a status query won't block
+static bool parallelCompile = false;
+// Frames counted for drivers without it
+static unsigned int compilerFrame = 0;
+
+typedef void (GL_APIENTRY* MaxShaderCompilerThreadsProc)(GLuint count);
+
+void initShaderCompiler(GlProcLoader loader) {
+	parallelCompile = glHasExtension("GL_KHR_parallel_shader_compile");
+	if (!parallelCompile) {
+		printf("No parallel shader compile, checking builds %d frames after starting them\n", SHADER_STATUS_DEFER_FRAMES);
+	}
+	else {
+		// Let the driver use as many compiler threads as it likes
+		MaxShaderCompilerThreadsProc maxThreads = (MaxShaderCompilerThreadsProc)loader("glMaxShaderCompilerThreadsKHR");
+		if (maxThreads) maxThreads(0xFFFFFFFFu);
+		printf("Parallel shader compile available\n");
+	}
+	// Ready before the first shader needs either
+	sharedVertexShader();
+	fallbackProgram();
+}
+
+bool shaderCompilerIsParallel() {
+	return parallelCompile;
+}
+
+void shaderCompilerNextFrame() {
+	compilerFrame++;
+}
+
+static ShaderProgram residentFallback;
+static bool haveFallback = false;
+
+void releaseShaderCompiler() {
+	if (haveFallback) g_glState.deleteProgram(residentFallback.prog);
+	haveFallback = false;
+	if (vertexShader) glDeleteShader(vertexShader);
+	vertexShader = 0;
+}
+
+static std::string errorPath;
+static FILE* errorFile = NULL;
+static std::string queuedErrors;
+
+void setShaderErrorFile(const char* file) {
+	if (!file) {
+		std::string text;
+		if (takeShaderErrors(text)) writeShaderErrors(text);
+	}
+	if (errorFile) fclose(errorFile);
+	errorFile = NULL;
+	errorPath = file ? file : "";
+	queuedErrors.clear();
+}
+
+bool takeShaderErrors(std::string& out) {
+	out.clear();
+	out.swap(queuedErrors);
+	return !out.empty();
+}
+
+void writeShaderErrors(const std::string& text) {
+	if (text.empty() || errorPath.empty()) return;
+	if (!errorFile) {
+		errorFile = fopen(errorPath.c_str(), "w");
+		if (!errorFile) {
+			printf("Could not write %s\n", errorPath.c_str());
+			errorPath.clear();
+			return;
+		}
+	}
+	fputs(text.c_str(), errorFile);
+	// Read over FTP while running, so don't sit in the buffer
+	fflush(errorFile);
+}
+
+static const char* buildStageName(ShaderBuildState stage) {
+	return stage == SHADER_BUILD_LINKING ? "link" : "compile";
+}
+
+void reportShaderBuildError(const ShaderBuildError& error) {
+	const char* name = error.name.empty() ? "(unnamed shader)" : error.name.c_str();
+	printf("Shader %s failed after %.1f ms: %s\n%s\n", buildStageName(error.stage),
+		error.times.compileMs + error.times.linkMs, name, error.log.c_str());
+	if (errorPath.empty()) return;
+	char header[128];
+	snprintf(header, sizeof(header), "%s failed (compile %.1f ms, link %.1f ms)\n", buildStageName(error.stage),
+		error.times.compileMs, error.times.linkMs);
+	queuedErrors += "== ";
+	queuedErrors += name;
+	queuedErrors += "\n";
+	queuedErrors += header;
+	queuedErrors += error.log;
+	queuedErrors += "\n";
+}
+
+static const char* skipSpace(const char* p) {
+	while (*p == ' ' || *p == '\t') p++;
+	return p;
+}
+
+void parseShaderDirectives(const char* src, ShaderDirectives& out) {
+	out.halfRate = SHADER_HALF_RATE_AUTO;
+	out.bufferFormat = SHADER_BUFFER_HALF_FLOAT;
+
+	for (const char* line = src; line && *line; line = strchr(line, '\n'), line = line ? line + 1 : NULL) {
+		const char* p = skipSpace(line);
+		if (*p != '#') continue;
+		p = skipSpace(p + 1);
+		if (strncmp(p, "pragma", 6) != 0) continue;
+		p = skipSpace(p + 6);
+		if (strncmp(p, "shaderfun", 9) != 0) continue;
+
+		char key[32], value[32];
+		if (sscanf(p + 9, "%31s %31s", key, value) != 2) continue;
+
+		if (strcmp(key, "half_rate") == 0) {
+			if (strcmp(value, "auto") == 0) out.halfRate = SHADER_HALF_RATE_AUTO;
+			else if (strcmp(value, "off") == 0) out.halfRate = SHADER_HALF_RATE_OFF;
+			else if (strcmp(value, "checkerboard") == 0) out.halfRate = SHADER_HALF_RATE_CHECKERBOARD;
+			else if (strcmp(value, "interlaced") == 0) out.halfRate = SHADER_HALF_RATE_INTERLACED;
+			else printf("Unknown half_rate value: %s\n", value);
+		}
+		else if (strcmp(key, "buffer_format") == 0) {
+			if (strcmp(value, "half") == 0) out.bufferFormat = SHADER_BUFFER_HALF_FLOAT;
+			else if (strcmp(value, "rgba8") == 0) out.bufferFormat = SHADER_BUFFER_RGBA8;
+			else printf("Unknown buffer_format value: %s\n", value);
+		}
+		else {
+			printf("Unknown shaderfun directive: %s\n", key);
+		}
+	}
+}
+
+// Walk the program's active uniforms and keep the ones we feed
+static void reflectUniforms(ShaderProgram& sp) {
+	sp.uniformCount = 0;
+
+	GLint active = 0;
+	glGetProgramiv(sp.prog, GL_ACTIVE_UNIFORMS, &active);
+	g_glState.useProgram(sp.prog);
+
+	for (GLint i = 0; i < active; i++) {
+		char name[64];
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveUniform(sp.prog, i, sizeof(name), NULL, &size, &type, name);
+
+		// Arrays are reported as "name[0]"
+		char* bracket = strchr(name, '[');
+		if (bracket) *bracket = 0;
+
+		GLint location = glGetUniformLocation(sp.prog, name);
+		if (location == -1) continue;
+
+		if (type == GL_SAMPLER_2D) {
+			for (size_t s = 0; s < sizeof(samplerTable) / sizeof(samplerTable[0]); s++) {
+				if (strcmp(name, samplerTable[s].name) == 0) {
+					glUniform1i(location, samplerTable[s].unit);
+				}
+			}
+			continue;
+		}
+
+		for (int u = 0; u < UNIFORM_COUNT; u++) {
+			const UniformInfo& info = uniformTable[u];
+			if (strcmp(name, info.name) != 0) continue;
+
+			if (type != info.type && type != info.altType) {
+				printf("Uniform %s has an unexpected type (0x%04x), not updating it\n", name, type);
+				break;
+			}
+
+			UniformBinding& b = sp.uniforms[sp.uniformCount++];
+			b.location = location;
+			b.count = size < info.maxCount ? size : info.maxCount;
+			b.type = type;
+			b.id = (unsigned char)info.id;
+			break;
+		}
+	}
+}
+
+static float millisSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+ShaderBuilder::ShaderBuilder() : useBinaries(false), fs(0), prog(0), state(SHADER_BUILD_IDLE), issuedFrame(0), waiting(false) {
+	memset(&result, 0, sizeof(result));
+	times.compileMs = 0.0f;
+	times.linkMs = 0.0f;
+	error.stage = SHADER_BUILD_IDLE;
+	error.times = times;
+}
+
+void ShaderBuilder::start(const char* fragSrc, const char* name, ProgramBinary* saved) {
+	cancel();
+	source = fragSrc;
+	useBinaries = saved != NULL;
+	if (saved) {
+		binary.key = saved->key;
+		binary.format = saved->format;
+		binary.data.swap(saved->data);
+	}
+	error.name = name ? name : "";
+	error.stage = SHADER_BUILD_IDLE;
+	error.log.clear();
+	times.compileMs = 0.0f;
+	times.linkMs = 0.0f;
+	state = SHADER_BUILD_COMPILE;
+}
+
+// Whether asking for the compile or link status now would return at once
+bool ShaderBuilder::driverDone() const {
+	if (parallelCompile) {
+		GLint done = GL_FALSE;
+		if (state == SHADER_BUILD_COMPILING) {
+			glGetShaderiv(fs, GL_COMPLETION_STATUS_KHR, &done);
+		} else {
+			glGetProgramiv(prog, GL_COMPLETION_STATUS_KHR, &done);
+		}
+		return done != GL_FALSE;
+	}
+	return compilerFrame - issuedFrame >= (unsigned int)SHADER_STATUS_DEFER_FRAMES;
+}
+
+bool ShaderBuilder::step(bool wait) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	waiting = false;
+
+	switch (state) {
+	case SHADER_BUILD_COMPILE:
+		// Linked in an earlier run: no compile or link at all
+		if (useBinaries) {
+			prog = g_programBinaries.create(binary);
+			std::vector<char>().swap(binary.data);
+		}
+		if (prog) {
+			times.compileMs = millisSince(start);
+			state = SHADER_BUILD_REFLECT;
+			return false;
+		}
+
+		// Only queue the work; nothing here waits for the compiler. The
+		// vertex shader is the same for everything and already compiled.
+		fs = startShaderCompile(GL_FRAGMENT_SHADER, source.c_str());
+		issuedFrame = compilerFrame;
+		times.compileMs = millisSince(start);
+		state = SHADER_BUILD_COMPILING;
+		return false;
+
+	case SHADER_BUILD_COMPILING: {
+		if (!wait && !driverDone()) {
+			waiting = true;
+			return false;
+		}
+		// Drivers that compile lazily do it here, so it counts as compile time
+		bool fsOk = checkShaderCompile(fs, &error.log);
+		times.compileMs += millisSince(start);
+		if (!fsOk || !sharedVertexShader()) {
+			if (fsOk) error.log = "The built-in vertex shader didn't compile";
+			error.stage = SHADER_BUILD_COMPILING;
+			error.times = times;
+			cancel();
+			state = SHADER_BUILD_FAILED;
+			return true;
+		}
+		state = SHADER_BUILD_LINK;
+		return false;
+	}
+
+	case SHADER_BUILD_LINK:
+		prog = glCreateProgram();
+		glAttachShader(prog, sharedVertexShader());
+		glAttachShader(prog, fs);
+		glBindAttribLocation(prog, 0, "aPos");
+		glLinkProgram(prog);
+		issuedFrame = compilerFrame;
+		times.linkMs = millisSince(start);
+		state = SHADER_BUILD_LINKING;
+		return false;
+
+	case SHADER_BUILD_LINKING: {
+		if (!wait && !driverDone()) {
+			waiting = true;
+			return false;
+		}
+		GLint linkStatus;
+		glGetProgramiv(prog, GL_LINK_STATUS, &linkStatus);
+		times.linkMs += millisSince(start);
+		if (!linkStatus) {
+			char buffer[1024];
+			buffer[0] = 0;
+			glGetProgramInfoLog(prog, sizeof(buffer), NULL, buffer);
+			error.stage = SHADER_BUILD_LINKING;
+			error.log = buffer;
+			error.times = times;
+			cancel();
+			state = SHADER_BUILD_FAILED;
+			return true;
+		}
+
+		// The fragment shader goes with the program; the vertex shader stays
+		glDeleteShader(fs);
+		fs = 0;
+		if (useBinaries) g_programBinaries.store(source.c_str(), prog);
+		state = SHADER_BUILD_REFLECT;
+		return false;
+	}
+
+	case SHADER_BUILD_REFLECT:
+		result.prog = prog;
+		result.fallback = false;
+		parseShaderDirectives(source.c_str(), result.directives);
+		reflectUniforms(result);
+		prog = 0;
+		state = SHADER_BUILD_DONE;
+		return true;
+
+	default:
+		return state != SHADER_BUILD_IDLE;
+	}
+}
+
+ShaderProgram ShaderBuilder::take() {
+	ShaderProgram sp = result;
+	if (state != SHADER_BUILD_DONE) sp.prog = 0;
+	result.prog = 0;
+	state = SHADER_BUILD_IDLE;
+	return sp;
+}
+
+void ShaderBuilder::cancel() {
+	if (fs) glDeleteShader(fs);
+	g_glState.deleteProgram(prog);
+	if (state == SHADER_BUILD_DONE) g_glState.deleteProgram(result.prog);
+	fs = prog = 0;
+	memset(&result, 0, sizeof(result));
+	state = SHADER_BUILD_IDLE;
+	waiting = false;
+}
+
+ShaderProgram loadShaderProgram(const char* fragSrc, ShaderBuildTimes* times, const char* name, ProgramBinary* binary) {
+	ShaderBuilder builder;
+	builder.start(fragSrc, name, binary);
+	while (!builder.step()) {
+	}
+	if (times) *times = builder.getTimes();
+
+	if (!builder.succeeded()) {
+		reportShaderBuildError(builder.getError());
+		printf("Using fallback\n");
+		return fallbackProgram();
+	}
+	ShaderProgram sp = builder.take();
+	printf("Shader loaded successfully, %d uniforms bound\n", sp.uniformCount);
+	return sp;
+}
+
+const ShaderProgram& fallbackProgram() {
+	if (!haveFallback) {
+		ShaderBuilder builder;
+		builder.start(fallbackFragmentShader, "fallback");
+		while (!builder.step()) {
+		}
+		if (!builder.succeeded()) reportShaderBuildError(builder.getError());
+		residentFallback = builder.take();
+		residentFallback.fallback = true;
+		haveFallback = true;
+	}
+	return residentFallback;
+}
+
+void deleteShaderProgram(GLuint prog) {
+	if (haveFallback && prog == residentFallback.prog) return;
+	g_glState.deleteProgram(prog);
+}
+
+void applyShaderUniforms(const ShaderProgram& sp, const ShaderInputs& in) {
+	for (int i = 0; i < sp.uniformCount; i++) {
+		const UniformBinding& b = sp.uniforms[i];
+		switch (b.id) {
+		case UNIFORM_RESOLUTION:         glUniform3fv(b.location, 1, in.resolution); break;
+		case UNIFORM_TIME:               glUniform1f(b.location, in.time); break;
+		case UNIFORM_TIME_DELTA:         glUniform1f(b.location, in.timeDelta); break;
+		case UNIFORM_FRAME:
+			if (b.type == GL_INT) glUniform1i(b.location, in.frame);
+			else glUniform1f(b.location, (float)in.frame);
+			break;
+		case UNIFORM_FRAME_RATE:         glUniform1f(b.location, in.frameRate); break;
+		case UNIFORM_DATE:               glUniform4fv(b.location, 1, in.date); break;
+		case UNIFORM_MOUSE:              glUniform4fv(b.location, 1, in.mouse); break;
+		case UNIFORM_CHANNEL_RESOLUTION: glUniform3fv(b.location, b.count, in.channelResolution); break;
+		case UNIFORM_AUDIO_BANDS:        glUniform1fv(b.location, b.count, in.audio.bands); break;
+		case UNIFORM_BASS:
+		case UNIFORM_AUDIO_BASS:         glUniform1f(b.location, in.audio.bass); break;
+		case UNIFORM_MID:
+		case UNIFORM_AUDIO_MID:          glUniform1f(b.location, in.audio.mid); break;
+		case UNIFORM_TREBLE:
+		case UNIFORM_AUDIO_HIGH:         glUniform1f(b.location, in.audio.treble); break;
+		case UNIFORM_ENERGY:
+		case UNIFORM_AUDIO_LEVEL:        glUniform1f(b.location, in.audio.energy); break;
+		case UNIFORM_PEAK:               glUniform1f(b.location, in.audio.peak); break;
+		case UNIFORM_BEAT:               glUniform1f(b.location, in.beat); break;
+		case UNIFORM_BEAT_PHASE:         glUniform1f(b.location, in.beatPhase); break;
+		case UNIFORM_BPM:                glUniform1f(b.location, in.bpm); break;
+		case UNIFORM_STEREO_CORRELATION: glUniform1f(b.location, in.stereoCorrelation); break;
+		default: break;
+		}
+	}
+	g_glState.count(sp.uniformCount);
+}
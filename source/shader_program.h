@@ -0,0 +1,249 @@
+/*
+Shader Fun - Shader programs and uniform reflection
+Created By MrDude
+*/
+
+#ifndef SHADER_PROGRAM_H
+#define SHADER_PROGRAM_H
+
+#include <stddef.h>
+#include <string>
+#include <GLES2/gl2.h>
+#include "audio_features.h"
+#include "gl_state.h"
+#include "program_binary.h"
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Every uniform the visualizer knows how to feed
+enum ShaderUniform {
+	UNIFORM_RESOLUTION,           // vec3  iResolution
+	UNIFORM_TIME,                 // float iTime
+	UNIFORM_TIME_DELTA,           // float iTimeDelta
+	UNIFORM_FRAME,                // int   iFrame
+	UNIFORM_FRAME_RATE,           // float iFrameRate
+	UNIFORM_DATE,                 // vec4  iDate (year, month 0-11, day, seconds)
+	UNIFORM_MOUSE,                // vec4  iMouse (right stick cursor)
+	UNIFORM_CHANNEL_RESOLUTION,   // vec3  iChannelResolution[6]
+	UNIFORM_AUDIO_BANDS,          // float iAudioBands[8]
+	UNIFORM_BASS,
+	UNIFORM_MID,
+	UNIFORM_TREBLE,
+	UNIFORM_ENERGY,
+	UNIFORM_PEAK,
+	UNIFORM_BEAT,
+	UNIFORM_BEAT_PHASE,
+	UNIFORM_BPM,
+	UNIFORM_STEREO_CORRELATION,
+	// Older names used by some bundled shaders
+	UNIFORM_AUDIO_LEVEL,
+	UNIFORM_AUDIO_BASS,
+	UNIFORM_AUDIO_MID,
+	UNIFORM_AUDIO_HIGH,
+	UNIFORM_COUNT
+};
+
+const int SHADER_CHANNEL_COUNT = 6;  // iChannel0..5 as far as iChannelResolution goes
+
+// Texture units the samplers are bound to (fixed at link time), unit n = iChannel n
+const int SHADER_UNIT_WAVEFORM = 0;  // iChannel0
+const int SHADER_UNIT_SPECTRUM = 1;  // iChannel1
+const int SHADER_UNIT_BUFFER0 = 2;   // iChannel2..5 = Buffer A..D
+
+// Values for every known uniform, filled once per frame
+struct ShaderInputs {
+	float resolution[3];
+	float time;
+	float timeDelta;
+	int frame;
+	float frameRate;
+	float date[4];
+	float mouse[4];
+	float channelResolution[SHADER_CHANNEL_COUNT * 3];
+	AudioFeatures audio;
+	float beat;
+	float beatPhase;
+	float bpm;
+	float stereoCorrelation;
+};
+
+// One uniform the linked program actually uses
+struct UniformBinding {
+	GLint location;
+	GLint count;        // array elements to upload
+	GLenum type;        // as declared (iFrame may be int or float)
+	unsigned char id;   // ShaderUniform
+};
+
+// Per-shader options, from "#pragma shaderfun <key> <value>" lines in
+// the fragment source (GLSL compilers ignore pragmas they don't know)
+enum ShaderHalfRate {
+	SHADER_HALF_RATE_AUTO,          // only when even the smallest render scale is too slow
+	SHADER_HALF_RATE_OFF,
+	SHADER_HALF_RATE_CHECKERBOARD,  // always, alternating 2x2 blocks
+	SHADER_HALF_RATE_INTERLACED     // always, alternating pairs of rows
+};
+
+enum ShaderBufferFormat {
+	SHADER_BUFFER_HALF_FLOAT,       // when the GPU can render to it, else RGBA8
+	SHADER_BUFFER_RGBA8
+};
+
+struct ShaderDirectives {
+	ShaderHalfRate halfRate;        // half_rate auto|off|checkerboard|interlaced
+	ShaderBufferFormat bufferFormat; // buffer_format half|rgba8 (Buffer A-D passes)
+};
+
+struct ShaderProgram {
+	GLuint prog;
+	int uniformCount;
+	UniformBinding uniforms[UNIFORM_COUNT];
+	ShaderDirectives directives;
+	bool fallback;      // the source didn't build, this is fallbackFragmentShader
+};
+
+// Built-in sources
+extern const char* vertexShaderSrc;
+extern const char* fallbackFragmentShader;
+
+// Queue a compile without waiting for it; checkShaderCompile asks for
+// the status, which waits if it isn't done. On failure the info log goes
+// to log, or is printed without one.
+GLuint startShaderCompile(GLenum type, const char* src);
+bool checkShaderCompile(GLuint shader, std::string* log = NULL);
+// Both at once
+GLuint compileShader(GLenum type, const char* src);
+
+// vertexShaderSrc, compiled on first use and attached to every program
+// after that (0 if it didn't compile)
+GLuint sharedVertexShader();
+
+// Frames a compile or link is given before its status is asked for, on
+// drivers without KHR_parallel_shader_compile
+const int SHADER_STATUS_DEFER_FRAMES = 2;
+
+// Looks for KHR_parallel_shader_compile and builds the shared vertex
+// shader and the fallback program (context current)
+void initShaderCompiler(GlProcLoader loader);
+bool shaderCompilerIsParallel();
+// Once per frame, for the deferred status checks
+void shaderCompilerNextFrame();
+// Delete the shared vertex shader and the fallback program
+void releaseShaderCompiler();
+
+// Read the #pragma shaderfun lines; anything unrecognised keeps its default
+void parseShaderDirectives(const char* src, ShaderDirectives& out);
+
+// Time the calling thread spent in the driver building one program
+// (time a parallel compile ran on its own isn't counted)
+struct ShaderBuildTimes {
+	float compileMs;    // up to the compile status
+	float linkMs;       // up to the link status (0 if compiling failed)
+};
+
+enum ShaderBuildState {
+	SHADER_BUILD_IDLE,
+	SHADER_BUILD_COMPILE,
+	SHADER_BUILD_COMPILING,         // queued, status not asked for yet
+	SHADER_BUILD_LINK,
+	SHADER_BUILD_LINKING,
+	SHADER_BUILD_REFLECT,
+	SHADER_BUILD_DONE,
+	SHADER_BUILD_FAILED
+};
+
+// Why a shader didn't build, for the log and the error file
+struct ShaderBuildError {
+	std::string name;           // the file, as the caller named it
+	ShaderBuildState stage;     // SHADER_BUILD_COMPILING or SHADER_BUILD_LINKING
+	std::string log;            // the driver's info log
+	ShaderBuildTimes times;     // spent getting that far
+};
+
+#define SHADER_ERRORS_FILE "sdmc:/switch/shaderfun/shader_errors.txt"
+
+// Print an error, and queue it for the error file if there is one
+void reportShaderBuildError(const ShaderBuildError& error);
+// Errors from now on are also written to file, so they can be read over
+// FTP without a console; NULL writes what is queued and stops that. The
+// file is only created (replacing the last run's) by the first error.
+void setShaderErrorFile(const char* file);
+// Move the queued error records to out, for writeShaderErrors. False if
+// there were none.
+bool takeShaderErrors(std::string& out);
+// Append records to the error file (no GL, so any thread - one at a time)
+void writeShaderErrors(const std::string& text);
+
+// One program built a step at a time - compile, link, then reflect - so
+// the driver work can be spread over frames instead of stalling one.
+// Compile and link are each queued in one step and their status asked
+// for in the next. A step that mustn't block only asks once the driver
+// reports it finished (KHR_parallel_shader_compile), or, without that,
+// SHADER_STATUS_DEFER_FRAMES frames later. A program saved by an earlier
+// run (see ProgramBinaryCache) skips straight to reflecting, when the
+// caller read it first.
+class ShaderBuilder {
+public:
+	ShaderBuilder();
+
+	// Keeps its own copy of the source. name is only for the error record.
+	// binary is what ProgramBinaryCache::read() found for this source (its
+	// data is taken), read off the render thread. Without one the program
+	// is compiled from source and not saved: the builder never touches
+	// the SD card.
+	void start(const char* fragSrc, const char* name = NULL, ProgramBinary* binary = NULL);
+	// Run the next step. True once finished, built or failed. With wait
+	// false a status the driver may not have yet is left for a later call.
+	bool step(bool wait = true);
+	// The last step did nothing: the driver is still compiling or linking
+	bool isWaiting() const { return waiting; }
+	bool isBusy() const { return state != SHADER_BUILD_IDLE && state != SHADER_BUILD_DONE && state != SHADER_BUILD_FAILED; }
+	bool succeeded() const { return state == SHADER_BUILD_DONE; }
+	const ShaderBuildTimes& getTimes() const { return times; }
+	// What went wrong, once step() finished without succeeding
+	const ShaderBuildError& getError() const { return error; }
+
+	// The finished program, now the caller's (prog 0 if it failed)
+	ShaderProgram take();
+	// Drop whatever is half built (call with the context current)
+	void cancel();
+
+private:
+	ShaderBuilder(const ShaderBuilder&);
+	ShaderBuilder& operator=(const ShaderBuilder&);
+
+	bool driverDone() const;
+
+	std::string source;
+	ProgramBinary binary;
+	bool useBinaries;           // load from binary, or save the program linked
+	GLuint fs;
+	GLuint prog;
+	ShaderProgram result;
+	ShaderBuildTimes times;
+	ShaderBuildError error;
+	ShaderBuildState state;
+	unsigned int issuedFrame;   // compile or link queued, for the frame count
+	bool waiting;
+};
+
+// Compile + link against the built-in vertex shader, then reflect the
+// active uniforms into the binding table and point the samplers at their
+// texture units. If anything fails the error is reported under name and
+// the resident fallback program comes back instead (times then describe
+// the attempt).
+ShaderProgram loadShaderProgram(const char* fragSrc, ShaderBuildTimes* times = NULL, const char* name = NULL,
+	ProgramBinary* binary = NULL);
+
+// fallbackFragmentShader, linked once and kept until releaseShaderCompiler.
+// Copies of it are shared, so delete programs with deleteShaderProgram.
+const ShaderProgram& fallbackProgram();
+// Delete a program unless it is the resident fallback (context current)
+void deleteShaderProgram(GLuint prog);
+
+// Upload the uniforms this program uses (program must be current)
+void applyShaderUniforms(const ShaderProgram& sp, const ShaderInputs& in);
+
+#endif // SHADER_PROGRAM_H
@@ -0,0 +1,178 @@
+/*
+Shader Fun - Spectrum post-processing kernel benchmark
+Reports ns per analysis frame for each kernel, SIMD backend vs scalar
+reference, plus the largest difference between the two.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include "audio_simd.h"
+#include "bench_common.h"
+
+static const int FFT_SIZE = 1024;          // default analysis window
+static const int BINS = FFT_SIZE / 2;
+static const int MIXER_FRAMES = 1024;      // Mix_OpenAudio chunk size
+
+static int iterations = 200000;
+
+struct KernelResult {
+	double simdNs;
+	double scalarNs;
+	float maxError;
+};
+
+template <typename F>
+static double timeKernel(F fn) {
+	for (int i = 0; i < 1000; i++) fn(i);
+	uint64_t t0 = benchNowNs();
+	for (int i = 0; i < iterations; i++) fn(i);
+	return (double)(benchNowNs() - t0) / iterations;
+}
+
+static float maxDiff(const std::vector<float>& a, const std::vector<float>& b) {
+	float m = 0.0f;
+	for (size_t i = 0; i < a.size(); i++) {
+		float d = fabsf(a[i] - b[i]);
+		if (d > m) m = d;
+	}
+	return m;
+}
+
+static void report(const char* name, const char* unit, const KernelResult& r) {
+	printf("%-22s %10.1f %10.1f %7.2fx   max err %.2e %s\n",
+		name, r.simdNs, r.scalarNs, r.scalarNs / r.simdNs, r.maxError, unit);
+}
+
+int main(int argc, char* argv[]) {
+	if (argc > 1) iterations = atoi(argv[1]);
+
+	std::vector<float> signal(FFT_SIZE), window(FFT_SIZE);
+	std::vector<kiss_fft_cpx> bins(BINS);
+	std::vector<float> outA(BINS), outB(BINS), winA(FFT_SIZE), winB(FFT_SIZE);
+	std::vector<int16_t> pcm(MIXER_FRAMES * 2);
+	std::vector<float> left(MIXER_FRAMES), right(MIXER_FRAMES), leftRef(MIXER_FRAMES), rightRef(MIXER_FRAMES);
+	std::vector<float> mono(MIXER_FRAMES * 2), monoRef(MIXER_FRAMES * 2);
+
+	benchSynthSignal(signal.data(), FFT_SIZE, 44100);
+	for (int i = 0; i < FFT_SIZE; i++) {
+		window[i] = 0.5f - 0.5f * cosf(6.2831853f * i / FFT_SIZE);
+	}
+	uint32_t seed = 12345;
+	for (int i = 0; i < BINS; i++) {
+		seed = seed * 1664525u + 1013904223u;
+		bins[i].r = ((seed >> 8) / 16777216.0f - 0.5f) * powf(10.0f, -(i % 7));
+		seed = seed * 1664525u + 1013904223u;
+		bins[i].i = ((seed >> 8) / 16777216.0f - 0.5f) * powf(10.0f, -(i % 5));
+	}
+	for (size_t i = 0; i < pcm.size(); i++) {
+		seed = seed * 1664525u + 1013904223u;
+		pcm[i] = (int16_t)(seed >> 16);
+	}
+
+	printf("Audio kernel benchmark, backend: %s, %d iterations\n", audioSimdBackend(), iterations);
+	printf("Analysis frame: %d samples / %d bins, mixer block: %d stereo frames\n\n", FFT_SIZE, BINS, MIXER_FRAMES);
+	printf("%-22s %10s %10s %8s\n", "kernel (ns/frame)", "simd", "scalar", "speedup");
+
+	KernelResult r;
+	double total = 0.0, totalScalar = 0.0;
+
+	r.simdNs = timeKernel([&](int) { audioMultiply(signal.data(), window.data(), winA.data(), FFT_SIZE); });
+	r.scalarNs = timeKernel([&](int) { audioMultiplyScalar(signal.data(), window.data(), winB.data(), FFT_SIZE); });
+	r.maxError = maxDiff(winA, winB);
+	report("window", "", r);
+	total += r.simdNs; totalScalar += r.scalarNs;
+
+	r.simdNs = timeKernel([&](int) { audioMagnitudes(bins.data(), outA.data(), BINS, 1.0f / BINS); });
+	r.scalarNs = timeKernel([&](int) { audioMagnitudesScalar(bins.data(), outB.data(), BINS, 1.0f / BINS); });
+	r.maxError = maxDiff(outA, outB);
+	report("magnitude", "", r);
+	total += r.simdNs; totalScalar += r.scalarNs;
+
+	std::vector<float> mags = outB;
+	r.simdNs = timeKernel([&](int) { audioDecibels(mags.data(), outA.data(), BINS, -80.0f); });
+	r.scalarNs = timeKernel([&](int) { audioDecibelsScalar(mags.data(), outB.data(), BINS, -80.0f); });
+	r.maxError = maxDiff(outA, outB) * 80.0f;
+	report("decibels", "dB", r);
+	total += r.simdNs; totalScalar += r.scalarNs;
+
+	float peak = 0.0f, peakRef = 0.0f;
+	r.simdNs = timeKernel([&](int) { peak = audioPeak(mags.data(), BINS); benchConsume(peak); });
+	r.scalarNs = timeKernel([&](int) { peakRef = audioPeakScalar(mags.data(), BINS); benchConsume(peakRef); });
+	r.maxError = fabsf(peak - peakRef);
+	report("peak", "", r);
+	total += r.simdNs; totalScalar += r.scalarNs;
+
+	outA = mags;
+	outB = mags;
+	r.simdNs = timeKernel([&](int) { audioNormalize(outA.data(), BINS, 1.0001f); });
+	r.scalarNs = timeKernel([&](int) { audioNormalizeScalar(outB.data(), BINS, 1.0001f); });
+	r.maxError = maxDiff(outA, outB);
+	report("normalize", "", r);
+	total += r.simdNs; totalScalar += r.scalarNs;
+
+	r.simdNs = timeKernel([&](int) { audioS16ToFloat(pcm.data(), mono.data(), MIXER_FRAMES * 2); });
+	r.scalarNs = timeKernel([&](int) { audioS16ToFloatScalar(pcm.data(), monoRef.data(), MIXER_FRAMES * 2); });
+	r.maxError = maxDiff(mono, monoRef);
+	report("s16 -> float", "", r);
+
+	r.simdNs = timeKernel([&](int) { audioS16StereoToFloat(pcm.data(), left.data(), right.data(), MIXER_FRAMES); });
+	r.scalarNs = timeKernel([&](int) { audioS16StereoToFloatScalar(pcm.data(), leftRef.data(), rightRef.data(), MIXER_FRAMES); });
+	r.maxError = fmaxf(maxDiff(left, leftRef), maxDiff(right, rightRef));
+	report("s16 stereo -> L/R", "", r);
+
+	std::vector<int32_t> pcm32(MIXER_FRAMES * 2);
+	for (size_t i = 0; i < pcm32.size(); i++) {
+		seed = seed * 1664525u + 1013904223u;
+		pcm32[i] = (int32_t)seed;
+	}
+	r.simdNs = timeKernel([&](int) { audioS32ToFloat(pcm32.data(), mono.data(), MIXER_FRAMES * 2); });
+	r.scalarNs = timeKernel([&](int) { audioS32ToFloatScalar(pcm32.data(), monoRef.data(), MIXER_FRAMES * 2); });
+	r.maxError = maxDiff(mono, monoRef);
+	report("s32 -> float", "", r);
+
+	r.simdNs = timeKernel([&](int) { audioMonoToStereo(left.data(), mono.data(), MIXER_FRAMES); });
+	r.scalarNs = timeKernel([&](int) { audioMonoToStereoScalar(left.data(), monoRef.data(), MIXER_FRAMES); });
+	r.maxError = maxDiff(mono, monoRef);
+	report("mono -> stereo", "", r);
+
+	std::vector<float> surround(MIXER_FRAMES * 6);
+	for (size_t i = 0; i < surround.size(); i++) {
+		seed = seed * 1664525u + 1013904223u;
+		surround[i] = (seed >> 8) / 8388608.0f - 1.0f;
+	}
+	r.simdNs = timeKernel([&](int) { audioDownmix51(surround.data(), mono.data(), MIXER_FRAMES); });
+	r.scalarNs = timeKernel([&](int) { audioDownmix51Scalar(surround.data(), monoRef.data(), MIXER_FRAMES); });
+	r.maxError = maxDiff(mono, monoRef);
+	report("5.1 -> stereo", "", r);
+
+	// Texel packing for the spectrum texture: BINS x 2 rows of RGBA
+	std::vector<float> texels(BINS * 2 * 4);
+	for (size_t i = 0; i < texels.size(); i++) {
+		seed = seed * 1664525u + 1013904223u;
+		texels[i] = (seed >> 8) / 16777216.0f;
+	}
+	// The edges the SIMD path must treat like the scalar one: saturation
+	// and the flush of values below the smallest normal half
+	const float edges[] = { -0.5f, 1e5f, -1e5f, 65519.0f, -65520.0f, 6.1e-5f, 6.2e-5f, -6.2e-5f,
+		1e-7f, -1e-7f, 3e-5f, -3e-5f, 0.0f, -0.0f, 2.0f, 1000.0f };
+	for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) texels[i * 7] = edges[i];
+	std::vector<uint16_t> half(texels.size()), halfRef(texels.size());
+	r.simdNs = timeKernel([&](int) { audioFloatToHalf(texels.data(), half.data(), (int)texels.size()); });
+	r.scalarNs = timeKernel([&](int) { audioFloatToHalfScalar(texels.data(), halfRef.data(), (int)texels.size()); });
+	r.maxError = 0.0f;
+	for (size_t i = 0; i < half.size(); i++) r.maxError = fmaxf(r.maxError, fabsf((float)half[i] - (float)halfRef[i]));
+	report("float -> half", "ulp", r);
+
+	std::vector<uint8_t> bytes(texels.size()), bytesRef(texels.size());
+	r.simdNs = timeKernel([&](int) { audioFloatToUnorm8(texels.data(), bytes.data(), (int)texels.size(), 1.0f, 0.0f); });
+	r.scalarNs = timeKernel([&](int) { audioFloatToUnorm8Scalar(texels.data(), bytesRef.data(), (int)texels.size(), 1.0f, 0.0f); });
+	r.maxError = 0.0f;
+	for (size_t i = 0; i < bytes.size(); i++) r.maxError = fmaxf(r.maxError, fabsf((float)bytes[i] - (float)bytesRef[i]));
+	report("float -> unorm8", "lsb", r);
+
+	printf("\nSpectrum post-processing per analysis frame: %.1f ns (scalar %.1f ns, %.2fx)\n",
+		total, totalScalar, totalScalar / total);
+	return 0;
+}
@@ -0,0 +1,219 @@
+/*
+Shader Fun - Audio texture upload benchmark
+Times one frame's audio texture update both ways, on an EGL pbuffer:
+the old path, which re-specified single-channel GL_FLOAT textures with
+glTexImage2D every frame (waveform row + six spectrum rows), and
+AudioTextures, which packs RGBA texels and refreshes resident textures
+with glTexSubImage2D. "call" is the CPU time of the upload itself, as the
+Switch build's debug line reports it; "+draw" adds a 1x1 draw that samples
+both textures and a glFinish, so work the driver defers is counted too.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <GLES2/gl2.h>
+#include "audio_textures.h"
+#include "gl_state.h"
+#include "bench_common.h"
+#include "bench_gl.h"
+
+static const int SAMPLE_RATE = 48000;
+static const int LEGACY_SPECTRUM_ROWS = 6;   // smoothed, peak, left, right, mid, side
+
+static int frames = 2000;
+
+static const char* vertexSource =
+	"attribute vec2 aPos;\n"
+	"void main() { gl_Position = vec4(aPos, 0.0, 1.0); }\n";
+static const char* fragmentSource =
+	"precision mediump float;\n"
+	"uniform sampler2D iChannel0;\n"
+	"uniform sampler2D iChannel1;\n"
+	"void main() { gl_FragColor = texture2D(iChannel0, vec2(0.5)) + texture2D(iChannel1, vec2(0.5)); }\n";
+
+static GLuint compile(GLenum type, const char* source) {
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+	return shader;
+}
+
+// Samples both audio textures, so an upload the driver deferred has to land
+static GLuint createSampler() {
+	GLuint prog = glCreateProgram();
+	GLuint vs = compile(GL_VERTEX_SHADER, vertexSource);
+	GLuint fs = compile(GL_FRAGMENT_SHADER, fragmentSource);
+	glAttachShader(prog, vs);
+	glAttachShader(prog, fs);
+	glBindAttribLocation(prog, 0, "aPos");
+	glLinkProgram(prog);
+	glDeleteShader(vs);
+	glDeleteShader(fs);
+	g_glState.useProgram(prog);
+	glUniform1i(glGetUniformLocation(prog, "iChannel0"), 0);
+	glUniform1i(glGetUniformLocation(prog, "iChannel1"), 1);
+	return prog;
+}
+
+static GLuint createLegacyTexture() {
+	GLuint tex;
+	glGenTextures(1, &tex);
+	g_glState.editTexture(tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return tex;
+}
+
+static void drawSample() {
+	g_glState.viewport(0, 0, 1, 1);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glFinish();
+}
+
+struct UploadResult {
+	double callUs;
+	double drawUs;
+	int bytes;
+};
+
+// Test signal and a falling spectrum, one frame's worth
+struct FrameData {
+	std::vector<float> wave, stereo, spectrum, zeros;
+	uint64_t offset;
+
+	FrameData(int waveSize) : wave(waveSize), stereo(waveSize * 2), spectrum(waveSize / 2), zeros(waveSize / 2), offset(0) {}
+
+	void next() {
+		int waveSize = (int)wave.size();
+		benchSynthSignal(wave.data(), waveSize, SAMPLE_RATE, offset);
+		offset += SAMPLE_RATE / 60;
+		for (int i = 0; i < waveSize; i++) stereo[i * 2] = stereo[i * 2 + 1] = wave[i];
+		for (size_t i = 0; i < spectrum.size(); i++) spectrum[i] = 1.0f / (1.0f + i * 0.05f) * (0.5f + 0.5f * wave[i]);
+	}
+};
+
+static UploadResult timeLegacy(int waveSize) {
+	int bins = waveSize / 2;
+	FrameData data(waveSize);
+	std::vector<float> rows((size_t)bins * LEGACY_SPECTRUM_ROWS);
+	GLuint waveTex = createLegacyTexture();
+	GLuint spectrumTex = createLegacyTexture();
+	g_glState.bindTexture(0, waveTex);
+	g_glState.bindTexture(1, spectrumTex);
+
+	UploadResult result = { 0.0, 0.0, (waveSize + bins * LEGACY_SPECTRUM_ROWS) * (int)sizeof(float) };
+	for (int f = -100; f < frames; f++) {
+		data.next();
+		glFinish();
+		uint64_t start = benchNowNs();
+		// As uploadAudioTextures() did it before the textures went resident,
+		// bound where AudioTextures binds for its uploads
+		g_glState.editTexture(waveTex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, waveSize, 1, 0, GL_LUMINANCE, GL_FLOAT, data.wave.data());
+		for (int r = 0; r < LEGACY_SPECTRUM_ROWS; r++) {
+			memcpy(rows.data() + (size_t)bins * r, data.spectrum.data(), bins * sizeof(float));
+		}
+		g_glState.editTexture(spectrumTex);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, bins, LEGACY_SPECTRUM_ROWS, 0, GL_LUMINANCE, GL_FLOAT, rows.data());
+		uint64_t called = benchNowNs();
+		drawSample();
+		uint64_t drawn = benchNowNs();
+		// The first frames allocate; only the steady state counts
+		if (f < 0) continue;
+		result.callUs += (called - start) / 1e3;
+		result.drawUs += (drawn - start) / 1e3;
+	}
+	result.callUs /= frames;
+	result.drawUs /= frames;
+
+	g_glState.deleteTexture(waveTex);
+	g_glState.deleteTexture(spectrumTex);
+	return result;
+}
+
+static UploadResult timeResident(int waveSize, AudioTexFormat& format) {
+	int bins = waveSize / 2;
+	FrameData data(waveSize);
+	AudioTextures textures;
+	textures.init(waveSize, bins);
+	format = textures.getFormat();
+	g_glState.bindTexture(0, textures.getWaveform());
+	g_glState.bindTexture(1, textures.getSpectrum());
+
+	AudioTextureFrame tex;
+	tex.waveMono = data.wave.data();
+	tex.waveStereo = data.stereo.data();
+	tex.smoothed = data.spectrum.data();
+	tex.peaks = data.spectrum.data();
+	tex.left = data.spectrum.data();
+	tex.right = data.spectrum.data();
+	tex.mid = data.spectrum.data();
+	tex.side = data.zeros.data();
+	tex.bands = data.spectrum.data();
+	tex.raw = data.spectrum.data();
+	tex.rawGain = 1.0f;
+
+	UploadResult result = { 0.0, 0.0, 0 };
+	for (int f = -100; f < frames; f++) {
+		data.next();
+		glFinish();
+		uint64_t start = benchNowNs();
+		textures.upload(tex);
+		uint64_t called = benchNowNs();
+		drawSample();
+		uint64_t drawn = benchNowNs();
+		if (f < 0) {
+			textures.resetStats();
+			continue;
+		}
+		result.callUs += (called - start) / 1e3;
+		result.drawUs += (drawn - start) / 1e3;
+	}
+	result.callUs /= frames;
+	result.drawUs /= frames;
+	result.bytes = (int)textures.getBytesPerUpload();
+	textures.release();
+	return result;
+}
+
+int main(int argc, char* argv[]) {
+	if (argc > 1) frames = std::max(1, atoi(argv[1]));
+	if (!benchCreateContext(16, 16)) return 1;
+	// The old textures needed full float; GLES2 has no GL_FLOAT texels without it
+	if (!glHasExtension("GL_OES_texture_float")) {
+		printf("GL_OES_texture_float is missing: the old path can't run here\n");
+		return 1;
+	}
+
+	static const GLfloat quad[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+	GLuint vbo;
+	glGenBuffers(1, &vbo);
+	g_glState.bindArrayBuffer(vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(0);
+	GLuint prog = createSampler();
+
+	printf("Audio texture upload benchmark, %d frames per size\n", frames);
+	printf("%-10s %-36s %9s %9s %9s\n", "fft_size", "path", "bytes", "call us", "+draw us");
+	static const int sizes[] = { 512, 1024, 2048, 4096 };
+	for (int waveSize : sizes) {
+		UploadResult legacy = timeLegacy(waveSize);
+		AudioTexFormat format;
+		UploadResult resident = timeResident(waveSize, format);
+		printf("%-10d %-36s %9d %9.1f %9.1f\n", waveSize, "glTexImage2D, luminance float", legacy.bytes,
+			legacy.callUs, legacy.drawUs);
+		printf("%-10d %-36s %9d %9.1f %9.1f\n", waveSize,
+			format == AUDIO_TEX_HALF_FLOAT ? "glTexSubImage2D, RGBA half-float" : "glTexSubImage2D, RGBA8",
+			resident.bytes, resident.callUs, resident.drawUs);
+	}
+
+	g_glState.deleteProgram(prog);
+	glDeleteBuffers(1, &vbo);
+	return 0;
+}
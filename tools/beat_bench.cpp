@@ -0,0 +1,110 @@
+/*
+Shader Fun - Onset/tempo tracker benchmark
+Renders each module (default: the bundled romfs .mod tracks), feeds it
+through the capture ring and STFT exactly like the Switch build does at
+60 fps, and reports the beat tracker's cost per rendered frame along
+with the tempo it settled on.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "audio_ring.h"
+#include "audio_stft.h"
+#include "audio_beat.h"
+#include "bench_common.h"
+#include "mod_render.h"
+
+static const int SAMPLE_RATE = 44100;
+static const int FRAME_SAMPLES = SAMPLE_RATE / 60;
+static const int MIXER_CHUNK = 1024;
+
+struct TimedTracker {
+	BeatTracker* tracker;
+	uint64_t ns;
+};
+
+static void timedHop(const StftFrame& frame, void* user) {
+	TimedTracker* t = (TimedTracker*)user;
+	uint64_t t0 = benchNowNs();
+	t->tracker->processHop(frame.magnitudes);
+	t->ns += benchNowNs() - t0;
+}
+
+static void runTrack(const char* path, int fftSize, int hopSize) {
+	std::vector<float> stereo;
+	if (!modRender(path, SAMPLE_RATE, 180.0f, stereo)) return;
+	int frames = (int)(stereo.size() / 2);
+
+	AudioRing ring;
+	ring.init(SAMPLE_RATE * 4, 1, SAMPLE_RATE);
+	StftEngine stft;
+	stft.init(&ring, fftSize, hopSize, FFT_WINDOW_HANN);
+	BeatTracker tracker;
+	tracker.configure(stft.getBins(), stft.getBinHz(), SAMPLE_RATE / (float)stft.getHop());
+	TimedTracker timed = { &tracker, 0 };
+	stft.addListener(timedHop, &timed);
+
+	std::vector<double> frameUs;
+	std::vector<float> mono(MIXER_CHUNK);
+	int written = 0;
+	uint64_t stftNs = 0;
+
+	// Audio arrives in mixer-sized chunks; the renderer analyses every 1/60 s
+	for (int renderPos = FRAME_SAMPLES; renderPos <= frames; renderPos += FRAME_SAMPLES) {
+		while (written < renderPos) {
+			int n = std::min(MIXER_CHUNK, frames - written);
+			for (int i = 0; i < n; i++) {
+				mono[i] = 0.5f * (stereo[(written + i) * 2] + stereo[(written + i) * 2 + 1]);
+			}
+			ring.write(mono.data(), n);
+			written += n;
+		}
+		timed.ns = 0;
+		uint64_t t0 = benchNowNs();
+		stft.process(ring.writePosition());
+		stftNs += benchNowNs() - t0 - timed.ns;
+		frameUs.push_back(timed.ns / 1000.0);
+	}
+
+	std::vector<double> sorted = frameUs;
+	std::sort(sorted.begin(), sorted.end());
+	double sum = 0.0;
+	for (double v : sorted) sum += v;
+	const char* name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+
+	printf("%-26s %6.1fs %7.1f %5.2f %6llu %6llu   %6.2f %6.2f %6.2f   %6.2f\n",
+		name, frames / (float)SAMPLE_RATE, tracker.getBpm(), tracker.getConfidence(),
+		(unsigned long long)tracker.getOnsetCount(), (unsigned long long)tracker.getBeatCount(),
+		sum / sorted.size(), sorted[sorted.size() * 99 / 100], sorted.back(),
+		stftNs / 1000.0 / sorted.size());
+}
+
+int main(int argc, char* argv[]) {
+	static const char* defaults[] = {
+		"../romfs/music/a_piece_of_magic_2.mod",
+		"../romfs/music/highdens.mod",
+		"../romfs/music/juicy_red_remix.mod",
+	};
+	int fftSize = 1024, hopSize = 256;
+	std::vector<const char*> tracks;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) fftSize = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc) hopSize = atoi(argv[++i]);
+		else tracks.push_back(argv[i]);
+	}
+	if (tracks.empty()) tracks.assign(defaults, defaults + 3);
+
+	printf("Beat tracker benchmark: window %d, hop %d, %d Hz, frames of %d samples\n",
+		fftSize, hopSize, SAMPLE_RATE, FRAME_SAMPLES);
+	printf("%-26s %7s %7s %5s %6s %6s   %6s %6s %6s   %6s\n",
+		"track", "length", "bpm", "conf", "onsets", "beats",
+		"avg us", "p99 us", "max us", "stft us");
+	for (const char* t : tracks) {
+		runTrack(t, fftSize, hopSize);
+	}
+	printf("(beat tracker cost per rendered frame; STFT cost shown for reference)\n");
+	return 0;
+}
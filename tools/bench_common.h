@@ -0,0 +1,38 @@
+/*
+Shader Fun - Host benchmark helpers
+Created By MrDude
+*/
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static inline uint64_t benchNowNs() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Keep the optimiser from discarding benchmark results
+static volatile float benchSink;
+static inline void benchConsume(float v) {
+	benchSink = v;
+}
+
+// Deterministic music-ish test signal: a couple of tones plus noise
+static inline void benchSynthSignal(float* out, int count, int sampleRate, uint64_t offset = 0) {
+	uint32_t seed = (uint32_t)(offset * 2654435761u) | 1u;
+	for (int i = 0; i < count; i++) {
+		double t = (double)(offset + i) / sampleRate;
+		seed = seed * 1664525u + 1013904223u;
+		float noise = ((seed >> 9) / 8388608.0f - 1.0f) * 0.05f;
+		out[i] = 0.5f * (float)sin(2.0 * M_PI * 110.0 * t)
+			+ 0.25f * (float)sin(2.0 * M_PI * 1234.5 * t)
+			+ noise;
+	}
+}
+
+#endif // BENCH_COMMON_H
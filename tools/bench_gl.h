@@ -0,0 +1,59 @@
+/*
+Shader Fun - Host GL benchmark helpers
+Created By MrDude
+*/
+
+#ifndef BENCH_GL_H
+#define BENCH_GL_H
+
+#include <stdio.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+// GLES2 context on a width x height pbuffer. Without a display server,
+// Mesa's surfaceless platform gives one anyway.
+static inline bool benchCreateContext(int width, int height) {
+	EGLDisplay display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		if (!eglInitialize(display, NULL, NULL)) {
+			printf("eglInitialize failed (0x%04x)\n", eglGetError());
+			return false;
+		}
+	}
+
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configs = 0;
+	if (!eglChooseConfig(display, configAttribs, &config, 1, &configs) || configs == 0) {
+		printf("No pbuffer-capable GLES2 config\n");
+		return false;
+	}
+	eglBindAPI(EGL_OPENGL_ES_API);
+
+	const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+	const EGLint surfaceAttribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+	EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+	if (context == EGL_NO_CONTEXT || surface == EGL_NO_SURFACE || !eglMakeCurrent(display, surface, surface, context)) {
+		printf("Could not create a GLES2 pbuffer context (0x%04x)\n", eglGetError());
+		return false;
+	}
+	printf("GL: %s / %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+	return true;
+}
+
+#endif // BENCH_GL_H
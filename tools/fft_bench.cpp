@@ -0,0 +1,107 @@
+/*
+Shader Fun - FFT microbenchmark
+Compares the original complex kiss_fft path (real samples copied into
+.r, .i zeroed) against the windowed real-input SpectrumAnalyzer.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "audio_fft.h"
+#include "bench_common.h"
+
+static const int SAMPLE_RATE = 44100;
+
+// The pre-kiss_fftr computeFFT() body, kept verbatim for comparison
+static void complexPath(kiss_fft_cfg cfg, const float* in, kiss_fft_cpx* fftIn, kiss_fft_cpx* fftOut,
+	float* spectrum, int n) {
+	for (int i = 0; i < n; i++) {
+		fftIn[i].r = in[i];
+		fftIn[i].i = 0;
+	}
+	kiss_fft(cfg, fftIn, fftOut);
+
+	for (int i = 0; i < n / 2; i++) {
+		float mag = sqrtf(fftOut[i].r * fftOut[i].r + fftOut[i].i * fftOut[i].i);
+		spectrum[i] = mag / (n / 2);
+	}
+}
+
+// Fraction of spectral energy more than `guard` bins away from the peak
+static float leakage(const float* mag, int bins, int guard) {
+	int peak = 0;
+	for (int i = 1; i < bins; i++) {
+		if (mag[i] > mag[peak]) peak = i;
+	}
+	double total = 0.0, far = 0.0;
+	for (int i = 0; i < bins; i++) {
+		double e = (double)mag[i] * mag[i];
+		total += e;
+		if (abs(i - peak) > guard) far += e;
+	}
+	return total > 0.0 ? (float)(far / total) : 0.0f;
+}
+
+int main(int argc, char* argv[]) {
+	int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+	const int sizes[] = { 256, 512, 1024, 2048, 4096 };
+
+	printf("FFT benchmark, %d iterations per size\n", iterations);
+	printf("%6s %14s %14s %8s\n", "size", "complex ns", "real+win ns", "speedup");
+
+	for (int size : sizes) {
+		std::vector<float> signal(size), spectrum(size / 2);
+		std::vector<kiss_fft_cpx> fftIn(size), fftOut(size);
+		benchSynthSignal(signal.data(), size, SAMPLE_RATE);
+
+		kiss_fft_cfg cfg = kiss_fft_alloc(size, 0, NULL, NULL);
+		SpectrumAnalyzer analyzer;
+		analyzer.init(size, FFT_WINDOW_HANN);
+
+		// Warm up both paths
+		for (int i = 0; i < 100; i++) {
+			complexPath(cfg, signal.data(), fftIn.data(), fftOut.data(), spectrum.data(), size);
+			analyzer.analyze(signal.data(), spectrum.data());
+		}
+
+		uint64_t t0 = benchNowNs();
+		for (int i = 0; i < iterations; i++) {
+			complexPath(cfg, signal.data(), fftIn.data(), fftOut.data(), spectrum.data(), size);
+			benchConsume(spectrum[i % (size / 2)]);
+		}
+		uint64_t t1 = benchNowNs();
+		for (int i = 0; i < iterations; i++) {
+			analyzer.analyze(signal.data(), spectrum.data());
+			benchConsume(spectrum[i % (size / 2)]);
+		}
+		uint64_t t2 = benchNowNs();
+
+		double complexNs = (double)(t1 - t0) / iterations;
+		double realNs = (double)(t2 - t1) / iterations;
+		printf("%6d %14.1f %14.1f %7.2fx\n", size, complexNs, realNs, complexNs / realNs);
+
+		kiss_fft_free(cfg);
+	}
+
+	// Spectral leakage of an off-bin tone at the default analysis size
+	const int size = 512;
+	std::vector<float> tone(size), mag(size / 2);
+	for (int i = 0; i < size; i++) {
+		tone[i] = (float)sin(2.0 * M_PI * 20.37 * i / size);
+	}
+	printf("\nLeakage (energy > 4 bins from peak, 20.37-bin tone, N=%d)\n", size);
+	const FftWindow windows[] = { FFT_WINDOW_NONE, FFT_WINDOW_HANN, FFT_WINDOW_BLACKMAN };
+	for (FftWindow w : windows) {
+		SpectrumAnalyzer analyzer;
+		analyzer.init(size, w);
+		analyzer.analyze(tone.data(), mag.data());
+		int peak = 0;
+		for (int i = 1; i < size / 2; i++) {
+			if (mag[i] > mag[peak]) peak = i;
+		}
+		printf("  %-9s %8.5f%%  (peak bin %d, magnitude %.3f)\n",
+			fftWindowName(w), leakage(mag.data(), size / 2, 4) * 100.0f, peak, mag[peak]);
+	}
+
+	return 0;
+}
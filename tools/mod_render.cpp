@@ -0,0 +1,191 @@
+/*
+Shader Fun - Minimal ProTracker MOD renderer for host benchmarks
+Created By MrDude
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "mod_render.h"
+
+static const int MOD_CHANNELS = 4;
+static const int MOD_ROWS = 64;
+static const double PAL_CLOCK = 7093789.2;
+
+struct ModSample {
+	const int8_t* data;
+	uint32_t length;
+	uint32_t loopStart;
+	uint32_t loopLength;
+	int volume;
+};
+
+struct ModChannel {
+	int sample;      // 1-based, 0 = none
+	double pos;
+	double step;
+	int period;
+	int volume;
+	bool active;
+};
+
+static uint16_t readBE16(const uint8_t* p) {
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+bool modRender(const char* path, int sampleRate, float maxSeconds, std::vector<float>& out) {
+	FILE* f = fopen(path, "rb");
+	if (!f) {
+		printf("mod: cannot open %s\n", path);
+		return false;
+	}
+	std::vector<uint8_t> file;
+	uint8_t buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+		file.insert(file.end(), buf, buf + n);
+	}
+	fclose(f);
+
+	if (file.size() < 1084 || memcmp(&file[1080], "M.K.", 4) != 0) {
+		printf("mod: %s is not a 4-channel M.K. module\n", path);
+		return false;
+	}
+
+	int songLength = file[950];
+	const uint8_t* orders = &file[952];
+	int patternCount = 0;
+	for (int i = 0; i < 128; i++) {
+		if (orders[i] + 1 > patternCount) patternCount = orders[i] + 1;
+	}
+
+	const uint8_t* patterns = &file[1084];
+	size_t sampleOffset = 1084 + (size_t)patternCount * MOD_ROWS * MOD_CHANNELS * 4;
+	ModSample samples[31];
+	for (int i = 0; i < 31; i++) {
+		const uint8_t* h = &file[20 + i * 30];
+		ModSample& s = samples[i];
+		s.length = readBE16(h + 22) * 2u;
+		s.volume = h[25] > 64 ? 64 : h[25];
+		s.loopStart = readBE16(h + 26) * 2u;
+		s.loopLength = readBE16(h + 28) * 2u;
+		s.data = sampleOffset < file.size() ? (const int8_t*)&file[sampleOffset] : nullptr;
+		if (sampleOffset + s.length > file.size()) {
+			s.length = sampleOffset < file.size() ? (uint32_t)(file.size() - sampleOffset) : 0;
+		}
+		if (s.loopLength <= 2 || s.loopStart + s.loopLength > s.length) s.loopLength = 0;
+		sampleOffset += readBE16(h + 22) * 2u;
+	}
+
+	ModChannel ch[MOD_CHANNELS];
+	memset(ch, 0, sizeof(ch));
+	const float pan[MOD_CHANNELS] = { 0.2f, 0.8f, 0.8f, 0.2f }; // Amiga LRRL, softened
+
+	int speed = 6, tempo = 125;
+	int order = 0, row = 0;
+	std::vector<bool> visited((size_t)songLength * MOD_ROWS, false);
+	size_t maxFrames = (size_t)(maxSeconds * sampleRate);
+	out.clear();
+
+	while (order < songLength && out.size() / 2 < maxFrames) {
+		size_t key = (size_t)order * MOD_ROWS + row;
+		if (visited[key]) break; // song loops back on itself
+		visited[key] = true;
+
+		const uint8_t* cells = patterns + ((size_t)orders[order] * MOD_ROWS + row) * MOD_CHANNELS * 4;
+		int nextOrder = -1, nextRow = -1;
+		int volSlide[MOD_CHANNELS] = { 0 };
+		int portaSlide[MOD_CHANNELS] = { 0 };
+
+		for (int c = 0; c < MOD_CHANNELS; c++) {
+			const uint8_t* cell = cells + c * 4;
+			int sample = (cell[0] & 0xF0) | (cell[2] >> 4);
+			int period = ((cell[0] & 0x0F) << 8) | cell[1];
+			int effect = cell[2] & 0x0F;
+			int param = cell[3];
+			ModChannel& m = ch[c];
+
+			if (sample > 0 && sample <= 31) {
+				m.sample = sample;
+				m.volume = samples[sample - 1].volume;
+			}
+			if (period > 0 && effect != 3 && m.sample > 0) {
+				m.period = period;
+				m.pos = 0.0;
+				m.active = samples[m.sample - 1].length > 2;
+			}
+
+			switch (effect) {
+			case 0x1: portaSlide[c] = -param; break;
+			case 0x2: portaSlide[c] = param; break;
+			case 0x9: m.pos = param * 256.0; break;
+			case 0xA: volSlide[c] = (param >> 4) ? (param >> 4) : -(param & 0x0F); break;
+			case 0xB: nextOrder = param; nextRow = 0; break;
+			case 0xC: m.volume = param > 64 ? 64 : param; break;
+			case 0xD: nextOrder = order + 1; nextRow = (param >> 4) * 10 + (param & 0x0F); break;
+			case 0xF:
+				if (param == 0) break;
+				if (param < 32) speed = param;
+				else tempo = param;
+				break;
+			default: break;
+			}
+		}
+
+		// Render the row tick by tick so slides are applied per tick
+		int samplesPerTick = sampleRate * 5 / (tempo * 2);
+		for (int tick = 0; tick < speed; tick++) {
+			if (tick > 0) {
+				for (int c = 0; c < MOD_CHANNELS; c++) {
+					ch[c].volume += volSlide[c];
+					if (ch[c].volume < 0) ch[c].volume = 0;
+					if (ch[c].volume > 64) ch[c].volume = 64;
+					ch[c].period += portaSlide[c];
+					if (ch[c].period < 113) ch[c].period = 113;
+					if (ch[c].period > 856 * 2) ch[c].period = 856 * 2;
+				}
+			}
+			for (int c = 0; c < MOD_CHANNELS; c++) {
+				ch[c].step = ch[c].period > 0 ? (PAL_CLOCK / (ch[c].period * 2.0)) / sampleRate : 0.0;
+			}
+
+			for (int i = 0; i < samplesPerTick; i++) {
+				float l = 0.0f, r = 0.0f;
+				for (int c = 0; c < MOD_CHANNELS; c++) {
+					ModChannel& m = ch[c];
+					if (!m.active || m.sample == 0) continue;
+					const ModSample& s = samples[m.sample - 1];
+					if (!s.data) continue;
+					uint32_t p = (uint32_t)m.pos;
+					if (p >= s.length) {
+						if (s.loopLength == 0) {
+							m.active = false;
+							continue;
+						}
+						m.pos = s.loopStart + fmod(m.pos - s.loopStart, (double)s.loopLength);
+						p = (uint32_t)m.pos;
+					}
+					float v = s.data[p] / 128.0f * (m.volume / 64.0f);
+					l += v * (1.0f - pan[c]);
+					r += v * pan[c];
+					m.pos += m.step;
+				}
+				out.push_back(l * 0.5f);
+				out.push_back(r * 0.5f);
+			}
+		}
+
+		if (nextOrder >= 0) {
+			order = nextOrder;
+			row = nextRow < MOD_ROWS ? nextRow : 0;
+		}
+		else if (++row >= MOD_ROWS) {
+			row = 0;
+			order++;
+		}
+	}
+
+	return !out.empty();
+}
@@ -0,0 +1,18 @@
+/*
+Shader Fun - Minimal ProTracker MOD renderer for host benchmarks
+Created By MrDude
+*/
+
+#ifndef MOD_RENDER_H
+#define MOD_RENDER_H
+
+#include <vector>
+
+// Renders a 4-channel "M.K." module to interleaved stereo float PCM.
+// Plays notes, sample loops, volume, speed/tempo, jumps/breaks, volume
+// slides and portamento - enough for realistic rhythm and spectra, not a
+// faithful player. Stops at the end of the order list, on the first
+// loop back, or after maxSeconds.
+bool modRender(const char* path, int sampleRate, float maxSeconds, std::vector<float>& stereoOut);
+
+#endif // MOD_RENDER_H
@@ -0,0 +1,306 @@
+/*
+Shader Fun - Headless shader benchmark
+Builds every shader (default: the bundled romfs shaders) through the same
+loadShaderProgram path as the Switch build, on an EGL pbuffer - Mesa's
+software renderer is fine, no GPU needed - and renders it for a number
+of 1280x720 frames with synthetic audio textures. Writes compile time,
+link time and ms per frame to a CSV file, and exits with 1 if any shader
+failed to build. With -p dir the programs go through a program binary
+cache in dir, as on the Switch: a second run times loading them back.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <GLES2/gl2.h>
+#include "audio_textures.h"
+#include "gl_state.h"
+#include "program_binary.h"
+#include "shader_buffers.h"
+#include "shader_estimate.h"
+#include "shader_program.h"
+#include "bench_common.h"
+#include "bench_gl.h"
+
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const int WAVE_SIZE = 1024;
+static const int BINS = WAVE_SIZE / 2;
+static const int SAMPLE_RATE = 48000;
+
+static bool fileExists(const std::string& path) {
+	struct stat st;
+	return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+static std::string readFile(const std::string& path) {
+	std::ifstream file(path.c_str());
+	std::stringstream ss;
+	ss << file.rdbuf();
+	return ss.str();
+}
+
+static bool isShaderFile(const std::string& name) {
+	if (isShaderBufferFile(name)) return false;
+	return (name.size() > 5 && name.substr(name.size() - 5) == ".frag") ||
+		(name.size() > 5 && name.substr(name.size() - 5) == ".glsl");
+}
+
+// Same rules as the Switch build's folder scan, in a stable order
+static void scanShaders(const std::string& path, std::vector<std::string>& files) {
+	DIR* dir = opendir(path.c_str());
+	if (!dir) {
+		if (fileExists(path)) files.push_back(path);
+		else printf("Could not open %s\n", path.c_str());
+		return;
+	}
+	std::vector<std::string> names;
+	struct dirent* ent;
+	while ((ent = readdir(dir)) != NULL) {
+		if (strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) names.push_back(ent->d_name);
+	}
+	closedir(dir);
+	std::sort(names.begin(), names.end());
+
+	for (const std::string& name : names) {
+		std::string full = path + "/" + name;
+		struct stat st;
+		if (stat(full.c_str(), &st) != 0) continue;
+		if (S_ISDIR(st.st_mode)) scanShaders(full, files);
+		else if (isShaderFile(name)) files.push_back(full);
+	}
+}
+
+// Synthetic but music-like audio: the benchmark test signal as the
+// waveform, and a falling spectrum with a pulsing bass end
+struct SyntheticAudio {
+	std::vector<float> wave, stereo, spectrum, peaks, bands, zeros;
+	uint64_t offset;
+
+	SyntheticAudio() : wave(WAVE_SIZE), stereo(WAVE_SIZE * 2), spectrum(BINS), peaks(BINS), bands(BINS), zeros(BINS), offset(0) {}
+
+	void next(int frame, AudioTextures& textures, AudioFeatures& features) {
+		benchSynthSignal(wave.data(), WAVE_SIZE, SAMPLE_RATE, offset);
+		offset += SAMPLE_RATE / 60;
+		for (int i = 0; i < WAVE_SIZE; i++) stereo[i * 2] = stereo[i * 2 + 1] = wave[i];
+
+		float pulse = 0.5f + 0.5f * cosf(frame * 0.26f);
+		for (int i = 0; i < BINS; i++) {
+			float level = 1.0f / (1.0f + i * 0.05f);
+			spectrum[i] = i < 24 ? level * pulse : level * 0.6f;
+			peaks[i] = std::max(peaks[i] * 0.95f, spectrum[i]);
+			bands[i] = spectrum[i];
+		}
+
+		AudioTextureFrame tex;
+		tex.waveMono = wave.data();
+		tex.waveStereo = stereo.data();
+		tex.smoothed = spectrum.data();
+		tex.peaks = peaks.data();
+		tex.left = spectrum.data();
+		tex.right = spectrum.data();
+		tex.mid = spectrum.data();
+		tex.side = zeros.data();
+		tex.bands = bands.data();
+		tex.raw = spectrum.data();
+		tex.rawGain = 1.0f;
+		textures.upload(tex);
+
+		for (int b = 0; b < AUDIO_BAND_COUNT; b++) features.bands[b] = spectrum[b * BINS / AUDIO_BAND_COUNT / 4];
+		features.bass = 0.8f * pulse;
+		features.mid = 0.4f;
+		features.treble = 0.2f;
+		features.energy = 0.35f;
+		features.peak = 0.75f;
+	}
+};
+
+struct ShaderResult {
+	std::string path;
+	bool built;
+	int passes;
+	ShaderBuildTimes times;
+	float firstFrameMs;   // includes any compile work the driver left for the first draw
+	float avgMs;
+	float maxMs;
+	ShaderEstimate estimate;  // what the scan-time estimate made of it
+};
+
+static ShaderResult runShader(const std::string& path, int frames, AudioTextures& textures, SyntheticAudio& audio) {
+	ShaderResult result;
+	result.path = path;
+	memset(&result.times, 0, sizeof(result.times));
+	memset(&result.estimate, 0, sizeof(result.estimate));
+	bool buffersBuilt = true;
+
+	// Buffer passes first, as on the Switch; their build time counts too
+	ShaderBuffers buffers;
+	for (int b = 0; b < SHADER_BUFFER_COUNT; b++) {
+		std::string bufferPath = shaderBufferPath(path, b);
+		if (!fileExists(bufferPath)) continue;
+		ShaderBuildTimes times;
+		std::string bufferSource = readFile(bufferPath);
+		// Read up front, as the Switch build's worker thread does
+		ProgramBinary binary;
+		g_programBinaries.read(bufferSource.c_str(), binary);
+		if (!buffers.setPass(b, bufferSource.c_str(), &times, bufferPath.c_str(), &binary)) buffersBuilt = false;
+		ShaderEstimate pass;
+		estimateShaderCost(bufferSource.c_str(), pass);
+		addShaderEstimate(result.estimate, pass);
+		result.times.compileMs += times.compileMs;
+		result.times.linkMs += times.linkMs;
+	}
+	result.passes = buffers.getPassCount() + 1;
+
+	std::string source = readFile(path);
+	ShaderEstimate image;
+	estimateShaderCost(source.c_str(), image);
+	addShaderEstimate(result.estimate, image);
+	ShaderBuildTimes times;
+	ProgramBinary binary;
+	g_programBinaries.read(source.c_str(), binary);
+	ShaderProgram shader = loadShaderProgram(source.c_str(), &times, path.c_str(), &binary);
+	result.times.compileMs += times.compileMs;
+	result.times.linkMs += times.linkMs;
+	result.built = !shader.fallback && buffersBuilt;
+
+	ShaderInputs inputs;
+	memset(&inputs, 0, sizeof(inputs));
+	inputs.resolution[0] = (float)WIDTH;
+	inputs.resolution[1] = (float)HEIGHT;
+	inputs.resolution[2] = 1.0f;
+	inputs.timeDelta = 1.0f / 60.0f;
+	inputs.frameRate = 60.0f;
+	inputs.mouse[0] = WIDTH * 0.5f;
+	inputs.mouse[1] = HEIGHT * 0.5f;
+	inputs.channelResolution[0] = (float)WAVE_SIZE;
+	inputs.channelResolution[1] = 1.0f;
+	inputs.channelResolution[2] = 1.0f;
+	inputs.channelResolution[3] = (float)BINS;
+	inputs.channelResolution[4] = (float)AUDIO_TEX_SPECTRUM_ROWS;
+	inputs.channelResolution[5] = 1.0f;
+	inputs.bpm = 120.0f;
+	inputs.stereoCorrelation = 1.0f;
+
+	std::vector<float> frameMs;
+	for (int f = 0; f < frames; f++) {
+		glFinish();
+		uint64_t start = benchNowNs();
+
+		audio.next(f, textures, inputs.audio);
+		inputs.time = f / 60.0f;
+		inputs.frame = f;
+		inputs.date[3] = inputs.time;
+		inputs.beatPhase = fmodf(inputs.time * 2.0f, 1.0f);
+		inputs.beat = 1.0f - inputs.beatPhase;
+
+		g_glState.bindTexture(SHADER_UNIT_WAVEFORM, textures.getWaveform());
+		g_glState.bindTexture(SHADER_UNIT_SPECTRUM, textures.getSpectrum());
+		if (buffers.getPassCount() > 0) {
+			buffers.fillChannelResolution(inputs.channelResolution);
+			buffers.render(inputs, WIDTH, HEIGHT);
+		}
+		g_glState.bindFramebuffer(0);
+		g_glState.viewport(0, 0, WIDTH, HEIGHT);
+		g_glState.useProgram(shader.prog);
+		applyShaderUniforms(shader, inputs);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		glFinish();
+
+		frameMs.push_back((benchNowNs() - start) / 1e6f);
+	}
+
+	result.firstFrameMs = frameMs.empty() ? 0.0f : frameMs[0];
+	result.avgMs = 0.0f;
+	result.maxMs = 0.0f;
+	// The first frame is reported on its own, so the steady state starts after it
+	for (size_t i = 1; i < frameMs.size(); i++) {
+		result.avgMs += frameMs[i];
+		result.maxMs = std::max(result.maxMs, frameMs[i]);
+	}
+	if (frameMs.size() > 1) result.avgMs /= frameMs.size() - 1;
+
+	buffers.release();
+	deleteShaderProgram(shader.prog);
+	return result;
+}
+
+int main(int argc, char* argv[]) {
+	int frames = 5;
+	const char* csvPath = "build/shader_bench.csv";
+	const char* binaryDir = NULL;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) frames = std::max(2, atoi(argv[++i]));
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) csvPath = argv[++i];
+		else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) binaryDir = argv[++i];
+		else paths.push_back(argv[i]);
+	}
+	if (paths.empty()) paths.push_back("../romfs/shaders");
+
+	std::vector<std::string> files;
+	for (const std::string& p : paths) scanShaders(p, files);
+	if (files.empty()) {
+		printf("No shaders found\n");
+		return 1;
+	}
+	if (!benchCreateContext(WIDTH, HEIGHT)) return 1;
+	if (binaryDir) g_programBinaries.init((GlProcLoader)eglGetProcAddress, binaryDir, 64 * 1024 * 1024);
+
+	// Fullscreen quad on attribute 0, as set up once by the Switch build
+	static const GLfloat quad[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+	GLuint vbo;
+	glGenBuffers(1, &vbo);
+	g_glState.bindArrayBuffer(vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(0);
+
+	AudioTextures textures;
+	textures.init(WAVE_SIZE, BINS);
+	SyntheticAudio audio;
+
+	FILE* csv = fopen(csvPath, "w");
+	if (!csv) {
+		printf("Could not write %s\n", csvPath);
+		return 1;
+	}
+	fprintf(csv, "shader,built,passes,compile_ms,link_ms,first_frame_ms,frame_ms,max_frame_ms,est_score,cost_class\n");
+
+	printf("Shader benchmark: %dx%d, %d frames each (first frame reported separately)\n", WIDTH, HEIGHT, frames);
+	printf("%-44s %5s %10s %8s %11s %9s %9s %9s\n", "shader", "built", "compile ms", "link ms", "1st frame", "ms/frame", "max ms",
+		"estimate");
+	int failed = 0;
+	for (const std::string& file : files) {
+		// Rows go out as they finish - software rendering can take a while
+		ShaderResult r = runShader(file, frames, textures, audio);
+		fprintf(csv, "\"%s\",%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.0f,%s\n", r.path.c_str(), r.built ? 1 : 0, r.passes,
+			r.times.compileMs, r.times.linkMs, r.firstFrameMs, r.avgMs, r.maxMs, r.estimate.score,
+			shaderCostClassName(r.estimate.costClass));
+
+		size_t cut = r.path.size() > 44 ? r.path.size() - 44 : 0;
+		printf("%-44s %5s %10.2f %8.2f %11.2f %9.2f %9.2f %9s\n", r.path.c_str() + cut, r.built ? "yes" : "NO",
+			r.times.compileMs, r.times.linkMs, r.firstFrameMs, r.avgMs, r.maxMs, shaderCostClassName(r.estimate.costClass));
+		fflush(stdout);
+		if (!r.built) failed++;
+	}
+	fclose(csv);
+	printf("%d shaders, %d failed to build; CSV written to %s\n", (int)files.size(), failed, csvPath);
+	if (g_programBinaries.isAvailable()) {
+		printf("Program binaries: %d loaded, %d compiled\n", g_programBinaries.getHits(), g_programBinaries.getMisses());
+		g_programBinaries.save();
+	}
+
+	textures.release();
+	releaseShaderCompiler();
+	glDeleteBuffers(1, &vbo);
+	return failed ? 1 : 0;
+}